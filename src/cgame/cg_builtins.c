@@ -233,6 +233,7 @@ static void PFCG_SetCursorPos(void)
 CG_InitScriptBuiltins
 
 Register builtins which can be shared by both client and server progs
+null/cl_null.c registers placeholders for these, keep them in sync
 =================
 */
 void CG_InitScriptBuiltins()
@@ -128,7 +128,7 @@ static int CG_HullForEntity(entity_state_t* ent)
 #endif
 
 	// create a temp hull from bounding box sizes
-	return CM_HeadnodeForBox(bmins, bmaxs);
+	return CM_HeadnodeForBoxCtx(&cl_cmcontext, bmins, bmaxs);
 }
 
 /*
@@ -164,7 +164,7 @@ static void CG_ClipMoveToEntities(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t
 		else
 			angles = vec3_origin;	// boxes don't rotate
 
-		trace = CM_TransformedBoxTrace(start, end, mins, maxs, headnode, contentsMask, ent->origin, angles);
+		trace = CM_TransformedBoxTraceCtx(&cl_cmcontext, start, end, mins, maxs, headnode, contentsMask, ent->origin, angles);
 	
 		if (trace.allsolid || trace.startsolid || trace.fraction < tr->fraction)
 		{
@@ -198,7 +198,7 @@ trace_t CG_Trace(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int content
 		maxs = vec3_origin;
 
 	// check against world
-	trace = CM_BoxTrace(start, end, mins, maxs, 0, contentsMask);
+	trace = CM_BoxTraceCtx(&cl_cmcontext, start, end, mins, maxs, 0, contentsMask);
 	if (trace.fraction == 0.0f)
 	{
 		// blocked by world
@@ -226,7 +226,7 @@ int	CG_PointContents(vec3_t point)
 	cmodel_t* cmodel;
 	int			contents;
 
-	contents = CM_PointContents(point, 0);
+	contents = CM_PointContentsCtx(&cl_cmcontext, point, 0);
 
 	for (i = 0; i < cl.frame.num_entities; i++)
 	{
@@ -240,7 +240,7 @@ int	CG_PointContents(vec3_t point)
 		if (!cmodel)
 			continue;
 
-		contents |= CM_TransformedPointContents(point, cmodel->headnode, ent->origin, ent->angles);
+		contents |= CM_TransformedPointContentsCtx(&cl_cmcontext, point, cmodel->headnode, ent->origin, ent->angles);
 	}
 
 	return contents;
@@ -286,6 +286,58 @@ void CL_RequestNextDownload(void)
 }
 
 
+/*
+=================
+CL_PrefetchAssets
+
+Reads the map, models, sounds and pics named in the configstrings ahead
+on the job threads, so registration finds them in memory
+=================
+*/
+static void CL_PrefetchAssets (void)
+{
+	static char	names[MAX_MODELS + MAX_SOUNDS + MAX_IMAGES][MAX_QPATH];
+	char		*list[MAX_MODELS + MAX_SOUNDS + MAX_IMAGES];
+	char		*s;
+	int			i, count;
+
+	count = 0;
+	for (i = 1; i < MAX_MODELS && cl.configstrings[CS_MODELS+i][0]; i++)
+	{
+		s = cl.configstrings[CS_MODELS+i];
+		if (s[0] == '*' || s[0] == '#')
+			continue;		// inline or client side models
+		Com_sprintf (names[count], MAX_QPATH, "%s", s);
+		count++;
+	}
+
+	for (i = 1; i < MAX_SOUNDS && cl.configstrings[CS_SOUNDS+i][0]; i++)
+	{
+		s = cl.configstrings[CS_SOUNDS+i];
+		if (s[0] == '*')
+			continue;		// sexed sounds depend on the player model
+		if (s[0] == '#')
+			Com_sprintf (names[count], MAX_QPATH, "%s", s + 1);
+		else
+			Com_sprintf (names[count], MAX_QPATH, "sound/%s", s);
+		count++;
+	}
+
+	for (i = 1; i < MAX_IMAGES && cl.configstrings[CS_IMAGES+i][0]; i++)
+	{
+		s = cl.configstrings[CS_IMAGES+i];
+		if (s[0] == '/' || s[0] == '\\')
+			Com_sprintf (names[count], MAX_QPATH, "%s", s + 1);
+		else
+			Com_sprintf (names[count], MAX_QPATH, "guipics/%s.tga", s);
+		count++;
+	}
+
+	for (i = 0; i < count; i++)
+		list[i] = names[i];
+	FS_PrefetchFiles (list, count);
+}
+
 /*
 =================
 CL_Precache_f
@@ -302,6 +354,7 @@ void CL_Precache_f(void)
 	{
 		unsigned	map_checksum;		// for detecting cheater maps
 
+		CL_PrefetchAssets ();
 		CM_LoadMap(cl.configstrings[CS_MODELS + 1], true, &map_checksum);
 		CL_RegisterSounds();
 		CL_PrepRefresh();
@@ -313,6 +366,7 @@ void CL_Precache_f(void)
 	precache_model = 0;
 	precache_model_skin = 0;
 
+	CL_PrefetchAssets ();
 	CL_RequestNextDownload();
 }
 
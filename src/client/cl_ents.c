@@ -47,10 +47,16 @@ Returns the entity number and the header bits
 int	bitcounts[32];	/// just for protocol profiling
 int CL_ParseEntityBits (unsigned *bits)
 {
-	unsigned	b, total;
+	unsigned	total;
+#if PROTOCOL_PACKED_ENTITIES != 1
+	unsigned	b;
+#endif
 	int			i;
 	int			number;
 
+#if PROTOCOL_PACKED_ENTITIES == 1
+	number = MSG_ReadPackedEntityBits (&net_message, &total);
+#else
 	total = MSG_ReadByte (&net_message);
 	if (total & U_MOREBITS1)
 	{
@@ -68,15 +74,16 @@ int CL_ParseEntityBits (unsigned *bits)
 		total |= b<<24;
 	}
 
-	// count the bits for net profiling
-	for (i=0 ; i<32 ; i++)
-		if (total&(1<<i))
-			bitcounts[i]++;
-
 	if (total & U_NUMBER_16)
 		number = MSG_ReadShort (&net_message);
 	else
 		number = MSG_ReadByte (&net_message);
+#endif
+
+	// count the bits for net profiling
+	for (i=0 ; i<32 ; i++)
+		if (total&(1<<i))
+			bitcounts[i]++;
 
 	*bits = total;
 
@@ -98,7 +105,9 @@ void CL_ParseDelta (entity_state_t *from, entity_state_t *to, int number, int bi
 	VectorCopy (from->origin, to->old_origin);
 	to->number = number;
 
-
+#if PROTOCOL_PACKED_ENTITIES == 1
+	MSG_ReadPackedEntity (&net_message, from, to, bits);
+#else
 	// main model
 	if (bits & U_MODELINDEX_8)
 		to->modelindex = MSG_ReadByte (&net_message);
@@ -200,6 +209,7 @@ void CL_ParseDelta (entity_state_t *from, entity_state_t *to, int number, int bi
 		to->solid = MSG_ReadShort(&net_message);
 #endif
 	}
+#endif
 }
 
 /*
@@ -562,6 +572,114 @@ void CL_FireEntityEvents (frame_t *frame)
 }
 
 
+/*
+=========================================================================
+
+ENTITY ENCODING BENCHMARK
+
+With cl_netbench set, every parsed frame is encoded again against the frame
+it was delta'd from with both the byte and the packed entity encoders.
+Play a demo back to replay its frames, 'netbench' prints the averages.
+
+=========================================================================
+*/
+
+static int	netbench_frames;
+static int	netbench_bytes[2];		// byte encoding, packed encoding
+
+/*
+================
+CL_NetBenchFrame
+================
+*/
+static void CL_NetBenchFrame (frame_t *oldframe, frame_t *newframe)
+{
+	sizebuf_t		buf;
+	byte			data[128];
+	entity_state_t	*oldstate, *newstate, state;
+	int				oldindex, newindex, oldnum, newnum;
+	int				oldcount, maxclients, packed;
+
+	maxclients = atoi (cl.configstrings[CS_MAXCLIENTS]);
+	oldcount = oldframe ? oldframe->num_entities : 0;
+
+	SZ_Init (&buf, data, sizeof(data));
+
+	for (packed = 0; packed < 2; packed++)
+	{
+		netbench_bytes[packed] += 3;	// svc_packetentities and the terminator
+
+		oldindex = newindex = 0;
+		oldstate = newstate = NULL;
+		while (newindex < newframe->num_entities || oldindex < oldcount)
+		{
+			if (newindex >= newframe->num_entities)
+				newnum = 99999;
+			else
+			{
+				newstate = &cl_parse_entities[(newframe->parse_entities+newindex) & (MAX_PARSE_ENTITIES-1)];
+				newnum = newstate->number;
+			}
+
+			if (oldindex >= oldcount)
+				oldnum = 99999;
+			else
+			{
+				oldstate = &cl_parse_entities[(oldframe->parse_entities+oldindex) & (MAX_PARSE_ENTITIES-1)];
+				oldnum = oldstate->number;
+			}
+
+			SZ_Clear (&buf);
+			if (newnum == oldnum)
+			{
+				state = *newstate;		// the encoders may clamp render fields
+				MSG_WriteDeltaEntityFormat (oldstate, &state, &buf, false, newnum <= maxclients, packed);
+				oldindex++;
+				newindex++;
+			}
+			else if (newnum < oldnum)
+			{
+				state = *newstate;
+				MSG_WriteDeltaEntityFormat (&cl_entities[newnum].baseline, &state, &buf, true, true, packed);
+				newindex++;
+			}
+			else
+			{
+				MSG_WriteEntityBitsFormat (&buf, U_REMOVE, oldnum, packed);
+				oldindex++;
+			}
+
+			netbench_bytes[packed] += buf.cursize;
+		}
+	}
+
+	netbench_frames++;
+}
+
+/*
+================
+CL_NetBench_f
+
+Prints and resets the cl_netbench counters
+================
+*/
+void CL_NetBench_f (void)
+{
+	if (!netbench_frames)
+	{
+		Com_Printf ("No frames recorded, set cl_netbench 1 and play a demo.\n");
+		return;
+	}
+
+	Com_Printf ("%i frames\n", netbench_frames);
+	Com_Printf ("byte encoding:   %.1f bytes/frame\n", (float)netbench_bytes[0] / netbench_frames);
+	Com_Printf ("packed encoding: %.1f bytes/frame (%.0f%%)\n", (float)netbench_bytes[1] / netbench_frames,
+		netbench_bytes[0] ? 100.0f * netbench_bytes[1] / netbench_bytes[0] : 0.0f);
+
+	netbench_frames = 0;
+	netbench_bytes[0] = netbench_bytes[1] = 0;
+}
+
 /*
 ================
 CL_ParseFrame
@@ -638,6 +756,9 @@ void CL_ParseFrame (void)
 		Com_Error (ERR_DROP, "CL_ParseFrame: not packetentities");
 	CL_ParsePacketEntities (old, &cl.frame);
 
+	if (cl_netbench->value && cl.frame.valid)
+		CL_NetBenchFrame (old, &cl.frame);
+
 	// save the frame off in the backup array for later delta comparisons
 	cl.frames[cl.frame.serverframe & UPDATE_MASK] = cl.frame;
 
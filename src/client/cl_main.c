@@ -56,6 +56,7 @@ cvar_t	*cl_add_blend;
 cvar_t	*cl_shownet;
 cvar_t	*cl_showmiss;
 cvar_t	*cl_showclamp;
+cvar_t	*cl_netbench;
 
 cvar_t	*cl_paused;
 cvar_t	*cl_timedemo;
@@ -1087,6 +1088,7 @@ void CL_InitLocal (void)
 	cl_shownet = Cvar_Get ("cl_shownet", "0", 0);
 	cl_showmiss = Cvar_Get ("cl_showmiss", "0", 0);
 	cl_showclamp = Cvar_Get ("cl_showclamp", "0", 0);
+	cl_netbench = Cvar_Get ("cl_netbench", "0", 0);
 	cl_timeout = Cvar_Get ("cl_timeout", "120", 0);
 	cl_paused = Cvar_Get ("paused", "0", 0);
 	cl_timedemo = Cvar_Get ("timedemo", "0", 0);
@@ -1116,6 +1118,7 @@ void CL_InitLocal (void)
 #endif
 
 	Cmd_AddCommand("rcon", CL_Rcon_f);
+	Cmd_AddCommand("netbench", CL_NetBench_f);
 
 	Cmd_AddCommand("connect", CL_Connect_f);
 	Cmd_AddCommand("reconnect", CL_Reconnect_f);
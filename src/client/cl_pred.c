@@ -20,6 +20,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "client.h"
 
+cmcontext_t	cl_cmcontext;
+
 
 /*
 ===================
@@ -114,14 +116,14 @@ void CL_ClipMoveToEntities ( vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end,
 			MSG_UnpackSolid16(ent->solid, bmins, bmaxs);
 #endif
 
-			headnode = CM_HeadnodeForBox (bmins, bmaxs);
+			headnode = CM_HeadnodeForBoxCtx (&cl_cmcontext, bmins, bmaxs);
 			angles = vec3_origin;	// boxes don't rotate
 		}
 
 		if (tr->allsolid)
 			return;
 
-		trace = CM_TransformedBoxTrace (start, end, mins, maxs, headnode,  MASK_PLAYERSOLID, ent->origin, angles);
+		trace = CM_TransformedBoxTraceCtx (&cl_cmcontext, start, end, mins, maxs, headnode,  MASK_PLAYERSOLID, ent->origin, angles);
 
 		if (trace.allsolid || trace.startsolid || trace.fraction < tr->fraction)
 		{
@@ -150,7 +152,7 @@ trace_t CL_PMTrace(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end)
 	trace_t	t;
 
 	// check against world
-	t = CM_BoxTrace (start, end, mins, maxs, 0, MASK_PLAYERSOLID);
+	t = CM_BoxTraceCtx (&cl_cmcontext, start, end, mins, maxs, 0, MASK_PLAYERSOLID);
 	if (t.fraction < 1.0)
 	{
 		t.clent = cl.entities;
@@ -172,7 +174,7 @@ int CL_PMpointcontents(vec3_t point)
 	cmodel_t		*cmodel;
 	int			contents;
 
-	contents = CM_PointContents(point, 0);
+	contents = CM_PointContentsCtx(&cl_cmcontext, point, 0);
 
 	for (i=0 ; i<cl.frame.num_entities ; i++)
 	{
@@ -186,7 +188,7 @@ int CL_PMpointcontents(vec3_t point)
 		if (!cmodel)
 			continue;
 
-		contents |= CM_TransformedPointContents (point, cmodel->headnode, ent->origin, ent->angles);
+		contents |= CM_TransformedPointContentsCtx (&cl_cmcontext, point, cmodel->headnode, ent->origin, ent->angles);
 	}
 
 	return contents;
@@ -357,6 +357,9 @@ void CL_PrepRefresh (void)
 	// the renderer can now free unneeded stuff
 	re.EndRegistration ();
 
+	// anything read ahead and not used by now won't be
+	FS_FlushPrefetch ();
+
 	// clear any lines of console text
 	Con_ClearNotify ();
 
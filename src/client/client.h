@@ -291,6 +291,7 @@ extern	cvar_t	*cl_anglespeedkey;
 extern	cvar_t	*cl_shownet;
 extern	cvar_t	*cl_showmiss;
 extern	cvar_t	*cl_showclamp;
+extern	cvar_t	*cl_netbench;
 
 extern	cvar_t	*lookspring;
 extern	cvar_t	*lookstrafe;
@@ -438,6 +439,7 @@ void CL_WidowSplash (vec3_t org);
 int CL_ParseEntityBits (unsigned *bits);
 void CL_ParseDelta (entity_state_t *from, entity_state_t *to, int number, int bits);
 void CL_ParseFrame (void);
+void CL_NetBench_f (void);
 
 void CL_ParseTEnt (void);
 void CL_ParseConfigString (void);
@@ -539,6 +541,8 @@ void CL_SmokeAndFlash(vec3_t origin);
 //
 // cl_pred.c
 //
+extern	cmcontext_t	cl_cmcontext;	// client side collision, so it doesn't share state with the server
+
 void CL_PredictMovement(void);
 void CL_CheckPredictionError (void);
 
@@ -340,6 +340,8 @@ void S_EndRegistration (void)
 	int		i;
 	sfx_t	*sfx;
 	int		size;
+	sfx_t	*load[MAX_SFX];
+	int		count;
 
 	// free any sounds not from this registration sequence
 	for (i=0, sfx=known_sfx ; i < num_sfx ; i++,sfx++)
@@ -363,13 +365,14 @@ void S_EndRegistration (void)
 
 	}
 
-	// load everything in
-	for (i=0, sfx=known_sfx ; i < num_sfx ; i++,sfx++)
+	// load everything in, resampling in parallel
+	for (i=0, count=0, sfx=known_sfx ; i < num_sfx ; i++,sfx++)
 	{
 		if (!sfx->name[0])
 			continue;
-		S_LoadSound (sfx);
+		load[count++] = sfx;
 	}
+	S_LoadSounds (load, count);
 
 	s_registering = false;
 }
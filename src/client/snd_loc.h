@@ -152,6 +152,7 @@ wavinfo_t GetWavinfo (char *name, byte *wav, int wavlength);
 void S_InitScaletable (void);
 
 sfxcache_t *S_LoadSound (sfx_t *s);
+void S_LoadSounds (sfx_t **sfx, int count);
 
 void S_IssuePlaysound (playsound_t *ps);
 
@@ -90,12 +90,21 @@ void ResampleSfx (sfx_t *sfx, int inrate, int inwidth, byte *data)
 
 //=============================================================================
 
+typedef struct
+{
+	sfx_t		*sfx;
+	byte		*data;		// file, freed once resampled
+	wavinfo_t	info;
+} sndload_t;
+
 /*
 ==============
-S_LoadSound
+S_BeginLoadSound
+
+Loads the file and allocates the cache, returns false if there is nothing to resample
 ==============
 */
-sfxcache_t *S_LoadSound (sfx_t *s)
+static qboolean S_BeginLoadSound (sfx_t *s, sndload_t *load)
 {
     char	namebuffer[MAX_QPATH];
 	byte	*data;
@@ -107,12 +116,11 @@ sfxcache_t *S_LoadSound (sfx_t *s)
 	char	*name;
 
 	if (s->name[0] == '*')
-		return NULL;
+		return false;
 
 // see if still in memory
-	sc = s->cache;
-	if (sc)
-		return sc;
+	if (s->cache)
+		return false;
 
 //Com_Printf ("S_LoadSound: %x\n", (int)stackbuf);
 // load it in
@@ -128,12 +136,12 @@ sfxcache_t *S_LoadSound (sfx_t *s)
 
 //	Com_Printf ("loading %s\n",namebuffer);
 
-	size = FS_LoadFile (namebuffer, (void **)&data);
+	size = FS_LoadFileView (namebuffer, (void **)&data);
 
 	if (!data)
 	{
 		Com_DPrintf (DP_SND,"Couldn't load %s\n", namebuffer);
-		return NULL;
+		return false;
 	}
 
 	info = GetWavinfo (s->name, data, size);
@@ -141,7 +149,7 @@ sfxcache_t *S_LoadSound (sfx_t *s)
 	{
 		Com_Printf ("%s is a stereo sample\n",s->name);
 		FS_FreeFile (data);
-		return NULL;
+		return false;
 	}
 
 	stepscale = (float)info.rate / dma.speed;	
@@ -153,7 +161,7 @@ sfxcache_t *S_LoadSound (sfx_t *s)
 	if (!sc)
 	{
 		FS_FreeFile (data);
-		return NULL;
+		return false;
 	}
 	
 	sc->length = info.samples;
@@ -162,11 +170,78 @@ sfxcache_t *S_LoadSound (sfx_t *s)
 	sc->width = info.width;
 	sc->stereo = info.channels;
 
-	ResampleSfx (s, sc->speed, sc->width, data + info.dataofs);
+	load->sfx = s;
+	load->data = data;
+	load->info = info;
+	return true;
+}
+
+/*
+==============
+S_ResampleJob
+==============
+*/
+static void S_ResampleJob (void *data)
+{
+	sndload_t	*load = data;
+
+	ResampleSfx (load->sfx, load->info.rate, load->info.width, load->data + load->info.dataofs);
+}
+
+/*
+==============
+S_LoadSound
+==============
+*/
+sfxcache_t *S_LoadSound (sfx_t *s)
+{
+	sndload_t	load;
+
+	if (!S_BeginLoadSound (s, &load))
+		return s->cache;
+
+	S_ResampleJob (&load);
+	FS_FreeFile (load.data);
+
+	return s->cache;
+}
+
+/*
+==============
+S_LoadSounds
+
+Files are loaded and caches allocated on the calling thread,
+the resampling is spread over the job threads
+==============
+*/
+void S_LoadSounds (sfx_t **sfx, int count)
+{
+	sndload_t	*loads;
+	void		**jobs;
+	int			i, numjobs;
+
+	if (count < 1)
+		return;
+
+	loads = Z_Malloc (count * sizeof(*loads));
+	jobs = Z_Malloc (count * sizeof(*jobs));
+
+	numjobs = 0;
+	for (i = 0; i < count; i++)
+	{
+		if (S_BeginLoadSound (sfx[i], &loads[numjobs]))
+		{
+			jobs[numjobs] = &loads[numjobs];
+			numjobs++;
+		}
+	}
 
-	FS_FreeFile (data);
+	Sys_RunJobs (S_ResampleJob, jobs, numjobs);
 
-	return sc;
+	for (i = 0; i < numjobs; i++)
+		FS_FreeFile (loads[i].data);
+	Z_Free (jobs);
+	Z_Free (loads);
 }
 
 
@@ -0,0 +1,858 @@
+/*
+Copyright (C) 1997-2001 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// net_udp.c -- linux sockets, packets are read with recvmmsg and batched sends go out with sendmmsg
+
+#define _GNU_SOURCE
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <poll.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include "../qcommon/qcommon.h"
+
+#define	MAX_LOOPBACK	4
+
+typedef struct
+{
+	byte	data[MAX_NETMSGLEN+PACKET_HEADER];	// netchan doesn't fragment over loopback
+	int		datalen;
+} loopmsg_t;
+
+typedef struct
+{
+	loopmsg_t	msgs[MAX_LOOPBACK];
+	int			get, send;
+} loopback_t;
+
+#define	NET_BATCH		64
+#define	NET_PACKETSIZE	(MAX_MSGLEN*2)		// netchan fragments anything bigger than MAX_MSGLEN
+
+typedef struct
+{
+	struct mmsghdr			msgs[NET_BATCH];
+	struct iovec			iov[NET_BATCH];
+	struct sockaddr_storage	addr[NET_BATCH];
+	byte					data[NET_BATCH][NET_PACKETSIZE];
+	int						count;		// packets in the batch
+	int						next;		// next packet to hand out (recv)
+	qboolean				active;		// NET_SendPacket queues (send)
+} netbatch_t;
+
+static cvar_t	*net_noudp;
+static cvar_t	*net_ipv6;
+static cvar_t	*net_reuseport;
+
+loopback_t	loopbacks[2];
+int			ip_sockets[2];
+static int	ip_families[2];
+static int	net_epoll = -1;
+static qboolean	net_epollstdin;		// fd 0 is in the epoll set
+
+static netbatch_t	recv_batch[2];
+static netbatch_t	send_batch[2];
+
+char *NET_ErrorString (void);
+
+//=============================================================================
+
+static int NetadrToSockadr (netadr_t *a, struct sockaddr_storage *s, int family)
+{
+	struct sockaddr_in	*s4;
+	struct sockaddr_in6	*s6;
+
+	memset (s, 0, sizeof(*s));
+
+	if (a->type == NA_IP6)
+	{
+		s6 = (struct sockaddr_in6 *)s;
+		s6->sin6_family = AF_INET6;
+		memcpy (&s6->sin6_addr, a->ip6, 16);
+		s6->sin6_port = a->port;
+		s6->sin6_scope_id = a->scope_id;
+		return sizeof(*s6);
+	}
+
+	if (family == AF_INET6)
+	{	// ipv4 through a dual stack socket
+		s6 = (struct sockaddr_in6 *)s;
+		s6->sin6_family = AF_INET6;
+		s6->sin6_addr.s6_addr[10] = 0xff;
+		s6->sin6_addr.s6_addr[11] = 0xff;
+		if (a->type == NA_BROADCAST)
+			memset (&s6->sin6_addr.s6_addr[12], 0xff, 4);
+		else
+			memcpy (&s6->sin6_addr.s6_addr[12], a->ip, 4);
+		s6->sin6_port = a->port;
+		return sizeof(*s6);
+	}
+
+	s4 = (struct sockaddr_in *)s;
+	s4->sin_family = AF_INET;
+	s4->sin_port = a->port;
+	if (a->type == NA_BROADCAST)
+		s4->sin_addr.s_addr = INADDR_BROADCAST;
+	else
+		memcpy (&s4->sin_addr, a->ip, 4);
+	return sizeof(*s4);
+}
+
+static void SockadrToNetadr (struct sockaddr_storage *s, netadr_t *a)
+{
+	struct sockaddr_in6	*s6;
+
+	memset (a, 0, sizeof(*a));
+
+	if (s->ss_family == AF_INET)
+	{
+		a->type = NA_IP;
+		memcpy (a->ip, &((struct sockaddr_in *)s)->sin_addr, 4);
+		a->port = ((struct sockaddr_in *)s)->sin_port;
+	}
+	else if (s->ss_family == AF_INET6)
+	{
+		s6 = (struct sockaddr_in6 *)s;
+		if (IN6_IS_ADDR_V4MAPPED (&s6->sin6_addr))
+		{
+			a->type = NA_IP;
+			memcpy (a->ip, &s6->sin6_addr.s6_addr[12], 4);
+		}
+		else
+		{
+			a->type = NA_IP6;
+			memcpy (a->ip6, &s6->sin6_addr, 16);
+			a->scope_id = s6->sin6_scope_id;
+		}
+		a->port = s6->sin6_port;
+	}
+}
+
+qboolean	NET_CompareAdr (netadr_t a, netadr_t b)
+{
+	if (!NET_CompareBaseAdr (a, b))
+		return false;
+
+	if (a.type == NA_LOOPBACK)
+		return true;
+
+	return a.port == b.port;
+}
+
+/*
+===================
+NET_CompareBaseAdr
+
+Compares without the port
+===================
+*/
+qboolean	NET_CompareBaseAdr (netadr_t a, netadr_t b)
+{
+	if (a.type != b.type)
+		return false;
+
+	if (a.type == NA_LOOPBACK)
+		return true;
+
+	if (a.type == NA_IP)
+		return !memcmp (a.ip, b.ip, 4);
+
+	if (a.type == NA_IP6)
+		return !memcmp (a.ip6, b.ip6, 16) && a.scope_id == b.scope_id;
+
+	return false;
+}
+
+char	*NET_AdrToString (netadr_t a)
+{
+	static	char	s[64];
+	char	addr[INET6_ADDRSTRLEN];
+
+	if (a.type == NA_LOOPBACK)
+		Com_sprintf (s, sizeof(s), "loopback");
+	else if (a.type == NA_IP6)
+	{
+		inet_ntop (AF_INET6, a.ip6, addr, sizeof(addr));
+		Com_sprintf (s, sizeof(s), "[%s]:%i", addr, ntohs(a.port));
+	}
+	else
+		Com_sprintf (s, sizeof(s), "%i.%i.%i.%i:%i", a.ip[0], a.ip[1], a.ip[2], a.ip[3], ntohs(a.port));
+	return s;
+}
+
+
+/*
+=============
+NET_StringToSockaddr
+
+localhost
+idnewt
+idnewt:28000
+192.246.40.70
+192.246.40.70:28000
+::1
+[::1]:28000
+=============
+*/
+static qboolean	NET_StringToSockaddr (char *s, struct sockaddr_storage *sadr)
+{
+	struct addrinfo	hints, *res;
+	char	copy[128];
+	char	*host, *port, *colon;
+
+	memset (sadr, 0, sizeof(*sadr));
+
+	strncpy (copy, s, sizeof(copy)-1);
+	copy[sizeof(copy)-1] = 0;
+	host = copy;
+	port = NULL;
+
+	if (copy[0] == '[')
+	{	// [ipv6]:port
+		host = copy + 1;
+		colon = strchr (host, ']');
+		if (!colon)
+			return false;
+		*colon = 0;
+		if (colon[1] == ':')
+			port = colon + 2;
+	}
+	else
+	{	// a single colon separates the port, more make it an ipv6 address
+		colon = strchr (copy, ':');
+		if (colon && !strchr (colon + 1, ':'))
+		{
+			*colon = 0;
+			port = colon + 1;
+		}
+	}
+
+	memset (&hints, 0, sizeof(hints));
+	hints.ai_family = net_ipv6 && net_ipv6->value ? AF_UNSPEC : AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+
+	if (getaddrinfo (host, NULL, &hints, &res) || !res)
+		return false;
+
+	memcpy (sadr, res->ai_addr, res->ai_addrlen);
+	freeaddrinfo (res);
+
+	if (port)
+	{
+		if (sadr->ss_family == AF_INET6)
+			((struct sockaddr_in6 *)sadr)->sin6_port = htons((short)atoi(port));
+		else
+			((struct sockaddr_in *)sadr)->sin_port = htons((short)atoi(port));
+	}
+
+	return true;
+}
+
+/*
+=============
+NET_StringToAdr
+=============
+*/
+qboolean	NET_StringToAdr (char *s, netadr_t *a)
+{
+	struct sockaddr_storage sadr;
+
+	if (!strcmp (s, "localhost"))
+	{
+		memset (a, 0, sizeof(*a));
+		a->type = NA_LOOPBACK;
+		return true;
+	}
+
+	if (!NET_StringToSockaddr (s, &sadr))
+		return false;
+
+	SockadrToNetadr (&sadr, a);
+
+	return true;
+}
+
+
+qboolean	NET_IsLocalAddress (netadr_t adr)
+{
+	return adr.type == NA_LOOPBACK;
+}
+
+/*
+=============================================================================
+
+LOOPBACK BUFFERS FOR LOCAL PLAYER
+
+=============================================================================
+*/
+
+qboolean	NET_GetLoopPacket (netsrc_t sock, netadr_t *netFrom, sizebuf_t *netMessage)
+{
+	int		i;
+	loopback_t	*loop;
+
+	loop = &loopbacks[sock];
+
+	if (loop->send - loop->get > MAX_LOOPBACK)
+		loop->get = loop->send - MAX_LOOPBACK;
+
+	if (loop->get >= loop->send)
+		return false;
+
+	i = loop->get & (MAX_LOOPBACK-1);
+	loop->get++;
+
+	memcpy (netMessage->data, loop->msgs[i].data, loop->msgs[i].datalen);
+	netMessage->cursize = loop->msgs[i].datalen;
+	memset (netFrom, 0, sizeof(*netFrom));
+	netFrom->type = NA_LOOPBACK;
+	return true;
+
+}
+
+
+void NET_SendLoopPacket (netsrc_t sock, int length, void *data)
+{
+	int		i;
+	loopback_t	*loop;
+
+	loop = &loopbacks[sock^1];
+
+	i = loop->send & (MAX_LOOPBACK-1);
+	loop->send++;
+
+	memcpy (loop->msgs[i].data, data, length);
+	loop->msgs[i].datalen = length;
+}
+
+//=============================================================================
+
+/*
+====================
+NET_ResetBatch
+
+Points every message of the batch at its own buffer and address
+====================
+*/
+static void NET_ResetBatch (netbatch_t *b)
+{
+	int		i;
+
+	for (i = 0; i < NET_BATCH; i++)
+	{
+		b->iov[i].iov_base = b->data[i];
+		b->iov[i].iov_len = NET_PACKETSIZE;
+		memset (&b->msgs[i].msg_hdr, 0, sizeof(b->msgs[i].msg_hdr));
+		b->msgs[i].msg_hdr.msg_name = &b->addr[i];
+		b->msgs[i].msg_hdr.msg_namelen = sizeof(b->addr[i]);
+		b->msgs[i].msg_hdr.msg_iov = &b->iov[i];
+		b->msgs[i].msg_hdr.msg_iovlen = 1;
+		b->msgs[i].msg_len = 0;
+	}
+	b->count = 0;
+	b->next = 0;
+}
+
+/*
+====================
+NET_GetPacket
+
+Hands out the packets of the last recvmmsg, one call drains up to NET_BATCH
+====================
+*/
+qboolean	NET_GetPacket (netsrc_t sock, netadr_t *netFrom, sizebuf_t *netmessage)
+{
+	netbatch_t	*b;
+	int			ret, len;
+
+	if (NET_GetLoopPacket (sock, netFrom, netmessage))
+		return true;
+
+	if (!ip_sockets[sock])
+		return false;
+
+	b = &recv_batch[sock];
+	while (1)
+	{
+		if (b->next >= b->count)
+		{
+			NET_ResetBatch (b);
+			ret = recvmmsg (ip_sockets[sock], b->msgs, NET_BATCH, MSG_DONTWAIT, NULL);
+			if (ret == -1)
+			{
+				if (errno == EWOULDBLOCK || errno == ECONNREFUSED)
+					return false;
+				if (dedicated->value)	// let dedicated servers continue after errors
+					Com_Printf ("NET_GetPacket: %s\n", NET_ErrorString());
+				else
+					Com_Error (ERR_DROP, "NET_GetPacket: %s", NET_ErrorString());
+				return false;
+			}
+			if (!ret)
+				return false;
+			b->count = ret;
+		}
+
+		SockadrToNetadr (&b->addr[b->next], netFrom);
+		len = b->msgs[b->next].msg_len;
+
+		if ((b->msgs[b->next].msg_hdr.msg_flags & MSG_TRUNC) || len > netmessage->maxsize)
+		{
+			Com_Printf ("Oversize packet from %s\n", NET_AdrToString (*netFrom));
+			b->next++;
+			continue;
+		}
+
+		memcpy (netmessage->data, b->data[b->next], len);
+		netmessage->cursize = len;
+		b->next++;
+		return true;
+	}
+}
+
+//=============================================================================
+
+static void NET_SendError (netadr_t to)
+{
+	int		err;
+
+	err = errno;
+
+	// wouldblock is silent
+	if (err == EWOULDBLOCK)
+		return;
+
+	// some PPP links dont allow broadcasts
+	if ((err == EADDRNOTAVAIL) && (to.type == NA_BROADCAST))
+		return;
+
+	if (dedicated->value)	// let dedicated servers continue after errors
+	{
+		Com_Printf ("NET_SendPacket ERROR: %s to %s\n", NET_ErrorString(), NET_AdrToString (to));
+	}
+	else
+	{
+		if (err == EADDRNOTAVAIL || err == ENETUNREACH)
+		{
+			Com_DPrintf (DP_NET, "NET_SendPacket Warning: %s : %s\n", NET_ErrorString(), NET_AdrToString (to));
+		}
+		else
+		{
+			Com_Error (ERR_DROP, "NET_SendPacket ERROR: %s\n", NET_ErrorString());
+		}
+	}
+}
+
+/*
+====================
+NET_FlushBatch
+
+Sends the queued datagrams with as few sendmmsg calls as the kernel allows
+====================
+*/
+void NET_FlushBatch (netsrc_t sock)
+{
+	netbatch_t	*b;
+	int			sent, ret;
+	netadr_t	to;
+
+	b = &send_batch[sock];
+	b->active = false;
+
+	sent = 0;
+	while (sent < b->count && ip_sockets[sock])
+	{
+		ret = sendmmsg (ip_sockets[sock], b->msgs + sent, b->count - sent, 0);
+		if (ret == -1)
+		{	// report the one that failed and go on with the rest
+			SockadrToNetadr (&b->addr[sent], &to);
+			NET_SendError (to);
+			ret = 1;
+		}
+		sent += ret;
+	}
+
+	b->count = 0;
+}
+
+/*
+====================
+NET_BeginBatch
+
+NET_SendPacket queues datagrams for sock until NET_FlushBatch
+====================
+*/
+void NET_BeginBatch (netsrc_t sock)
+{
+	netbatch_t	*b;
+
+	b = &send_batch[sock];
+	if (b->active)
+		return;
+
+	NET_ResetBatch (b);
+	b->active = true;
+}
+
+void NET_SendPacket (netsrc_t sock, int length, void *data, netadr_t to)
+{
+	int		ret, addrlen;
+	struct sockaddr_storage	addr;
+	netbatch_t	*b;
+
+	if ( to.type == NA_LOOPBACK )
+	{
+		NET_SendLoopPacket (sock, length, data);
+		return;
+	}
+
+	if (to.type != NA_BROADCAST && to.type != NA_IP && to.type != NA_IP6)
+		Com_Error (ERR_FATAL, "NET_SendPacket: bad address type");
+
+	if (!ip_sockets[sock])
+		return;
+
+	if (to.type == NA_IP6 && ip_families[sock] != AF_INET6)
+		return;		// no ipv6 socket
+
+	b = &send_batch[sock];
+	if (b->active && length <= NET_PACKETSIZE)
+	{
+		if (b->count == NET_BATCH)
+		{
+			NET_FlushBatch (sock);
+			NET_BeginBatch (sock);
+		}
+
+		memcpy (b->data[b->count], data, length);
+		b->iov[b->count].iov_len = length;
+		b->msgs[b->count].msg_hdr.msg_namelen = NetadrToSockadr (&to, &b->addr[b->count], ip_families[sock]);
+		b->count++;
+		return;
+	}
+
+	addrlen = NetadrToSockadr (&to, &addr, ip_families[sock]);
+
+	ret = sendto (ip_sockets[sock], data, length, 0, (struct sockaddr *)&addr, addrlen);
+	if (ret == -1)
+		NET_SendError (to);
+}
+
+
+//=============================================================================
+
+
+/*
+====================
+NET_IPSocket
+
+Opens a dual stack ipv6 socket when net_ipv6 is set and the system has ipv6,
+an ipv4 one otherwise
+====================
+*/
+int NET_IPSocket (char *net_interface, int port, int *family)
+{
+	int					newsocket;
+	struct sockaddr_storage	address;
+	int					i = 1;
+	int					off = 0;
+
+	*family = AF_INET;
+	newsocket = -1;
+
+	if (net_ipv6->value)
+	{
+		newsocket = socket (PF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+		if (newsocket != -1)
+		{
+			*family = AF_INET6;
+			if (setsockopt (newsocket, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off)) == -1)
+				Com_Printf ("WARNING: UDP_OpenSocket: setsockopt IPV6_V6ONLY: %s\n", NET_ErrorString());
+		}
+	}
+
+	if (newsocket == -1)
+	{
+		*family = AF_INET;
+		if ((newsocket = socket (PF_INET, SOCK_DGRAM, IPPROTO_UDP)) == -1)
+		{
+			Com_Printf ("WARNING: UDP_OpenSocket: socket: %s\n", NET_ErrorString());
+			return 0;
+		}
+	}
+
+	// make it non-blocking
+	if (fcntl (newsocket, F_SETFL, fcntl (newsocket, F_GETFL, 0) | O_NONBLOCK) == -1)
+	{
+		Com_Printf ("WARNING: UDP_OpenSocket: fcntl O_NONBLOCK: %s\n", NET_ErrorString());
+		close (newsocket);
+		return 0;
+	}
+
+	// make it broadcast capable
+	if (setsockopt (newsocket, SOL_SOCKET, SO_BROADCAST, &i, sizeof(i)) == -1)
+	{
+		Com_Printf ("WARNING: UDP_OpenSocket: setsockopt SO_BROADCAST: %s\n", NET_ErrorString());
+		close (newsocket);
+		return 0;
+	}
+
+	// several server processes can share the port, the kernel keeps each client on one of them
+	if (net_reuseport->value && setsockopt (newsocket, SOL_SOCKET, SO_REUSEPORT, &i, sizeof(i)) == -1)
+		Com_Printf ("WARNING: UDP_OpenSocket: setsockopt SO_REUSEPORT: %s\n", NET_ErrorString());
+
+	memset (&address, 0, sizeof(address));
+	if (net_interface && net_interface[0] && Q_stricmp(net_interface, "localhost"))
+	{
+		if (!NET_StringToSockaddr (net_interface, &address))
+		{
+			Com_Printf ("WARNING: UDP_OpenSocket: bad interface address %s\n", net_interface);
+			close (newsocket);
+			return 0;
+		}
+	}
+
+	if (*family == AF_INET6)
+	{
+		if (address.ss_family == AF_INET)
+		{	// an ipv4 interface on the dual stack socket
+			netadr_t	a;
+
+			SockadrToNetadr (&address, &a);
+			NetadrToSockadr (&a, &address, AF_INET6);
+		}
+		address.ss_family = AF_INET6;
+		((struct sockaddr_in6 *)&address)->sin6_port = port == PORT_ANY ? 0 : htons((short)port);
+		i = sizeof(struct sockaddr_in6);
+	}
+	else
+	{
+		address.ss_family = AF_INET;
+		((struct sockaddr_in *)&address)->sin_port = port == PORT_ANY ? 0 : htons((short)port);
+		i = sizeof(struct sockaddr_in);
+	}
+
+	if (bind (newsocket, (struct sockaddr *)&address, i) == -1)
+	{
+		Com_Printf ("WARNING: UDP_OpenSocket: bind: %s\n", NET_ErrorString());
+		close (newsocket);
+		return 0;
+	}
+
+	return newsocket;
+}
+
+
+/*
+====================
+NET_OpenIP
+====================
+*/
+void NET_OpenIP (void)
+{
+	cvar_t	*ip;
+	int		port;
+	int		isdedicated;
+	struct epoll_event	ev;
+
+	ip = Cvar_Get ("ip", "localhost", CVAR_NOSET);
+
+	isdedicated = Cvar_VariableValue ("dedicated");
+
+	if (!ip_sockets[NS_SERVER])
+	{
+		port = Cvar_Get("ip_hostport", "0", CVAR_NOSET)->value;
+		if (!port)
+		{
+			port = Cvar_Get("hostport", "0", CVAR_NOSET)->value;
+			if (!port)
+			{
+				port = Cvar_Get("port", va("%i", PORT_SERVER), CVAR_NOSET)->value;
+			}
+		}
+		ip_sockets[NS_SERVER] = NET_IPSocket (ip->string, port, &ip_families[NS_SERVER]);
+		if (!ip_sockets[NS_SERVER] && isdedicated)
+			Com_Error (ERR_FATAL, "Couldn't allocate dedicated server IP port");
+
+		// NET_Sleep waits on the server socket
+		if (ip_sockets[NS_SERVER])
+		{
+			net_epoll = epoll_create1 (0);
+			if (net_epoll == -1)
+				Com_Printf ("WARNING: epoll_create1: %s\n", NET_ErrorString());
+			else
+			{
+				memset (&ev, 0, sizeof(ev));
+				ev.events = EPOLLIN;
+				ev.data.fd = ip_sockets[NS_SERVER];
+				epoll_ctl (net_epoll, EPOLL_CTL_ADD, ip_sockets[NS_SERVER], &ev);
+				net_epollstdin = false;
+			}
+		}
+	}
+
+
+	// dedicated servers don't need client ports
+	if (isdedicated)
+		return;
+
+	if (!ip_sockets[NS_CLIENT])
+	{
+		port = Cvar_Get("ip_clientport", "0", CVAR_NOSET)->value;
+		if (!port)
+		{
+			port = Cvar_Get("clientport", va("%i", PORT_CLIENT), CVAR_NOSET)->value;
+			if (!port)
+				port = PORT_ANY;
+		}
+		ip_sockets[NS_CLIENT] = NET_IPSocket (ip->string, port, &ip_families[NS_CLIENT]);
+		if (!ip_sockets[NS_CLIENT])
+			ip_sockets[NS_CLIENT] = NET_IPSocket (ip->string, PORT_ANY, &ip_families[NS_CLIENT]);
+	}
+}
+
+
+/*
+====================
+NET_Config
+
+A single player game will only use the loopback code
+====================
+*/
+void NET_Config (qboolean multiplayer)
+{
+	int		i;
+	static	qboolean	old_config;
+
+	if (old_config == multiplayer)
+		return;
+
+	old_config = multiplayer;
+
+	if (!multiplayer)
+	{	// shut down any existing sockets
+		for (i=0 ; i<2 ; i++)
+		{
+			if (ip_sockets[i])
+			{
+				NET_FlushBatch (i);
+				close (ip_sockets[i]);
+				ip_sockets[i] = 0;
+			}
+			recv_batch[i].count = recv_batch[i].next = 0;
+		}
+
+		if (net_epoll != -1)
+		{
+			close (net_epoll);
+			net_epoll = -1;
+		}
+	}
+	else
+	{	// open sockets
+		if (! net_noudp->value)
+			NET_OpenIP ();
+	}
+}
+
+/*
+====================
+NET_Sleep
+
+Sleeps msec or until the server socket or console input is readable
+====================
+*/
+void NET_Sleep(int msec)
+{
+	struct epoll_event	ev;
+	struct pollfd		pfd;
+	extern cvar_t *dedicated;
+	extern qboolean stdin_active;
+
+	if (!dedicated || !dedicated->value)
+		return; // we're not a server, just run full speed
+
+	if (msec <= 0)
+		return;
+
+	if (recv_batch[NS_SERVER].next < recv_batch[NS_SERVER].count)
+		return;	// packets from the last recvmmsg are still waiting
+
+	if (net_epoll == -1)
+	{	// no server socket before the first map
+		pfd.fd = 0;
+		pfd.events = POLLIN;
+		poll (&pfd, stdin_active ? 1 : 0, msec);
+		return;
+	}
+
+	// stdin is dropped once it is closed, it would always be readable
+	if (net_epollstdin != stdin_active)
+	{
+		memset (&ev, 0, sizeof(ev));
+		ev.events = EPOLLIN;
+		ev.data.fd = 0;
+		epoll_ctl (net_epoll, stdin_active ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, 0, &ev);
+		net_epollstdin = stdin_active;
+	}
+
+	epoll_wait (net_epoll, &ev, 1, msec);
+}
+
+//===================================================================
+
+
+/*
+====================
+NET_Init
+====================
+*/
+void NET_Init (void)
+{
+	net_noudp = Cvar_Get ("net_noudp", "0", CVAR_NOSET);
+	net_ipv6 = Cvar_Get ("net_ipv6", "1", CVAR_NOSET);
+	net_reuseport = Cvar_Get ("net_reuseport", "0", CVAR_NOSET);
+}
+
+
+/*
+====================
+NET_Shutdown
+====================
+*/
+void NET_Shutdown (void)
+{
+	NET_Config (false);	// close sockets
+}
+
+
+/*
+====================
+NET_ErrorString
+====================
+*/
+char *NET_ErrorString (void)
+{
+	return strerror (errno);
+}
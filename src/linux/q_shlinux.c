@@ -0,0 +1,337 @@
+/*
+Copyright (C) 1997-2001 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// q_shlinux.c -- linux counterpart of q_shwin.c
+
+#define _GNU_SOURCE
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <fnmatch.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <time.h>
+
+#include "../qcommon/qcommon.h"
+
+//===============================================================================
+
+int		hunkcount;
+
+
+byte	*membase;
+int		hunkmaxsize;
+int		cursize;
+
+void *Hunk_Begin (int maxsize)
+{
+	// reserve a huge chunk of memory, large callocs are mapped
+	// zero pages that only get committed when touched
+	cursize = 0;
+	hunkmaxsize = maxsize;
+	membase = calloc (1, maxsize);
+	if (!membase)
+		Sys_Error ("Hunk_Begin: reserve failed");
+	return (void *)membase;
+}
+
+void *Hunk_Alloc (int size)
+{
+	// round to cacheline
+	size = (size+31)&~31;
+
+	cursize += size;
+	if (cursize > hunkmaxsize)
+		Sys_Error ("Hunk_Alloc overflow");
+
+	return (void *)(membase+cursize-size);
+}
+
+int Hunk_End (void)
+{
+	hunkcount++;
+	return cursize;
+}
+
+void Hunk_Free (void *base)
+{
+	if ( base )
+		free (base);
+
+	hunkcount--;
+}
+
+//===============================================================================
+
+
+/*
+================
+Sys_Milliseconds
+================
+*/
+int	curtime;
+int Sys_Milliseconds (void)
+{
+	struct timespec	ts;
+	static time_t	base;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+
+	if (!base)
+		base = ts.tv_sec;
+
+	curtime = (int)((ts.tv_sec - base) * 1000 + ts.tv_nsec / 1000000);
+
+	return curtime;
+}
+
+void Sys_Mkdir (char *path)
+{
+	mkdir (path, 0777);
+}
+
+//============================================
+
+#define	MAX_JOB_THREADS	16
+
+static int		job_numthreads = -1;	// not including the main thread
+static sem_t	job_start[MAX_JOB_THREADS];
+static sem_t	job_done;
+
+static void		(*job_func)(void *data);
+static void		**job_data;
+static int		job_count;
+static volatile int	job_next;
+
+static void Sys_DoJobs (void)
+{
+	int		i;
+
+	while ((i = __sync_fetch_and_add (&job_next, 1)) < job_count)
+		job_func (job_data[i]);
+}
+
+static void *Sys_JobThread (void *arg)
+{
+	int		n = (int)(intptr_t)arg;
+
+	while (1)
+	{
+		while (sem_wait (&job_start[n]) == -1 && errno == EINTR)
+			;
+		Sys_DoJobs ();
+		sem_post (&job_done);
+	}
+	return NULL;
+}
+
+static void Sys_InitJobThreads (void)
+{
+	pthread_t	thread;
+	int			i;
+
+	job_numthreads = sysconf (_SC_NPROCESSORS_ONLN) - 1;
+	if (job_numthreads > MAX_JOB_THREADS)
+		job_numthreads = MAX_JOB_THREADS;
+
+	sem_init (&job_done, 0, 0);
+	for (i = 0; i < job_numthreads; i++)
+	{
+		sem_init (&job_start[i], 0, 0);
+		if (pthread_create (&thread, NULL, Sys_JobThread, (void *)(intptr_t)i))
+		{
+			Com_Printf ("Sys_InitJobThreads: couldn't create worker thread %i\n", i);
+			break;
+		}
+		pthread_detach (thread);
+	}
+	job_numthreads = i;
+}
+
+/*
+================
+Sys_RunJobs
+================
+*/
+void Sys_RunJobs (void (*func)(void *data), void **data, int count)
+{
+	int		i, numthreads;
+
+	if (job_numthreads == -1)
+		Sys_InitJobThreads ();
+
+	numthreads = count - 1;
+	if (numthreads > job_numthreads)
+		numthreads = job_numthreads;
+
+	if (numthreads <= 0)
+	{
+		for (i = 0; i < count; i++)
+			func (data[i]);
+		return;
+	}
+
+	job_func = func;
+	job_data = data;
+	job_count = count;
+	job_next = 0;
+	__sync_synchronize ();
+
+	for (i = 0; i < numthreads; i++)
+		sem_post (&job_start[i]);
+
+	Sys_DoJobs ();
+
+	for (i = 0; i < numthreads; i++)
+		while (sem_wait (&job_done) == -1 && errno == EINTR)
+			;
+}
+
+//============================================
+
+/*
+================
+Sys_MapFile
+================
+*/
+void *Sys_MapFile (char *path, int *length)
+{
+	struct stat	st;
+	void		*base;
+	int			fd;
+
+	fd = open (path, O_RDONLY);
+	if (fd == -1)
+		return NULL;
+
+	if (fstat (fd, &st) == -1 || st.st_size <= 0 || st.st_size > 0x7fffffff)
+	{
+		close (fd);
+		return NULL;
+	}
+
+	// the mapping stays valid after the descriptor is closed
+	base = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close (fd);
+	if (base == MAP_FAILED)
+		return NULL;
+
+	*length = (int)st.st_size;
+	return base;
+}
+
+/*
+================
+Sys_UnmapFile
+================
+*/
+void Sys_UnmapFile (void *base, int length)
+{
+	munmap (base, length);
+}
+
+//============================================
+
+static char	findbase[MAX_OSPATH];
+static char	findpath[MAX_OSPATH];
+static char	findpattern[MAX_OSPATH];
+static DIR	*fdir;
+
+static qboolean CompareAttributes (char *path, unsigned musthave, unsigned canthave)
+{
+	struct stat st;
+
+	if (stat (path, &st) == -1)
+		return false;
+
+	if ( ( st.st_mode & S_IFDIR ) && ( canthave & SFF_SUBDIR ) )
+		return false;
+
+	if ( ( musthave & SFF_SUBDIR ) && !( st.st_mode & S_IFDIR ) )
+		return false;
+
+	return true;
+}
+
+char *Sys_FindFirst (char *path, unsigned musthave, unsigned canthave)
+{
+	char	*p;
+
+	if (fdir)
+		Sys_Error ("Sys_BeginFind without close");
+
+	p = strrchr (path, '/');
+	if (p)
+	{
+		Com_sprintf (findbase, sizeof(findbase), "%s", path);
+		findbase[p - path] = 0;
+		Com_sprintf (findpattern, sizeof(findpattern), "%s", p + 1);
+	}
+	else
+	{
+		strcpy (findbase, ".");
+		Com_sprintf (findpattern, sizeof(findpattern), "%s", path);
+	}
+
+	if (!strcmp (findpattern, "*.*"))
+		strcpy (findpattern, "*");
+
+	fdir = opendir (findbase);
+	if (!fdir)
+		return NULL;
+
+	return Sys_FindNext (musthave, canthave);
+}
+
+char *Sys_FindNext (unsigned musthave, unsigned canthave)
+{
+	struct dirent *d;
+
+	if (!fdir)
+		return NULL;
+
+	while ((d = readdir (fdir)) != NULL)
+	{
+		// . and .. never match
+		if (!strcmp (d->d_name, ".") || !strcmp (d->d_name, ".."))
+			continue;
+
+		if (!*findpattern || !fnmatch (findpattern, d->d_name, 0))
+		{
+			Com_sprintf (findpath, sizeof(findpath), "%s/%s", findbase, d->d_name);
+			if (CompareAttributes (findpath, musthave, canthave))
+				return findpath;
+		}
+	}
+	return NULL;
+}
+
+void Sys_FindClose (void)
+{
+	if (fdir)
+		closedir (fdir);
+	fdir = NULL;
+}
+
+
+//============================================
@@ -0,0 +1,221 @@
+/*
+Copyright (C) 1997-2001 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// sys_linux.c -- headless dedicated server system driver
+
+#define _GNU_SOURCE
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+
+#include "../qcommon/qcommon.h"
+
+unsigned	sys_frame_time;
+
+qboolean	stdin_active = true;	// NET_Sleep wakes up on console input
+
+static volatile sig_atomic_t	sys_signal;	// set by Sys_Signal, the main loop quits
+
+/*
+===============================================================================
+
+SYSTEM IO
+
+===============================================================================
+*/
+
+void Sys_Error (char *error, ...)
+{
+	va_list		argptr;
+	char		text[1024];
+
+	// change stdin back to blocking so the shell isn't left in a bad state
+	fcntl (0, F_SETFL, fcntl (0, F_GETFL, 0) & ~O_NONBLOCK);
+
+	CL_Shutdown ();
+	Qcommon_Shutdown ();
+
+	va_start (argptr, error);
+	vsnprintf (text, sizeof(text), error, argptr);
+	va_end (argptr);
+
+	fprintf (stderr, "Error: %s\n", text);
+
+	exit (1);
+}
+
+void Sys_Quit (void)
+{
+	fcntl (0, F_SETFL, fcntl (0, F_GETFL, 0) & ~O_NONBLOCK);
+
+	CL_Shutdown ();
+	Qcommon_Shutdown ();
+
+	exit (0);
+}
+
+/*
+================
+Sys_Signal
+
+Only async signal safe things can be done here, the main loop
+shuts down once it wakes up from NET_Sleep
+================
+*/
+static void Sys_Signal (int sig)
+{
+	sys_signal = sig;
+}
+
+void Sys_Init (void)
+{
+	struct sigaction	sa;
+
+	// no SA_RESTART, so the signal interrupts NET_Sleep
+	memset (&sa, 0, sizeof(sa));
+	sa.sa_handler = Sys_Signal;
+	sigemptyset (&sa.sa_mask);
+	sigaction (SIGHUP, &sa, NULL);
+	sigaction (SIGINT, &sa, NULL);
+	sigaction (SIGTERM, &sa, NULL);
+	signal (SIGPIPE, SIG_IGN);
+
+	// commands are read from stdin without blocking the server
+	fcntl (0, F_SETFL, fcntl (0, F_GETFL, 0) | O_NONBLOCK);
+}
+
+/*
+================
+Sys_ConsoleInput
+
+Returns a complete line from stdin or NULL
+================
+*/
+char *Sys_ConsoleInput (void)
+{
+	static char	text[256];
+	static int	len;
+	int			r;
+	char		c;
+
+	if (!dedicated || !dedicated->value || !stdin_active)
+		return NULL;
+
+	while (1)
+	{
+		r = read (0, &c, 1);
+		if (r == 0)
+		{	// stdin was closed, running in the background
+			stdin_active = false;
+			return NULL;
+		}
+		if (r == -1)
+		{
+			if (errno != EAGAIN && errno != EINTR)
+				stdin_active = false;
+			return NULL;
+		}
+
+		if (c == '\n')
+		{
+			text[len] = 0;
+			len = 0;
+			return text;
+		}
+
+		if (c != '\r' && len < sizeof(text) - 1)
+			text[len++] = c;
+	}
+}
+
+void Sys_ConsoleOutput (char *string)
+{
+	if (!dedicated || !dedicated->value)
+		return;
+
+	fputs (string, stdout);
+	fflush (stdout);
+}
+
+void Sys_SendKeyEvents (void)
+{
+	// grab frame time
+	sys_frame_time = Sys_Milliseconds ();
+}
+
+void Sys_AppActivate (void)
+{
+}
+
+char *Sys_GetClipboardData (void)
+{
+	return NULL;
+}
+
+void Sys_UnloadGame (void)
+{
+}
+
+void *Sys_GetGameAPI (void *parms)
+{
+	return NULL;
+}
+
+//=============================================================================
+
+/*
+==================
+main
+
+Between frames the server sleeps in NET_Sleep until the next frame is due,
+a packet or console input arrives or a signal is caught
+==================
+*/
+int main (int argc, char **argv)
+{
+	int		time, oldtime, newtime, wait;
+
+	Qcommon_Init (argc, argv);
+
+	oldtime = Sys_Milliseconds ();
+	while (1)
+	{
+		if (sys_signal)
+		{
+			Com_Printf ("Received signal %d, exiting...\n", (int)sys_signal);
+			Sys_Quit ();
+		}
+
+		newtime = Sys_Milliseconds ();
+		time = newtime - oldtime;
+		if (time < 1)
+		{	// frames run on whole milliseconds
+			wait = SV_FrameWait ();
+			NET_Sleep (wait > 1 ? wait : 1);
+			continue;
+		}
+
+		Qcommon_Frame (time);
+
+		oldtime = newtime;
+	}
+
+	return 0;
+}
@@ -36,7 +36,7 @@ void Cmd_ForwardToServer (void)
 	Com_Printf ("Unknown command \"%s\"\n", cmd);
 }
 
-void SCR_DebugGraph (float value, int color)
+void SCR_DebugGraph (float value, vec3_t color)
 {
 }
 
@@ -53,3 +53,57 @@ void Key_Init (void)
 	Cmd_AddCommand ("bind", Key_Bind_Null_f);
 }
 
+
+void UI_DrawString (int x, int y, int alignx, char *string)
+{
+}
+
+/*
+==============================================================================
+
+CLIENT GAME BUILTINS
+
+Builtins are numbered in registration order across all vms, the client
+ones still have to take their slots so server progs match a full build
+
+==============================================================================
+*/
+
+static void PFCG_Null (void)
+{
+	Scr_RunError ("client builtin called on a dedicated server\n");
+}
+
+void PFCG_AngleVectors (void)
+{
+	PFCG_Null ();
+}
+
+void CG_InitScriptBuiltins (void)
+{
+	// keep in sync with cgame/cg_builtins.c
+	static char *builtins[][2] =
+	{
+		{ "pointcontents", "float(vector v)" },
+		{ "trace", "void(vector s, vector bmins, vector bmaxs, vector e, float ie, int cm)" },
+		{ "getconfigstring", "string(int idx)" },
+		{ "getstat", "float(float idx)" },
+		{ "MSG_ReadChar", "int()" },
+		{ "MSG_ReadByte", "int()" },
+		{ "MSG_ReadShort", "int()" },
+		{ "MSG_ReadLong", "int()" },
+		{ "MSG_ReadFloat", "float()" },
+		{ "MSG_ReadCoord", "float()" },
+		{ "MSG_ReadPos", "vector()" },
+		{ "MSG_ReadAngle", "float()" },
+		{ "MSG_ReadAngle16", "float()" },
+		{ "MSG_ReadDir", "vector()" },
+		{ "drawstring", "void(vector xya, float fs, vector c, float a, string s1, ...)" },
+		{ "drawimage", "void(float x, float y, float w, float h, vector c, float a, string img)" },
+		{ "drawfill", "void(float x, float y, float w, float h, vector c, float a)" }
+	};
+	int		i;
+
+	for (i = 0; i < sizeof(builtins) / sizeof(builtins[0]); i++)
+		Scr_DefineBuiltin (PFCG_Null, PF_CL, builtins[i][0], builtins[i][1]);
+}
@@ -111,6 +111,23 @@ void	Sys_Init (void)
 {
 }
 
+void	Sys_RunJobs (void (*func)(void *data), void **data, int count)
+{
+	int		i;
+
+	for (i = 0; i < count; i++)
+		func (data[i]);
+}
+
+void	*Sys_MapFile (char *path, int *length)
+{
+	return NULL;
+}
+
+void	Sys_UnmapFile (void *base, int length)
+{
+}
+
 
 //=============================================================================
 
@@ -26,7 +26,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 typedef struct
 {
-	byte	data[MAX_MSGLEN];
+	byte	data[MAX_NETMSGLEN+PACKET_HEADER];	// netchan doesn't fragment over loopback
 	int		datalen;
 } loopmsg_t;
 
@@ -386,6 +386,21 @@ void NET_SendPacket (netsrc_t sock, int length, void *data, netadr_t to)
 }
 
 
+/*
+====================
+NET_BeginBatch / NET_FlushBatch
+
+Winsock has no batched send, packets go out as they are sent
+====================
+*/
+void NET_BeginBatch (netsrc_t sock)
+{
+}
+
+void NET_FlushBatch (netsrc_t sock)
+{
+}
+
 //=============================================================================
 
 
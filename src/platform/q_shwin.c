@@ -26,6 +26,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include <direct.h>
 #include <io.h>
 #include <conio.h>
+#include <process.h>
 
 //===============================================================================
 
@@ -138,6 +139,147 @@ void Sys_Mkdir (char *path)
 
 //============================================
 
+#define	MAX_JOB_THREADS	16
+
+static int		job_numthreads = -1;	// not including the main thread
+static HANDLE	job_start[MAX_JOB_THREADS];
+static HANDLE	job_done[MAX_JOB_THREADS];
+
+static void		(*job_func)(void *data);
+static void		**job_data;
+static int		job_count;
+static volatile LONG	job_next;
+
+static void Sys_DoJobs (void)
+{
+	LONG	i;
+
+	while ((i = InterlockedIncrement (&job_next) - 1) < job_count)
+		job_func (job_data[i]);
+}
+
+static unsigned __stdcall Sys_JobThread (void *arg)
+{
+	int		n = (int)(intptr_t)arg;
+
+	while (1)
+	{
+		WaitForSingleObject (job_start[n], INFINITE);
+		Sys_DoJobs ();
+		SetEvent (job_done[n]);
+	}
+	return 0;
+}
+
+static void Sys_InitJobThreads (void)
+{
+	SYSTEM_INFO	info;
+	int			i;
+
+	GetSystemInfo (&info);
+	job_numthreads = info.dwNumberOfProcessors - 1;
+	if (job_numthreads > MAX_JOB_THREADS)
+		job_numthreads = MAX_JOB_THREADS;
+
+	for (i = 0; i < job_numthreads; i++)
+	{
+		job_start[i] = CreateEvent (NULL, FALSE, FALSE, NULL);
+		job_done[i] = CreateEvent (NULL, FALSE, FALSE, NULL);
+		if (!job_start[i] || !job_done[i] || !_beginthreadex (NULL, 0, Sys_JobThread, (void *)(intptr_t)i, 0, NULL))
+		{
+			Com_Printf ("Sys_InitJobThreads: couldn't create worker thread %i\n", i);
+			break;
+		}
+	}
+	job_numthreads = i;
+}
+
+/*
+================
+Sys_RunJobs
+================
+*/
+void Sys_RunJobs (void (*func)(void *data), void **data, int count)
+{
+	int		i, numthreads;
+
+	if (job_numthreads == -1)
+		Sys_InitJobThreads ();
+
+	numthreads = count - 1;
+	if (numthreads > job_numthreads)
+		numthreads = job_numthreads;
+
+	if (numthreads <= 0)
+	{
+		for (i = 0; i < count; i++)
+			func (data[i]);
+		return;
+	}
+
+	job_func = func;
+	job_data = data;
+	job_count = count;
+	job_next = 0;
+
+	for (i = 0; i < numthreads; i++)
+		SetEvent (job_start[i]);
+
+	Sys_DoJobs ();
+
+	WaitForMultipleObjects (numthreads, job_done, TRUE, INFINITE);
+}
+
+//============================================
+
+/*
+================
+Sys_MapFile
+================
+*/
+void *Sys_MapFile (char *path, int *length)
+{
+	HANDLE			file, mapping;
+	LARGE_INTEGER	size;
+	void			*base;
+
+	file = CreateFile (path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return NULL;
+
+	if (!GetFileSizeEx (file, &size) || size.QuadPart <= 0 || size.QuadPart > 0x7fffffff)
+	{
+		CloseHandle (file);
+		return NULL;
+	}
+
+	mapping = CreateFileMapping (file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle (file);
+	if (!mapping)
+		return NULL;
+
+	// the view keeps the mapping alive
+	base = MapViewOfFile (mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle (mapping);
+	if (!base)
+		return NULL;
+
+	*length = (int)size.QuadPart;
+	return base;
+}
+
+/*
+================
+Sys_UnmapFile
+================
+*/
+void Sys_UnmapFile (void *base, int length)
+{
+	UnmapViewOfFile (base);
+}
+
+//============================================
+
 char	findbase[MAX_OSPATH];
 char	findpath[MAX_OSPATH];
 int		findhandle;
@@ -15,6 +15,12 @@
 // protocol can use shorts when modelindex or soundindex exceed byte
 #define PROTOCOL_EXTENDED_ASSETS 1
 
+// entity deltas are bit packed, coordinates are sent as fixed point deltas from the previous state
+// with PROTOCOL_COORD_FRACBITS fractional bits (3 = 1/8 unit) and angles use PROTOCOL_ANGLE_BITS
+#define PROTOCOL_PACKED_ENTITIES 1
+#define PROTOCOL_COORD_FRACBITS 3
+#define PROTOCOL_ANGLE_BITS 10
+
 // main engine directory to load assets from, the default 'game'
 #define	BASEDIRNAME	"main" 
 
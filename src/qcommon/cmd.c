@@ -28,12 +28,19 @@ void Cmd_ForwardToServer (void);
 typedef struct cmdalias_s
 {
 	struct cmdalias_s	*next;
+	struct cmdalias_s	*hash_next;
 	char	name[MAX_ALIAS_NAME];
 	char	*value;
 } cmdalias_t;
 
 cmdalias_t	*cmd_alias;
 
+// commands and aliases are hashed on the lowercased name, so one bucket serves
+// both the exact lookups and the case insensitive ones in Cmd_ExecuteString
+#define	CMD_HASH_SIZE	512
+
+static cmdalias_t	*cmd_aliashash[CMD_HASH_SIZE];
+
 qboolean	cmd_wait;
 
 #define	ALIAS_LOOP_COUNT	16
@@ -158,7 +165,7 @@ Cbuf_InsertFromDefer
 */
 void Cbuf_InsertFromDefer (void)
 {
-	Cbuf_InsertText (defer_text_buf);
+	Cbuf_InsertText ((char *)defer_text_buf);
 	defer_text_buf[0] = 0;
 }
 
@@ -428,6 +435,7 @@ void Cmd_Alias_f (void)
 	char		cmd[1024];
 	int			i, c;
 	char		*s;
+	unsigned int	hash;
 
 	if (Cmd_Argc() == 1)
 	{
@@ -445,7 +453,8 @@ void Cmd_Alias_f (void)
 	}
 
 	// if the alias already exists, reuse it
-	for (a = cmd_alias ; a ; a=a->next)
+	hash = Com_HashKey (s, CMD_HASH_SIZE);
+	for (a = cmd_aliashash[hash] ; a ; a=a->hash_next)
 	{
 		if (!strcmp(s, a->name))
 		{
@@ -459,6 +468,8 @@ void Cmd_Alias_f (void)
 		a = Z_Malloc (sizeof(cmdalias_t));
 		a->next = cmd_alias;
 		cmd_alias = a;
+		a->hash_next = cmd_aliashash[hash];
+		cmd_aliashash[hash] = a;
 	}
 	strcpy (a->name, s);	
 
@@ -487,6 +498,7 @@ void Cmd_Alias_f (void)
 typedef struct cmd_function_s
 {
 	struct cmd_function_s	*next;
+	struct cmd_function_s	*hash_next;
 	char					*name;
 	xcommand_t				function;
 } cmd_function_t;
@@ -498,6 +510,7 @@ static	char		*cmd_null_string = "";
 static	char		cmd_args[MAX_STRING_CHARS];
 
 static	cmd_function_t	*cmd_functions;		// possible commands to execute
+static	cmd_function_t	*cmd_hash[CMD_HASH_SIZE];
 
 /*
 ============
@@ -584,7 +597,7 @@ char *Cmd_MacroExpandString (char *text)
 			return NULL;
 		}
 
-		strncpy (temporary, scan, i);
+		memcpy (temporary, scan, i);
 		strcpy (temporary+i, token);
 		strcpy (temporary+i+j, start);
 
@@ -691,6 +704,7 @@ Cmd_AddCommand
 void	Cmd_AddCommand (char *cmd_name, xcommand_t function)
 {
 	cmd_function_t	*cmd;
+	unsigned int	hash;
 	
 // fail if the command is a variable name
 	if (Cvar_VariableString(cmd_name)[0])
@@ -700,7 +714,8 @@ void	Cmd_AddCommand (char *cmd_name, xcommand_t function)
 	}
 	
 // fail if the command already exists
-	for (cmd=cmd_functions ; cmd ; cmd=cmd->next)
+	hash = Com_HashKey (cmd_name, CMD_HASH_SIZE);
+	for (cmd=cmd_hash[hash] ; cmd ; cmd=cmd->hash_next)
 	{
 		if (!strcmp (cmd_name, cmd->name))
 		{
@@ -714,6 +729,8 @@ void	Cmd_AddCommand (char *cmd_name, xcommand_t function)
 	cmd->function = function;
 	cmd->next = cmd_functions;
 	cmd_functions = cmd;
+	cmd->hash_next = cmd_hash[hash];
+	cmd_hash[hash] = cmd;
 }
 
 /*
@@ -737,11 +754,15 @@ void	Cmd_RemoveCommand (char *cmd_name)
 		if (!strcmp (cmd_name, cmd->name))
 		{
 			*back = cmd->next;
-			Z_Free (cmd);
-			return;
+			break;
 		}
 		back = &cmd->next;
 	}
+
+	for (back = &cmd_hash[Com_HashKey (cmd_name, CMD_HASH_SIZE)] ; *back != cmd ; back = &(*back)->hash_next)
+		;
+	*back = cmd->hash_next;
+	Z_Free (cmd);
 }
 
 /*
@@ -753,7 +774,7 @@ qboolean	Cmd_Exists (char *cmd_name)
 {
 	cmd_function_t	*cmd;
 
-	for (cmd=cmd_functions ; cmd ; cmd=cmd->next)
+	for (cmd=cmd_hash[Com_HashKey (cmd_name, CMD_HASH_SIZE)] ; cmd ; cmd=cmd->hash_next)
 	{
 		if (!strcmp (cmd_name,cmd->name))
 			return true;
@@ -805,13 +826,13 @@ char *Cmd_CompleteCommand (char *partial)
 Cmd_ExecuteString
 
 A complete command line has been parsed, so try to execute it
-FIXME: lookupnoadd the token to speed search?
 ============
 */
 void	Cmd_ExecuteString (char *text)
 {	
 	cmd_function_t	*cmd;
 	cmdalias_t		*a;
+	unsigned int	hash;
 
 	Cmd_TokenizeString (text, true);
 			
@@ -819,8 +840,10 @@ void	Cmd_ExecuteString (char *text)
 	if (!Cmd_Argc())
 		return;		// no tokens
 
+	hash = Com_HashKey (cmd_argv[0], CMD_HASH_SIZE);
+
 	// check functions
-	for (cmd=cmd_functions ; cmd ; cmd=cmd->next)
+	for (cmd=cmd_hash[hash] ; cmd ; cmd=cmd->hash_next)
 	{
 		if (!Q_strcasecmp (cmd_argv[0],cmd->name))
 		{
@@ -835,7 +858,7 @@ void	Cmd_ExecuteString (char *text)
 	}
 
 	// check alias
-	for (a=cmd_alias ; a ; a=a->next)
+	for (a=cmd_aliashash[hash] ; a ; a=a->hash_next)
 	{
 		if (!Q_strcasecmp (cmd_argv[0], a->name))
 		{
@@ -21,6 +21,11 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "qcommon.h"
 
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1) || defined(__SSE__)
+#define CM_SSE
+#include <xmmintrin.h>
+#endif
+
 typedef struct
 {
 	cplane_t	*plane;
@@ -47,7 +52,6 @@ typedef struct
 	int			contents;
 	int			numsides;
 	int			firstbrushside;
-	int			checkcount;		// to avoid repeated testings
 } cbrush_t;
 
 typedef struct
@@ -58,13 +62,20 @@ typedef struct
 	int		floodvalid;
 } carea_t;
 
-static int			checkcount;
+static cmcontext_t	cm_default;		// for the non reentrant api
 
 static char		map_name[MAX_QPATH];
 
 static int			numbrushsides;
 static cbrushside_t map_brushsides[MAX_MAP_BRUSHSIDES];
 
+// brush side planes as structure of arrays for CM_SideDistances, 
+// padded so four sides can always be loaded at once
+static float		side_normal[3][MAX_MAP_BRUSHSIDES+3];
+static float		side_dist[MAX_MAP_BRUSHSIDES+3];
+static byte			side_signbits[MAX_MAP_BRUSHSIDES];
+static byte			side_type[MAX_MAP_BRUSHSIDES];
+
 static int			numtexinfo;
 static mapsurface_t	map_surfaces[MAX_MAP_TEXINFO];
 
@@ -109,12 +120,16 @@ static qboolean		portalopen[MAX_MAP_AREAPORTALS];
 
 static cvar_t		*map_noareas;
 
+static qboolean		cm_genericclip;		// use the original per side loops, see cm_tracebench
+
 // performance counters
 int		c_pointcontents;
 int		c_traces, c_brush_traces;
 
 static void CM_InitBoxHull(void);
-void	FloodAreaConnections(void);
+static void	FloodAreaConnections(void);
+static void	CMod_BuildVisRows (void);
+static void	CM_FreeVisRows (void);
 
 /*
 ===============================================================================
@@ -433,6 +448,30 @@ static void CMod_LoadBrushSides (lump_t *l)
 	}
 }
 
+/*
+=================
+CMod_BuildSidePlanes
+
+Copies the brush side planes into the arrays used by CM_SideDistances
+=================
+*/
+static void CMod_BuildSidePlanes (void)
+{
+	int			i;
+	cplane_t	*plane;
+
+	for (i=0 ; i<numbrushsides ; i++)
+	{
+		plane = map_brushsides[i].plane;
+		side_normal[0][i] = plane->normal[0];
+		side_normal[1][i] = plane->normal[1];
+		side_normal[2][i] = plane->normal[2];
+		side_dist[i] = plane->dist;
+		side_signbits[i] = plane->signbits;
+		side_type[i] = plane->type;
+	}
+}
+
 /*
 =================
 CMod_LoadAreas
@@ -570,6 +609,7 @@ cmodel_t *CM_LoadMap (char *name, qboolean clientload, unsigned *checksum)
 	numleafs = 0;
 	numcmodels = 0;
 	numvisibility = 0;
+	CM_FreeVisRows ();
 	numentitychars = 0;
 	map_entitystring[0] = 0;
 	map_name[0] = 0;
@@ -586,7 +626,7 @@ cmodel_t *CM_LoadMap (char *name, qboolean clientload, unsigned *checksum)
 	//
 	// load the file
 	//
-	length = FS_LoadFile (name, (void **)&buf);
+	length = FS_LoadFileView (name, (void **)&buf);
 	if (!buf)
 		Com_Error (ERR_DROP, "CM_LoadMap: Couldn't load BSP %s\n", name);
 
@@ -613,11 +653,13 @@ cmodel_t *CM_LoadMap (char *name, qboolean clientload, unsigned *checksum)
 	CMod_LoadPlanes (&header.lumps[LUMP_PLANES]);
 	CMod_LoadBrushes (&header.lumps[LUMP_BRUSHES]);
 	CMod_LoadBrushSides (&header.lumps[LUMP_BRUSHSIDES]);
+	CMod_BuildSidePlanes ();
 	CMod_LoadSubmodels (&header.lumps[LUMP_MODELS]);
 	CMod_LoadNodes (&header.lumps[LUMP_NODES]);
 	CMod_LoadAreas (&header.lumps[LUMP_AREAS]);
 	CMod_LoadAreaPortals (&header.lumps[LUMP_AREAPORTALS]);
 	CMod_LoadVisibility (&header.lumps[LUMP_VISIBILITY]);
+	CMod_BuildVisRows ();
 	CMod_LoadEntityString (&header.lumps[LUMP_ENTITIES]);
 
 	FS_FreeFile (buf);
@@ -689,7 +731,6 @@ int		CM_LeafArea (int leafnum)
 //=======================================================================
 
 
-static cplane_t		*box_planes;
 static int			box_headnode;
 static cbrush_t		*box_brush;
 static cleaf_t		*box_leaf;
@@ -707,11 +748,9 @@ static void CM_InitBoxHull (void)
 	int			i;
 	int			side;
 	cnode_t		*c;
-	cplane_t	*p;
 	cbrushside_t	*s;
 
 	box_headnode = numnodes;
-	box_planes = &map_planes[numplanes];
 	if (numnodes+6 > MAX_MAP_NODES
 		|| numbrushes+1 > MAX_MAP_BRUSHES
 		|| numleafbrushes+1 > MAX_MAP_LEAFBRUSHES
@@ -749,46 +788,73 @@ static void CM_InitBoxHull (void)
 		else
 			c->children[side^1] = -1 - numleafs;
 
-		// planes
-		p = &box_planes[i*2];
+		// the planes themselves are in each cmcontext_t, see CM_HeadnodeForBoxCtx
+	}	
+}
+
+
+/*
+===================
+CM_HeadnodeForBoxCtx
+
+To keep everything totally uniform, bounding boxes are turned into small
+BSP trees instead of being compared directly. The box tree is shared,
+its planes come from the context so every thread can have its own box.
+===================
+*/
+int	CM_HeadnodeForBoxCtx (cmcontext_t *ctx, vec3_t mins, vec3_t maxs)
+{
+	int			i;
+	cplane_t	*p;
+
+	for (i=0 ; i<6 ; i++)
+	{
+		p = &ctx->box_planes[i*2];
 		p->type = i>>1;
 		p->signbits = 0;
 		VectorClear (p->normal);
 		p->normal[i>>1] = 1;
 
-		p = &box_planes[i*2+1];
+		p = &ctx->box_planes[i*2+1];
 		p->type = 3 + (i>>1);
 		p->signbits = 0;
 		VectorClear (p->normal);
 		p->normal[i>>1] = -1;
-	}	
+	}
+
+	ctx->box_planes[0].dist = maxs[0];
+	ctx->box_planes[1].dist = -maxs[0];
+	ctx->box_planes[2].dist = mins[0];
+	ctx->box_planes[3].dist = -mins[0];
+	ctx->box_planes[4].dist = maxs[1];
+	ctx->box_planes[5].dist = -maxs[1];
+	ctx->box_planes[6].dist = mins[1];
+	ctx->box_planes[7].dist = -mins[1];
+	ctx->box_planes[8].dist = maxs[2];
+	ctx->box_planes[9].dist = -maxs[2];
+	ctx->box_planes[10].dist = mins[2];
+	ctx->box_planes[11].dist = -mins[2];
+
+	return box_headnode;
 }
 
+int	CM_HeadnodeForBox (vec3_t mins, vec3_t maxs)
+{
+	return CM_HeadnodeForBoxCtx (&cm_default, mins, maxs);
+}
 
 /*
 ===================
-CM_HeadnodeForBox
+CM_NodePlane
 
-To keep everything totally uniform, bounding boxes are turned into small
-BSP trees instead of being compared directly.
+Splitting plane of a node, box hull nodes use the planes of the context
 ===================
 */
-int	CM_HeadnodeForBox (vec3_t mins, vec3_t maxs)
+static inline cplane_t *CM_NodePlane (cmcontext_t *ctx, int num)
 {
-	box_planes[0].dist = maxs[0];
-	box_planes[1].dist = -maxs[0];
-	box_planes[2].dist = mins[0];
-	box_planes[3].dist = -mins[0];
-	box_planes[4].dist = maxs[1];
-	box_planes[5].dist = -maxs[1];
-	box_planes[6].dist = mins[1];
-	box_planes[7].dist = -mins[1];
-	box_planes[8].dist = maxs[2];
-	box_planes[9].dist = -maxs[2];
-	box_planes[10].dist = mins[2];
-	box_planes[11].dist = -mins[2];
-
-	return box_headnode;
+	if (num >= box_headnode)
+		return &ctx->box_planes[(num - box_headnode)*2];
+	return map_nodes[num].plane;
 }
 
 
@@ -798,7 +864,7 @@ CM_PointLeafnum_r
 
 ==================
 */
-static int CM_PointLeafnum_r (vec3_t p, int num)
+static int CM_PointLeafnum_r (cmcontext_t *ctx, vec3_t p, int num)
 {
 	float		d;
 	cnode_t		*node;
@@ -807,7 +873,7 @@ static int CM_PointLeafnum_r (vec3_t p, int num)
 	while (num >= 0)
 	{
 		node = map_nodes + num;
-		plane = node->plane;
+		plane = CM_NodePlane (ctx, num);
 		
 		if (plane->type < 3)
 			d = p[plane->type] - plane->dist;
@@ -828,7 +894,7 @@ int CM_PointLeafnum (vec3_t p)
 {
 	if (!numplanes)
 		return 0;		// sound may call this without map loaded
-	return CM_PointLeafnum_r (p, 0);
+	return CM_PointLeafnum_r (&cm_default, p, 0);	// world nodes only, so no context state is used
 }
 
 
@@ -840,12 +906,16 @@ CM_BoxLeafnums
 Fills in a list of all the leafs touched
 =============
 */
-static int		leaf_count, leaf_maxcount;
-static int		*leaf_list;
-static float	*leaf_mins, *leaf_maxs;
-static int		leaf_topnode;
-
-static void CM_BoxLeafnums_r (int nodenum)
+typedef struct
+{
+	cmcontext_t	*ctx;
+	int			count, maxcount;
+	int			*list;
+	float		*mins, *maxs;
+	int			topnode;
+} leafbox_t;
+
+static void CM_BoxLeafnums_r (leafbox_t *lb, int nodenum)
 {
 	cplane_t	*plane;
 	cnode_t		*node;
@@ -855,55 +925,58 @@ static void CM_BoxLeafnums_r (int nodenum)
 	{
 		if (nodenum < 0)
 		{
-			if (leaf_count >= leaf_maxcount)
+			if (lb->count >= lb->maxcount)
 			{
 //				Com_Printf ("CM_BoxLeafnums_r: overflow\n");
 				return;
 			}
-			leaf_list[leaf_count++] = -1 - nodenum;
+			lb->list[lb->count++] = -1 - nodenum;
 			return;
 		}
 	
 		node = &map_nodes[nodenum];
-		plane = node->plane;
-//		s = BoxOnPlaneSide (leaf_mins, leaf_maxs, plane);
-		s = BOX_ON_PLANE_SIDE(leaf_mins, leaf_maxs, plane);
+		plane = CM_NodePlane (lb->ctx, nodenum);
+//		s = BoxOnPlaneSide (lb->mins, lb->maxs, plane);
+		s = BOX_ON_PLANE_SIDE(lb->mins, lb->maxs, plane);
 		if (s == 1)
 			nodenum = node->children[0];
 		else if (s == 2)
 			nodenum = node->children[1];
 		else
 		{	// go down both
-			if (leaf_topnode == -1)
-				leaf_topnode = nodenum;
-			CM_BoxLeafnums_r (node->children[0]);
+			if (lb->topnode == -1)
+				lb->topnode = nodenum;
+			CM_BoxLeafnums_r (lb, node->children[0]);
 			nodenum = node->children[1];
 		}
 
 	}
 }
 
-static int	CM_BoxLeafnums_headnode (vec3_t mins, vec3_t maxs, int *list, int listsize, int headnode, int *topnode)
+static int	CM_BoxLeafnums_headnode (cmcontext_t *ctx, vec3_t mins, vec3_t maxs, int *list, int listsize, int headnode, int *topnode)
 {
-	leaf_list = list;
-	leaf_count = 0;
-	leaf_maxcount = listsize;
-	leaf_mins = mins;
-	leaf_maxs = maxs;
+	leafbox_t	lb;
+
+	lb.ctx = ctx;
+	lb.list = list;
+	lb.count = 0;
+	lb.maxcount = listsize;
+	lb.mins = mins;
+	lb.maxs = maxs;
 
-	leaf_topnode = -1;
+	lb.topnode = -1;
 
-	CM_BoxLeafnums_r (headnode);
+	CM_BoxLeafnums_r (&lb, headnode);
 
 	if (topnode)
-		*topnode = leaf_topnode;
+		*topnode = lb.topnode;
 
-	return leaf_count;
+	return lb.count;
 }
 
 int	CM_BoxLeafnums (vec3_t mins, vec3_t maxs, int *list, int listsize, int *topnode)
 {
-	return CM_BoxLeafnums_headnode (mins, maxs, list,
+	return CM_BoxLeafnums_headnode (&cm_default, mins, maxs, list,
 		listsize, map_cmodels[0].headnode, topnode);
 }
 
@@ -915,18 +988,23 @@ CM_PointContents
 
 ==================
 */
-int CM_PointContents (vec3_t p, int headnode)
+int CM_PointContentsCtx (cmcontext_t *ctx, vec3_t p, int headnode)
 {
 	int		l;
 
 	if (!numnodes)	// map not loaded
 		return 0;
 
-	l = CM_PointLeafnum_r (p, headnode);
+	l = CM_PointLeafnum_r (ctx, p, headnode);
 
 	return map_leafs[l].contents;
 }
 
+int CM_PointContents (vec3_t p, int headnode)
+{
+	return CM_PointContentsCtx (&cm_default, p, headnode);
+}
+
 /*
 ==================
 CM_TransformedPointContents
@@ -935,7 +1013,7 @@ Handles offseting and rotation of the end points for moving and
 rotating entities
 ==================
 */
-int	CM_TransformedPointContents (vec3_t p, int headnode, vec3_t origin, vec3_t angles)
+int	CM_TransformedPointContentsCtx (cmcontext_t *ctx, vec3_t p, int headnode, vec3_t origin, vec3_t angles)
 {
 	vec3_t		p_l;
 	vec3_t		temp;
@@ -957,11 +1035,16 @@ int	CM_TransformedPointContents (vec3_t p, int headnode, vec3_t origin, vec3_t a
 		p_l[2] = DotProduct (temp, up);
 	}
 
-	l = CM_PointLeafnum_r (p_l, headnode);
+	l = CM_PointLeafnum_r (ctx, p_l, headnode);
 
 	return map_leafs[l].contents;
 }
 
+int	CM_TransformedPointContents (vec3_t p, int headnode, vec3_t origin, vec3_t angles)
+{
+	return CM_TransformedPointContentsCtx (&cm_default, p, headnode, origin, angles);
+}
+
 
 /*
 ===============================================================================
@@ -974,19 +1057,14 @@ BOX TRACING
 // 1/32 epsilon to keep floating point happy
 #define DIST_EPSILON    (1 / 32.f)
 
-static vec3_t	trace_start, trace_end;
-static vec3_t	trace_mins, trace_maxs;
-static vec3_t	trace_extents;
-static trace_t	trace_trace;
-static int		trace_contents;
-static qboolean	trace_ispoint;		// optimized case
-
 /*
 ================
-CM_ClipBoxToBrush
+CM_ClipBoxToBrushGeneric
+
+Reads the planes through the brush sides, used for the box hull
 ================
 */
-static void CM_ClipBoxToBrush (vec3_t mins, vec3_t maxs, vec3_t p1, vec3_t p2, trace_t *trace, cbrush_t *brush)
+static void CM_ClipBoxToBrushGeneric (cmcontext_t *ctx, vec3_t mins, vec3_t maxs, vec3_t p1, vec3_t p2, trace_t *trace, cbrush_t *brush)
 {
 	int			i, j;
 	cplane_t	*plane, *clipplane;
@@ -997,6 +1075,7 @@ static void CM_ClipBoxToBrush (vec3_t mins, vec3_t maxs, vec3_t p1, vec3_t p2, t
 	qboolean	getout, startout;
 	float		f;
 	cbrushside_t	*side, *leadside;
+	cplane_t	*boxplanes;
 
 	enterfrac = -1;
 	leavefrac = 1;
@@ -1010,15 +1089,16 @@ static void CM_ClipBoxToBrush (vec3_t mins, vec3_t maxs, vec3_t p1, vec3_t p2, t
 	getout = false;
 	startout = false;
 	leadside = NULL;
+	boxplanes = (brush == box_brush) ? ctx->box_planes : NULL;
 
 	for (i=0 ; i<brush->numsides ; i++)
 	{
 		side = &map_brushsides[brush->firstbrushside+i];
-		plane = side->plane;
+		plane = boxplanes ? &boxplanes[i*2 + (i&1)] : side->plane;
 
 		// FIXME: special case for axial
 
-		if (!trace_ispoint)
+		if (!ctx->ispoint)
 		{	// general box case
 
 			// push the plane out apropriately for mins/maxs
@@ -1108,10 +1188,10 @@ static void CM_ClipBoxToBrush (vec3_t mins, vec3_t maxs, vec3_t p1, vec3_t p2, t
 
 /*
 ================
-CM_TestBoxInBrush
+CM_TestBoxInBrushGeneric
 ================
 */
-static void CM_TestBoxInBrush (vec3_t mins, vec3_t maxs, vec3_t p1, trace_t *trace, cbrush_t *brush)
+static void CM_TestBoxInBrushGeneric (cmcontext_t *ctx, vec3_t mins, vec3_t maxs, vec3_t p1, trace_t *trace, cbrush_t *brush)
 {
 	int			i, j;
 	cplane_t	*plane;
@@ -1119,14 +1199,17 @@ static void CM_TestBoxInBrush (vec3_t mins, vec3_t maxs, vec3_t p1, trace_t *tra
 	vec3_t		ofs;
 	float		d1;
 	cbrushside_t	*side;
+	cplane_t	*boxplanes;
 
 	if (!brush->numsides)
 		return;
 
+	boxplanes = (brush == box_brush) ? ctx->box_planes : NULL;
+
 	for (i=0 ; i<brush->numsides ; i++)
 	{
 		side = &map_brushsides[brush->firstbrushside+i];
-		plane = side->plane;
+		plane = boxplanes ? &boxplanes[i*2 + (i&1)] : side->plane;
 
 		// FIXME: special case for axial
 
@@ -1160,12 +1243,211 @@ static void CM_TestBoxInBrush (vec3_t mins, vec3_t maxs, vec3_t p1, trace_t *tra
 }
 
 
+/*
+================
+CM_SideDistances
+
+Distances of p1 (and p2 if not NULL) to count (at most 4) brush sides 
+starting at firstside, with the planes pushed out for the box mins/maxs
+================
+*/
+static void CM_SideDistances (int firstside, int count, vec3_t mins, vec3_t maxs, vec3_t p1, vec3_t p2, float *d1, float *d2)
+{
+#ifdef CM_SSE
+	__m128	nx, ny, nz, mask, ofs, dist, d;
+
+	nx = _mm_loadu_ps (&side_normal[0][firstside]);
+	ny = _mm_loadu_ps (&side_normal[1][firstside]);
+	nz = _mm_loadu_ps (&side_normal[2][firstside]);
+
+	// push the planes out apropriately for mins/maxs, same as the generic version
+	mask = _mm_cmplt_ps (nx, _mm_setzero_ps());
+	ofs = _mm_mul_ps (_mm_or_ps (_mm_and_ps (mask, _mm_set1_ps (maxs[0])), _mm_andnot_ps (mask, _mm_set1_ps (mins[0]))), nx);
+	mask = _mm_cmplt_ps (ny, _mm_setzero_ps());
+	ofs = _mm_add_ps (ofs, _mm_mul_ps (_mm_or_ps (_mm_and_ps (mask, _mm_set1_ps (maxs[1])), _mm_andnot_ps (mask, _mm_set1_ps (mins[1]))), ny));
+	mask = _mm_cmplt_ps (nz, _mm_setzero_ps());
+	ofs = _mm_add_ps (ofs, _mm_mul_ps (_mm_or_ps (_mm_and_ps (mask, _mm_set1_ps (maxs[2])), _mm_andnot_ps (mask, _mm_set1_ps (mins[2]))), nz));
+	dist = _mm_sub_ps (_mm_loadu_ps (&side_dist[firstside]), ofs);
+
+	d = _mm_add_ps (_mm_add_ps (_mm_mul_ps (_mm_set1_ps (p1[0]), nx), _mm_mul_ps (_mm_set1_ps (p1[1]), ny)), _mm_mul_ps (_mm_set1_ps (p1[2]), nz));
+	_mm_storeu_ps (d1, _mm_sub_ps (d, dist));
+
+	if (p2)
+	{
+		d = _mm_add_ps (_mm_add_ps (_mm_mul_ps (_mm_set1_ps (p2[0]), nx), _mm_mul_ps (_mm_set1_ps (p2[1]), ny)), _mm_mul_ps (_mm_set1_ps (p2[2]), nz));
+		_mm_storeu_ps (d2, _mm_sub_ps (d, dist));
+	}
+#else
+	int		i, s, t, sb;
+	float	dist;
+	float	*bounds[2];
+
+	bounds[0] = mins;
+	bounds[1] = maxs;
+
+	for (i=0 ; i<count ; i++)
+	{
+		s = firstside + i;
+		t = side_type[s];
+		if (t < 3)
+		{	// axial, only one component of the normal is set
+			dist = side_dist[s] - bounds[(side_signbits[s] >> t) & 1][t] * side_normal[t][s];
+			d1[i] = p1[t] * side_normal[t][s] - dist;
+			if (p2)
+				d2[i] = p2[t] * side_normal[t][s] - dist;
+			continue;
+		}
+
+		// signbits pick the corner of the box closest to the plane
+		sb = side_signbits[s];
+		dist = side_dist[s] - (bounds[sb & 1][0] * side_normal[0][s] + bounds[(sb >> 1) & 1][1] * side_normal[1][s] + bounds[(sb >> 2) & 1][2] * side_normal[2][s]);
+		d1[i] = p1[0] * side_normal[0][s] + p1[1] * side_normal[1][s] + p1[2] * side_normal[2][s] - dist;
+		if (p2)
+			d2[i] = p2[0] * side_normal[0][s] + p2[1] * side_normal[1][s] + p2[2] * side_normal[2][s] - dist;
+	}
+#endif
+}
+
+/*
+================
+CM_ClipBoxToBrush
+================
+*/
+static void CM_ClipBoxToBrush (cmcontext_t *ctx, vec3_t mins, vec3_t maxs, vec3_t p1, vec3_t p2, trace_t *trace, cbrush_t *brush)
+{
+	int			i, k, count, clipside;
+	float		enterfrac, leavefrac;
+	float		d1[4], d2[4];
+	qboolean	getout, startout;
+	float		f;
+
+	if (brush == box_brush || cm_genericclip)
+	{
+		CM_ClipBoxToBrushGeneric (ctx, mins, maxs, p1, p2, trace, brush);
+		return;
+	}
+
+	if (!brush->numsides)
+		return;
+
+	c_brush_traces++;
+
+	enterfrac = -1;
+	leavefrac = 1;
+	clipside = -1;
+	getout = false;
+	startout = false;
+
+	for (i=0 ; i<brush->numsides ; i+=4)
+	{
+		count = brush->numsides - i;
+		if (count > 4)
+			count = 4;
+		CM_SideDistances (brush->firstbrushside + i, count, mins, maxs, p1, p2, d1, d2);
+
+		for (k=0 ; k<count ; k++)
+		{
+			if (d2[k] > 0)
+				getout = true;	// endpoint is not in solid
+			if (d1[k] > 0)
+				startout = true;
+
+			// if completely in front of face, no intersection with the entire brush
+			if (d1[k] > 0 && (d2[k] >= DIST_EPSILON || d2[k] >= d1[k]))
+				return;
+
+			// if it doesn't cross the plane, the plane isn't relevent
+			if (d1[k] <= 0 && d2[k] <= 0)
+				continue;
+
+			// crosses face
+			if (d1[k] > d2[k])
+			{	// enter
+				f = max(0.0f, (d1[k] - DIST_EPSILON) / (d1[k] - d2[k]));
+				if (f > enterfrac)
+				{
+					enterfrac = f;
+					clipside = brush->firstbrushside + i + k;
+				}
+			}
+			else
+			{	// leave
+				f = min(1.0f, (d1[k] + DIST_EPSILON) / (d1[k] - d2[k]));
+				if (f < leavefrac)
+					leavefrac = f;
+			}
+		}
+	}
+
+	if (!startout)
+	{	// original point was inside brush
+		trace->startsolid = true;
+		if (!getout)
+		{
+			trace->allsolid = true;
+			trace->fraction = 0;
+			trace->contents = brush->contents;
+		}
+		return;
+	}
+	if (enterfrac < leavefrac)
+	{
+		if (enterfrac > -1 && enterfrac < trace->fraction)
+		{
+			if (enterfrac < 0)
+				enterfrac = 0;
+			trace->fraction = enterfrac;
+			trace->plane = *map_brushsides[clipside].plane;
+			trace->surface = &(map_brushsides[clipside].surface->c);
+			trace->contents = brush->contents;
+		}
+	}
+}
+
+/*
+================
+CM_TestBoxInBrush
+================
+*/
+static void CM_TestBoxInBrush (cmcontext_t *ctx, vec3_t mins, vec3_t maxs, vec3_t p1, trace_t *trace, cbrush_t *brush)
+{
+	int			i, k, count;
+	float		d1[4];
+
+	if (brush == box_brush || cm_genericclip)
+	{
+		CM_TestBoxInBrushGeneric (ctx, mins, maxs, p1, trace, brush);
+		return;
+	}
+
+	if (!brush->numsides)
+		return;
+
+	for (i=0 ; i<brush->numsides ; i+=4)
+	{
+		count = brush->numsides - i;
+		if (count > 4)
+			count = 4;
+		CM_SideDistances (brush->firstbrushside + i, count, mins, maxs, p1, NULL, d1, NULL);
+
+		// if completely in front of face, no intersection
+		for (k=0 ; k<count ; k++)
+			if (d1[k] > 0)
+				return;
+	}
+
+	// inside this brush
+	trace->startsolid = trace->allsolid = true;
+	trace->fraction = 0;
+	trace->contents = brush->contents;
+}
+
 /*
 ================
 CM_TraceToLeaf
 ================
 */
-static void CM_TraceToLeaf (int leafnum)
+static void CM_TraceToLeaf (cmcontext_t *ctx, int leafnum)
 {
 	int			k;
 	int			brushnum;
@@ -1173,21 +1455,21 @@ static void CM_TraceToLeaf (int leafnum)
 	cbrush_t	*b;
 
 	leaf = &map_leafs[leafnum];
-	if ( !(leaf->contents & trace_contents))
+	if ( !(leaf->contents & ctx->contents))
 		return;
 	// trace line against all brushes in the leaf
 	for (k=0 ; k<leaf->numleafbrushes ; k++)
 	{
 		brushnum = map_leafbrushes[leaf->firstleafbrush+k];
 		b = &map_brushes[brushnum];
-		if (b->checkcount == checkcount)
+		if (ctx->brushcheck[brushnum] == ctx->checkcount)
 			continue;	// already checked this brush in another leaf
-		b->checkcount = checkcount;
+		ctx->brushcheck[brushnum] = ctx->checkcount;
 
-		if ( !(b->contents & trace_contents))
+		if ( !(b->contents & ctx->contents))
 			continue;
-		CM_ClipBoxToBrush (trace_mins, trace_maxs, trace_start, trace_end, &trace_trace, b);
-		if (!trace_trace.fraction)
+		CM_ClipBoxToBrush (ctx, ctx->mins, ctx->maxs, ctx->start, ctx->end, &ctx->trace, b);
+		if (!ctx->trace.fraction)
 			return;
 	}
 
@@ -1199,7 +1481,7 @@ static void CM_TraceToLeaf (int leafnum)
 CM_TestInLeaf
 ================
 */
-static void CM_TestInLeaf (int leafnum)
+static void CM_TestInLeaf (cmcontext_t *ctx, int leafnum)
 {
 	int			k;
 	int			brushnum;
@@ -1207,21 +1489,21 @@ static void CM_TestInLeaf (int leafnum)
 	cbrush_t	*b;
 
 	leaf = &map_leafs[leafnum];
-	if ( !(leaf->contents & trace_contents))
+	if ( !(leaf->contents & ctx->contents))
 		return;
 	// trace line against all brushes in the leaf
 	for (k=0 ; k<leaf->numleafbrushes ; k++)
 	{
 		brushnum = map_leafbrushes[leaf->firstleafbrush+k];
 		b = &map_brushes[brushnum];
-		if (b->checkcount == checkcount)
+		if (ctx->brushcheck[brushnum] == ctx->checkcount)
 			continue;	// already checked this brush in another leaf
-		b->checkcount = checkcount;
+		ctx->brushcheck[brushnum] = ctx->checkcount;
 
-		if ( !(b->contents & trace_contents))
+		if ( !(b->contents & ctx->contents))
 			continue;
-		CM_TestBoxInBrush (trace_mins, trace_maxs, trace_start, &trace_trace, b);
-		if (!trace_trace.fraction)
+		CM_TestBoxInBrush (ctx, ctx->mins, ctx->maxs, ctx->start, &ctx->trace, b);
+		if (!ctx->trace.fraction)
 			return;
 	}
 
@@ -1234,7 +1516,7 @@ CM_RecursiveHullCheck
 
 ==================
 */
-static void CM_RecursiveHullCheck (int num, float p1f, float p2f, vec3_t p1, vec3_t p2)
+static void CM_RecursiveHullCheck (cmcontext_t *ctx, int num, float p1f, float p2f, vec3_t p1, vec3_t p2)
 {
 	cnode_t		*node;
 	cplane_t	*plane;
@@ -1246,13 +1528,13 @@ static void CM_RecursiveHullCheck (int num, float p1f, float p2f, vec3_t p1, vec
 	int			side;
 	float		midf;
 
-	if (trace_trace.fraction <= p1f)
+	if (ctx->trace.fraction <= p1f)
 		return;		// already hit something nearer
 
 	// if < 0, we are in a leaf node
 	if (num < 0)
 	{
-		CM_TraceToLeaf (-1-num);
+		CM_TraceToLeaf (ctx, -1-num);
 		return;
 	}
 
@@ -1261,35 +1543,35 @@ static void CM_RecursiveHullCheck (int num, float p1f, float p2f, vec3_t p1, vec
 	// and the offset for the size of the box
 	//
 	node = map_nodes + num;
-	plane = node->plane;
+	plane = CM_NodePlane (ctx, num);
 
 	if (plane->type < 3)
 	{
 		t1 = p1[plane->type] - plane->dist;
 		t2 = p2[plane->type] - plane->dist;
-		offset = trace_extents[plane->type];
+		offset = ctx->extents[plane->type];
 	}
 	else
 	{
 		t1 = DotProduct (plane->normal, p1) - plane->dist;
 		t2 = DotProduct (plane->normal, p2) - plane->dist;
-		if (trace_ispoint)
+		if (ctx->ispoint)
 			offset = 0;
 		else
-			offset = fabs(trace_extents[0]*plane->normal[0]) +
-				fabs(trace_extents[1]*plane->normal[1]) +
-				fabs(trace_extents[2]*plane->normal[2]);
+			offset = fabs(ctx->extents[0]*plane->normal[0]) +
+				fabs(ctx->extents[1]*plane->normal[1]) +
+				fabs(ctx->extents[2]*plane->normal[2]);
 	}
 
 	// see which sides we need to consider
 	if (t1 >= offset && t2 >= offset)
 	{
-		CM_RecursiveHullCheck (node->children[0], p1f, p2f, p1, p2);
+		CM_RecursiveHullCheck (ctx, node->children[0], p1f, p2f, p1, p2);
 		return;
 	}
 	if (t1 < -offset && t2 < -offset)
 	{
-		CM_RecursiveHullCheck (node->children[1], p1f, p2f, p1, p2);
+		CM_RecursiveHullCheck (ctx, node->children[1], p1f, p2f, p1, p2);
 		return;
 	}
 
@@ -1325,7 +1607,7 @@ static void CM_RecursiveHullCheck (int num, float p1f, float p2f, vec3_t p1, vec
 	for (i=0 ; i<3 ; i++)
 		mid[i] = p1[i] + frac*(p2[i] - p1[i]);
 
-	CM_RecursiveHullCheck (node->children[side], p1f, midf, p1, mid);
+	CM_RecursiveHullCheck (ctx, node->children[side], p1f, midf, p1, mid);
 
 
 	// go past the node
@@ -1338,7 +1620,7 @@ static void CM_RecursiveHullCheck (int num, float p1f, float p2f, vec3_t p1, vec
 	for (i=0 ; i<3 ; i++)
 		mid[i] = p1[i] + frac2*(p2[i] - p1[i]);
 
-	CM_RecursiveHullCheck (node->children[side^1], midf, p2f, mid, p2);
+	CM_RecursiveHullCheck (ctx, node->children[side^1], midf, p2f, mid, p2);
 }
 
 
@@ -1350,26 +1632,26 @@ static void CM_RecursiveHullCheck (int num, float p1f, float p2f, vec3_t p1, vec
 CM_BoxTrace
 ==================
 */
-trace_t CM_BoxTrace(vec3_t start, vec3_t end, vec3_t mins, vec3_t maxs, int headnode, int brushmask)
+trace_t CM_BoxTraceCtx (cmcontext_t *ctx, vec3_t start, vec3_t end, vec3_t mins, vec3_t maxs, int headnode, int brushmask)
 {
 	int		i;
 
-	checkcount++;		// for multi-check avoidance
+	ctx->checkcount++;		// for multi-check avoidance
 	c_traces++;			// for statistics, may be zeroed
 
 	// fill in a default trace
-	memset (&trace_trace, 0, sizeof(trace_trace));
-	trace_trace.fraction = 1;
-	trace_trace.surface = &(nullsurface.c);
+	memset (&ctx->trace, 0, sizeof(ctx->trace));
+	ctx->trace.fraction = 1;
+	ctx->trace.surface = &(nullsurface.c);
 
 	if (!numnodes)	// map not loaded
-		return trace_trace;
+		return ctx->trace;
 
-	trace_contents = brushmask;
-	VectorCopy (start, trace_start);
-	VectorCopy (end, trace_end);
-	VectorCopy (mins, trace_mins);
-	VectorCopy (maxs, trace_maxs);
+	ctx->contents = brushmask;
+	VectorCopy (start, ctx->start);
+	VectorCopy (end, ctx->end);
+	VectorCopy (mins, ctx->mins);
+	VectorCopy (maxs, ctx->maxs);
 
 	//
 	// check for position test special case
@@ -1389,15 +1671,15 @@ trace_t CM_BoxTrace(vec3_t start, vec3_t end, vec3_t mins, vec3_t maxs, int head
 			c2[i] += 1;
 		}
 
-		numleafs = CM_BoxLeafnums_headnode (c1, c2, leafs, 1024, headnode, &topnode);
+		numleafs = CM_BoxLeafnums_headnode (ctx, c1, c2, leafs, 1024, headnode, &topnode);
 		for (i=0 ; i<numleafs ; i++)
 		{
-			CM_TestInLeaf (leafs[i]);
-			if (trace_trace.allsolid)
+			CM_TestInLeaf (ctx, leafs[i]);
+			if (ctx->trace.allsolid)
 				break;
 		}
-		VectorCopy (start, trace_trace.endpos);
-		return trace_trace;
+		VectorCopy (start, ctx->trace.endpos);
+		return ctx->trace;
 	}
 
 	//
@@ -1406,32 +1688,37 @@ trace_t CM_BoxTrace(vec3_t start, vec3_t end, vec3_t mins, vec3_t maxs, int head
 	if (mins[0] == 0 && mins[1] == 0 && mins[2] == 0
 		&& maxs[0] == 0 && maxs[1] == 0 && maxs[2] == 0)
 	{
-		trace_ispoint = true;
-		VectorClear (trace_extents);
+		ctx->ispoint = true;
+		VectorClear (ctx->extents);
 	}
 	else
 	{
-		trace_ispoint = false;
-		trace_extents[0] = -mins[0] > maxs[0] ? -mins[0] : maxs[0];
-		trace_extents[1] = -mins[1] > maxs[1] ? -mins[1] : maxs[1];
-		trace_extents[2] = -mins[2] > maxs[2] ? -mins[2] : maxs[2];
+		ctx->ispoint = false;
+		ctx->extents[0] = -mins[0] > maxs[0] ? -mins[0] : maxs[0];
+		ctx->extents[1] = -mins[1] > maxs[1] ? -mins[1] : maxs[1];
+		ctx->extents[2] = -mins[2] > maxs[2] ? -mins[2] : maxs[2];
 	}
 
 	//
 	// general sweeping through world
 	//
-	CM_RecursiveHullCheck (headnode, 0, 1, start, end);
+	CM_RecursiveHullCheck (ctx, headnode, 0, 1, start, end);
 
-	if (trace_trace.fraction == 1)
+	if (ctx->trace.fraction == 1)
 	{
-		VectorCopy (end, trace_trace.endpos);
+		VectorCopy (end, ctx->trace.endpos);
 	}
 	else
 	{
 		for (i=0 ; i<3 ; i++)
-			trace_trace.endpos[i] = start[i] + trace_trace.fraction * (end[i] - start[i]);
+			ctx->trace.endpos[i] = start[i] + ctx->trace.fraction * (end[i] - start[i]);
 	}
-	return trace_trace;
+	return ctx->trace;
+}
+
+trace_t CM_BoxTrace (vec3_t start, vec3_t end, vec3_t mins, vec3_t maxs, int headnode, int brushmask)
+{
+	return CM_BoxTraceCtx (&cm_default, start, end, mins, maxs, headnode, brushmask);
 }
 
 
@@ -1448,7 +1735,7 @@ rotating entities
 #endif
 
 
-trace_t	CM_TransformedBoxTrace (vec3_t start, vec3_t end, vec3_t mins, vec3_t maxs, int headnode, int brushmask, vec3_t origin, vec3_t angles)
+trace_t	CM_TransformedBoxTraceCtx (cmcontext_t *ctx, vec3_t start, vec3_t end, vec3_t mins, vec3_t maxs, int headnode, int brushmask, vec3_t origin, vec3_t angles)
 {
 	trace_t		trace;
 	vec3_t		start_l, end_l;
@@ -1483,7 +1770,7 @@ trace_t	CM_TransformedBoxTrace (vec3_t start, vec3_t end, vec3_t mins, vec3_t ma
 	}
 
 	// sweep the box through the model
-	trace = CM_BoxTrace (start_l, end_l, mins, maxs, headnode, brushmask);
+	trace = CM_BoxTraceCtx (ctx, start_l, end_l, mins, maxs, headnode, brushmask);
 
 	if (rotated && trace.fraction != 1.0)
 	{
@@ -1504,6 +1791,11 @@ trace_t	CM_TransformedBoxTrace (vec3_t start, vec3_t end, vec3_t mins, vec3_t ma
 	return trace;
 }
 
+trace_t	CM_TransformedBoxTrace (vec3_t start, vec3_t end, vec3_t mins, vec3_t maxs, int headnode, int brushmask, vec3_t origin, vec3_t angles)
+{
+	return CM_TransformedBoxTraceCtx (&cm_default, start, end, mins, maxs, headnode, brushmask, origin, angles);
+}
+
 #ifdef _WIN32
 #pragma optimize( "", on )
 #endif
@@ -1565,25 +1857,202 @@ static void CM_DecompressVis (byte *in, byte *out)
 	} while (out_p - out < row);
 }
 
-byte	pvsrow[MAX_MAP_LEAFS/8];
-byte	phsrow[MAX_MAP_LEAFS/8];
+/*
+Decompressed vis rows. When the whole PVS and PHS fit in cm_vismatrix megabytes they
+are decompressed once at load and a row lookup is only an index. Otherwise calls through
+the default context (main thread only) keep the most recently used rows in a small LRU
+cache, other contexts decompress into their own rows as before.
+*/
+#define	VISCACHE_ROWS	256
+#define	VISCACHE_HASH	512		// power of two
 
-byte	*CM_ClusterPVS (int cluster)
+typedef struct visrow_s
 {
-	if (cluster == -1)
-		memset (pvsrow, 0, (numclusters+7)>>3);
+	int					key;			// cluster * 2 + DVIS_PVS / DVIS_PHS, -1 when unused
+	struct visrow_s		*prev, *next;	// LRU, most recent first
+	struct visrow_s		*hashnext;
+	byte				*bits;
+} visrow_t;
+
+static cvar_t		*cm_vismatrix;
+static int			vis_rowbytes;			// padded to whole ints
+static byte			*vis_matrix;			// [numclusters][2][vis_rowbytes], or NULL
+static byte			*vis_cachebits;			// [VISCACHE_ROWS][vis_rowbytes], or NULL
+static visrow_t		vis_cache[VISCACHE_ROWS];
+static visrow_t		vis_lru;				// list head
+static visrow_t		*vis_hash[VISCACHE_HASH];
+static int			vis_hits, vis_misses;
+
+/*
+===================
+CM_FreeVisRows
+===================
+*/
+static void CM_FreeVisRows (void)
+{
+	if (vis_matrix)
+		Z_Free (vis_matrix);
+	if (vis_cachebits)
+		Z_Free (vis_cachebits);
+	vis_matrix = vis_cachebits = NULL;
+	vis_rowbytes = 0;
+}
+
+/*
+===================
+CMod_BuildVisRows
+
+Decompresses every row if they fit in the cm_vismatrix budget, or sets up the row cache
+===================
+*/
+static void CMod_BuildVisRows (void)
+{
+	int		i, size;
+
+	CM_FreeVisRows ();
+
+	if (!numvisibility || numclusters < 1)
+		return;		// everything is visible, nothing to cache
+
+	vis_rowbytes = ((numclusters + 31) >> 5) << 2;
+	size = vis_rowbytes * numclusters * 2;
+
+	if (cm_vismatrix && size <= cm_vismatrix->value * 1024 * 1024)
+	{
+		vis_matrix = Z_Malloc (size);
+		for (i = 0; i < numclusters; i++)
+		{
+			CM_DecompressVis (map_visibility + map_vis->bitofs[i][DVIS_PVS], vis_matrix + (i * 2 + DVIS_PVS) * vis_rowbytes);
+			CM_DecompressVis (map_visibility + map_vis->bitofs[i][DVIS_PHS], vis_matrix + (i * 2 + DVIS_PHS) * vis_rowbytes);
+		}
+		Com_DPrintf (DP_ALL, "vis matrix: %i clusters, %i kb\n", numclusters, size >> 10);
+		return;
+	}
+
+	vis_cachebits = Z_Malloc (vis_rowbytes * VISCACHE_ROWS);
+	memset (vis_hash, 0, sizeof(vis_hash));
+	vis_lru.next = vis_lru.prev = &vis_lru;
+	for (i = 0; i < VISCACHE_ROWS; i++)
+	{
+		vis_cache[i].key = -1;
+		vis_cache[i].hashnext = NULL;
+		vis_cache[i].bits = vis_cachebits + i * vis_rowbytes;
+		vis_cache[i].next = vis_lru.next;
+		vis_cache[i].prev = &vis_lru;
+		vis_lru.next->prev = &vis_cache[i];
+		vis_lru.next = &vis_cache[i];
+	}
+	Com_DPrintf (DP_ALL, "vis matrix: %i kb over budget, caching %i rows\n", size >> 10, VISCACHE_ROWS);
+}
+
+/*
+===================
+CM_CachedVisRow
+
+Returns the decompressed row from the LRU cache, decompressing it into the
+least recently used slot on a miss
+===================
+*/
+static byte *CM_CachedVisRow (int cluster, int type)
+{
+	visrow_t	*row, **link;
+	int			key;
+
+	key = cluster * 2 + type;
+	for (row = vis_hash[key & (VISCACHE_HASH-1)]; row; row = row->hashnext)
+		if (row->key == key)
+			break;
+
+	if (row)
+	{
+		vis_hits++;
+	}
 	else
-		CM_DecompressVis (map_visibility + map_vis->bitofs[cluster][DVIS_PVS], pvsrow);
-	return pvsrow;
+	{
+		vis_misses++;
+
+		// evict the oldest row
+		row = vis_lru.prev;
+		if (row->key != -1)
+		{
+			for (link = &vis_hash[row->key & (VISCACHE_HASH-1)]; *link != row; link = &(*link)->hashnext)
+				;
+			*link = row->hashnext;
+		}
+
+		row->key = key;
+		row->hashnext = vis_hash[key & (VISCACHE_HASH-1)];
+		vis_hash[key & (VISCACHE_HASH-1)] = row;
+		CM_DecompressVis (map_visibility + map_vis->bitofs[cluster][type], row->bits);
+	}
+
+	// move to the front
+	row->prev->next = row->next;
+	row->next->prev = row->prev;
+	row->next = vis_lru.next;
+	row->prev = &vis_lru;
+	vis_lru.next->prev = row;
+	vis_lru.next = row;
+
+	return row->bits;
 }
 
-byte	*CM_ClusterPHS (int cluster)
+/*
+===================
+CM_ClusterRow
+
+Returned rows are shared and must not be written to
+===================
+*/
+static byte *CM_ClusterRow (cmcontext_t *ctx, int cluster, int type, byte *out)
 {
 	if (cluster == -1)
-		memset (phsrow, 0, (numclusters+7)>>3);
+	{
+		memset (out, 0, (numclusters+7)>>3);
+		return out;
+	}
+	if (vis_matrix)
+		return vis_matrix + (cluster * 2 + type) * vis_rowbytes;
+	if (vis_cachebits && ctx == &cm_default)
+		return CM_CachedVisRow (cluster, type);
+
+	CM_DecompressVis (map_visibility + map_vis->bitofs[cluster][type], out);
+	return out;
+}
+
+byte	*CM_ClusterPVSCtx (cmcontext_t *ctx, int cluster)
+{
+	return CM_ClusterRow (ctx, cluster, DVIS_PVS, ctx->pvsrow);
+}
+
+byte	*CM_ClusterPHSCtx (cmcontext_t *ctx, int cluster)
+{
+	return CM_ClusterRow (ctx, cluster, DVIS_PHS, ctx->phsrow);
+}
+
+byte	*CM_ClusterPVS (int cluster)
+{
+	return CM_ClusterPVSCtx (&cm_default, cluster);
+}
+
+byte	*CM_ClusterPHS (int cluster)
+{
+	return CM_ClusterPHSCtx (&cm_default, cluster);
+}
+
+/*
+===================
+CM_VisInfo_f
+===================
+*/
+static void CM_VisInfo_f (void)
+{
+	if (vis_matrix)
+		Com_Printf ("%i clusters, full matrix of %i kb\n", numclusters, (vis_rowbytes * numclusters * 2) >> 10);
+	else if (vis_cachebits)
+		Com_Printf ("%i clusters, %i cached rows, %i hits, %i misses\n", numclusters, VISCACHE_ROWS, vis_hits, vis_misses);
 	else
-		CM_DecompressVis (map_visibility + map_vis->bitofs[cluster][DVIS_PHS], phsrow);
-	return phsrow;
+		Com_Printf ("%i clusters, no visibility\n", numclusters);
 }
 
 
@@ -1764,3 +2233,105 @@ qboolean CM_HeadnodeVisible (int nodenum, byte *visbits)
 	return CM_HeadnodeVisible(node->children[1], visbits);
 }
 
+
+
+/*
+===============================================================================
+
+TRACE BENCHMARK
+
+===============================================================================
+*/
+
+static qboolean CM_TracesMatch (trace_t *a, trace_t *b)
+{
+	if (a->fraction != b->fraction || a->startsolid != b->startsolid || a->allsolid != b->allsolid)
+		return false;
+	if (a->contents != b->contents || a->surface != b->surface)
+		return false;
+	if (!VectorCompare (a->endpos, b->endpos) || !VectorCompare (a->plane.normal, b->plane.normal))
+		return false;
+	return a->plane.dist == b->plane.dist;
+}
+
+/*
+==================
+CM_TraceBench_f
+
+cm_tracebench [count]
+Runs the same random point and player sized traces through the loaded
+map with the original and the precomputed brush clipping, reports the
+time of each and any trace that came out different
+==================
+*/
+static void CM_TraceBench_f (void)
+{
+	static vec3_t	pmins = {-16, -16, -24}, pmaxs = {16, 16, 32};
+	cmcontext_t		*ctx;
+	vec3_t			*points;
+	trace_t			*results;
+	cmodel_t		*world;
+	int				count, pass, i, j, mismatches;
+	int				start, time[2];
+
+	if (!numnodes)
+	{
+		Com_Printf ("no map loaded\n");
+		return;
+	}
+
+	count = Cmd_Argc() > 1 ? atoi (Cmd_Argv (1)) : 100000;
+	if (count < 1)
+		count = 1;
+
+	world = &map_cmodels[0];
+	ctx = Z_Malloc (sizeof(*ctx));
+	points = Z_Malloc (sizeof(vec3_t) * count * 2);
+	results = Z_Malloc (sizeof(trace_t) * count);
+
+	for (i = 0; i < count * 2; i++)
+		for (j = 0; j < 3; j++)
+			points[i][j] = world->mins[j] + frand() * (world->maxs[j] - world->mins[j]);
+
+	mismatches = 0;
+	for (pass = 0; pass < 2; pass++)
+	{
+		cm_genericclip = (pass == 0);
+		start = Sys_Milliseconds ();
+		for (i = 0; i < count; i++)
+		{
+			trace_t	tr;
+
+			if (i & 1)
+				tr = CM_BoxTraceCtx (ctx, points[i*2], points[i*2+1], pmins, pmaxs, 0, MASK_PLAYERSOLID);
+			else
+				tr = CM_BoxTraceCtx (ctx, points[i*2], points[i*2+1], vec3_origin, vec3_origin, 0, MASK_SHOT);
+
+			if (!pass)
+				results[i] = tr;
+			else if (!CM_TracesMatch (&results[i], &tr))
+				mismatches++;
+		}
+		time[pass] = Sys_Milliseconds () - start;
+	}
+	cm_genericclip = false;
+
+	Com_Printf ("%i traces: generic %i ms, precomputed %i ms, %i mismatches\n", count, time[0], time[1], mismatches);
+
+	Z_Free (results);
+	Z_Free (points);
+	Z_Free (ctx);
+}
+
+/*
+==================
+CM_Init
+==================
+*/
+void CM_Init (void)
+{
+	cm_vismatrix = Cvar_Get ("cm_vismatrix", "32", CVAR_ARCHIVE);
+
+	Cmd_AddCommand ("cm_tracebench", CM_TraceBench_f);
+	Cmd_AddCommand ("cm_visinfo", CM_VisInfo_f);
+}
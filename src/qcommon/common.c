@@ -158,7 +158,7 @@ void Com_DPrintf(dprintLevel_t chan, char *fmt, ...)
 		return;			// don't confuse non-developers with techie stuff...
 
 	if (developer->value == chan ||
-		developer->value == 1337 && (chan == DP_GAME || chan == DP_NET || chan == DP_GAME || chan == DP_SV))
+		(developer->value == 1337 && (chan == DP_GAME || chan == DP_NET || chan == DP_GAME || chan == DP_SV)))
 	{
 		va_start(argptr, fmt);
 		vsprintf(msg, fmt, argptr);
@@ -485,6 +485,357 @@ void MSG_ReadDir (sizebuf_t *sb, vec3_t dir)
 }
 
 
+/*
+==================
+MSG_WriteBits
+
+Appends the low bits of value, least significant bit first.
+Bit writes share the last byte until MSG_AlignBits is called
+==================
+*/
+void MSG_WriteBits (sizebuf_t *sb, int value, int bits)
+{
+	unsigned	v;
+	byte		*buf;
+	int			put;
+
+	v = (unsigned)value;
+	while (bits > 0)
+	{
+		if (!sb->bit)
+		{
+			buf = SZ_GetSpace (sb, 1);
+			buf[0] = 0;
+		}
+
+		put = 8 - sb->bit;
+		if (put > bits)
+			put = bits;
+
+		sb->data[sb->cursize-1] |= (v & ((1<<put)-1)) << sb->bit;
+		v >>= put;
+		bits -= put;
+		sb->bit = (sb->bit + put) & 7;
+	}
+}
+
+/*
+==================
+MSG_AlignBits
+
+Pads (writing) or skips (reading) the rest of a partially used byte
+so byte oriented MSG_ functions can follow
+==================
+*/
+void MSG_AlignBits (sizebuf_t *sb)
+{
+	sb->bit = 0;
+}
+
+
+/*
+==============================================================================
+
+PACKED ENTITY DELTAS
+
+Coordinates are quantized to PROTOCOL_COORD_FRACBITS fixed point and sent as
+a difference from the previous state, angles are quantized to PROTOCOL_ANGLE_BITS.
+Both ends compare quantized values, so the client's copy of a field always
+quantizes to the same value the server deltas from.
+
+The header flags are ordered by how often they change: the common ones get a
+bit each, the rest are only sent when the 'more' bit is set.
+==============================================================================
+*/
+
+#define COORD_SCALE		(1<<PROTOCOL_COORD_FRACBITS)
+#define ANGLE_STEPS		(1<<PROTOCOL_ANGLE_BITS)
+
+static const int packed_entity_flags[] =
+{
+	// most updates
+	U_ORIGIN_X, U_ORIGIN_Y, U_ANGLE_Y, U_FRAME_8, U_OLDORIGIN, U_ORIGIN_Z, U_EVENT,
+
+	// following the 'more' bit
+	U_ANGLE_X, U_ANGLE_Z, U_FRAME_16, U_MODELINDEX_8, U_MODELINDEX_16,
+	U_MODELINDEX2_8, U_MODELINDEX3_8, U_MODELINDEX4_8, U_SKIN_8,
+	U_EFFECTS_8, U_EFFECTS_16, U_RENDERFLAGS_8, U_RENDERFLAGS_16,
+	U_LOOPSOUND, U_PACKEDSOLID, U_RENDERSCALE, U_RENDERALPHA, U_RENDERCOLOR
+};
+#define	PACKED_COMMON_FLAGS		7
+#define	PACKED_NUM_FLAGS		(int)(sizeof(packed_entity_flags) / sizeof(packed_entity_flags[0]))
+
+static int MSG_QuantizeCoord (float f)
+{
+	return (int)floor (f * COORD_SCALE + 0.5f);
+}
+
+static int MSG_QuantizeAngle (float f)
+{
+	return (int)floor (f * (ANGLE_STEPS / 360.0f) + 0.5f) & (ANGLE_STEPS-1);
+}
+
+/*
+==================
+MSG_WriteDeltaCoord
+
+2 bit size class followed by the difference, or the absolute value for big jumps
+==================
+*/
+static void MSG_WriteDeltaCoord (sizebuf_t *sb, int from, int to)
+{
+	int		d;
+
+	d = to - from;
+	if (d >= -64 && d < 64)
+	{
+		MSG_WriteBits (sb, 0, 2);
+		MSG_WriteBits (sb, d, 7);
+	}
+	else if (d >= -4096 && d < 4096)
+	{
+		MSG_WriteBits (sb, 1, 2);
+		MSG_WriteBits (sb, d, 13);
+	}
+	else if (d >= -(1<<19) && d < (1<<19))
+	{
+		MSG_WriteBits (sb, 2, 2);
+		MSG_WriteBits (sb, d, 20);
+	}
+	else
+	{
+		MSG_WriteBits (sb, 3, 2);
+		MSG_WriteBits (sb, to, 32);
+	}
+}
+
+static void MSG_WritePackedEntityBits (sizebuf_t *msg, int bits, int number)
+{
+	int		i, more;
+
+	MSG_WriteBits (msg, number, ENTITYNUM_BITS);
+	if (!number)
+	{	// end of packetentities
+		MSG_AlignBits (msg);
+		return;
+	}
+
+	MSG_WriteBits (msg, (bits & U_REMOVE) ? 1 : 0, 1);
+	if (bits & U_REMOVE)
+	{
+		MSG_AlignBits (msg);
+		return;
+	}
+
+	for (i = 0; i < PACKED_COMMON_FLAGS; i++)
+		MSG_WriteBits (msg, (bits & packed_entity_flags[i]) ? 1 : 0, 1);
+
+	more = 0;
+	for (i = PACKED_COMMON_FLAGS; i < PACKED_NUM_FLAGS; i++)
+		if (bits & packed_entity_flags[i])
+			more = 1;
+
+	MSG_WriteBits (msg, more, 1);
+	if (!more)
+		return;
+
+	for (i = PACKED_COMMON_FLAGS; i < PACKED_NUM_FLAGS; i++)
+		MSG_WriteBits (msg, (bits & packed_entity_flags[i]) ? 1 : 0, 1);
+}
+
+static void MSG_WritePackedEntity (entity_state_t *from, entity_state_t *to, sizebuf_t *msg, int bits)
+{
+	int		i, q;
+
+	if (bits & U_MODELINDEX_8)
+		MSG_WriteBits (msg, to->modelindex, 8);
+	if (bits & U_MODELINDEX_16)
+		MSG_WriteBits (msg, to->modelindex, 16);
+
+	if (bits & U_MODELINDEX2_8)
+		MSG_WriteBits (msg, to->modelindex2, 8);
+	if (bits & U_MODELINDEX3_8)
+		MSG_WriteBits (msg, to->modelindex3, 8);
+	if (bits & U_MODELINDEX4_8)
+		MSG_WriteBits (msg, to->modelindex4, 8);
+
+	if (bits & U_FRAME_8)
+		MSG_WriteBits (msg, to->frame, 8);
+	if (bits & U_FRAME_16)
+		MSG_WriteBits (msg, to->frame, 16);
+
+	if (bits & U_SKIN_8)
+		MSG_WriteBits (msg, to->skinnum, 8);
+
+	if ( (bits & (U_EFFECTS_8|U_EFFECTS_16)) == (U_EFFECTS_8|U_EFFECTS_16) )
+		MSG_WriteBits (msg, to->effects, 32);
+	else if (bits & U_EFFECTS_8)
+		MSG_WriteBits (msg, to->effects, 8);
+	else if (bits & U_EFFECTS_16)
+		MSG_WriteBits (msg, to->effects, 16);
+
+	if ( (bits & (U_RENDERFLAGS_8|U_RENDERFLAGS_16)) == (U_RENDERFLAGS_8|U_RENDERFLAGS_16) )
+		MSG_WriteBits (msg, to->renderFlags, 32);
+	else if (bits & U_RENDERFLAGS_8)
+		MSG_WriteBits (msg, to->renderFlags, 8);
+	else if (bits & U_RENDERFLAGS_16)
+		MSG_WriteBits (msg, to->renderFlags, 16);
+
+	if (bits & U_RENDERSCALE)
+		MSG_WriteBits (msg, (int)(to->renderScale * 16), 8);
+
+	if (bits & U_RENDERCOLOR)
+	{
+		for (i = 0; i < 3; i++)
+			MSG_WriteBits (msg, (int)(to->renderColor[i] * 255), 8);
+	}
+
+	if (bits & U_RENDERALPHA)
+		MSG_WriteBits (msg, (int)(to->renderAlpha * 255), 8);
+
+	// current origin
+	if (bits & U_ORIGIN_X)
+		MSG_WriteDeltaCoord (msg, MSG_QuantizeCoord (from->origin[0]), MSG_QuantizeCoord (to->origin[0]));
+	if (bits & U_ORIGIN_Y)
+		MSG_WriteDeltaCoord (msg, MSG_QuantizeCoord (from->origin[1]), MSG_QuantizeCoord (to->origin[1]));
+	if (bits & U_ORIGIN_Z)
+		MSG_WriteDeltaCoord (msg, MSG_QuantizeCoord (from->origin[2]), MSG_QuantizeCoord (to->origin[2]));
+
+	// current angles
+	if (bits & U_ANGLE_X)
+		MSG_WriteBits (msg, MSG_QuantizeAngle (to->angles[0]), PROTOCOL_ANGLE_BITS);
+	if (bits & U_ANGLE_Y)
+		MSG_WriteBits (msg, MSG_QuantizeAngle (to->angles[1]), PROTOCOL_ANGLE_BITS);
+	if (bits & U_ANGLE_Z)
+		MSG_WriteBits (msg, MSG_QuantizeAngle (to->angles[2]), PROTOCOL_ANGLE_BITS);
+
+	// old origin, usually close to the current one
+	if (bits & U_OLDORIGIN)
+	{
+		for (i = 0; i < 3; i++)
+		{
+			q = MSG_QuantizeCoord (to->origin[i]);
+			MSG_WriteDeltaCoord (msg, q, MSG_QuantizeCoord (to->old_origin[i]));
+		}
+	}
+
+	if (bits & U_LOOPSOUND)
+	{
+#ifdef PROTOCOL_EXTENDED_ASSETS
+		MSG_WriteBits (msg, to->loopingSound, 16);
+#else
+		MSG_WriteBits (msg, to->loopingSound, 8);
+#endif
+	}
+
+	if (bits & U_EVENT)
+		MSG_WriteBits (msg, to->event, 8);
+
+	if (bits & U_PACKEDSOLID)
+	{
+#if PROTOCOL_FLOAT_COORDS == 1
+		MSG_WriteBits (msg, to->solid, 32);
+#else
+		MSG_WriteBits (msg, to->solid, 16);
+#endif
+	}
+
+	MSG_AlignBits (msg);
+}
+
+//============================================================
+
+/*
+==================
+MSG_WriteEntityBits
+
+Writes the header of an entity update, also used on its own
+for U_REMOVE and with a zero number to end packetentities
+==================
+*/
+void MSG_WriteEntityBitsFormat (sizebuf_t *msg, int bits, int number, qboolean packed)
+{
+	if (packed)
+	{
+		MSG_WritePackedEntityBits (msg, bits, number);
+		return;
+	}
+
+	if (number >= 256)
+		bits |= U_NUMBER_16;		// number8 is implicit otherwise
+
+	if (bits & 0xff000000)
+		bits |= U_MOREBITS3 | U_MOREBITS2 | U_MOREBITS1;
+	else if (bits & 0x00ff0000)
+		bits |= U_MOREBITS2 | U_MOREBITS1;
+	else if (bits & 0x0000ff00)
+		bits |= U_MOREBITS1;
+
+	MSG_WriteByte (msg,	bits&255 );
+
+	if (bits & 0xff000000)
+	{
+		MSG_WriteByte (msg,	(bits>>8)&255 );
+		MSG_WriteByte (msg,	(bits>>16)&255 );
+		MSG_WriteByte (msg,	(bits>>24)&255 );
+	}
+	else if (bits & 0x00ff0000)
+	{
+		MSG_WriteByte (msg,	(bits>>8)&255 );
+		MSG_WriteByte (msg,	(bits>>16)&255 );
+	}
+	else if (bits & 0x0000ff00)
+	{
+		MSG_WriteByte (msg,	(bits>>8)&255 );
+	}
+
+	// ENT NUMBER
+	if (bits & U_NUMBER_16)
+		MSG_WriteShort (msg, number);
+	else
+		MSG_WriteByte (msg,	number);
+}
+
+void MSG_WriteEntityBits (sizebuf_t *msg, int bits, int number)
+{
+	MSG_WriteEntityBitsFormat (msg, bits, number, PROTOCOL_PACKED_ENTITIES == 1);
+}
+
+/*
+==================
+MSG_ClampEntityRender
+
+Resets renderScale [0.0-15.0] and renderColor [0.0-1.0] values which differ from
+'from' and can't be sent, returns true if anything was reset. Doesn't print so
+frame jobs can call it on worker threads before MSG_WriteDeltaEntity
+==================
+*/
+qboolean MSG_ClampEntityRender (entity_state_t *from, entity_state_t *to)
+{
+	qboolean	reset;
+	int			i;
+
+	reset = false;
+	if (to->renderScale != from->renderScale && (to->renderScale > 15 || to->renderScale <= 0))
+	{
+		to->renderScale = 1.0f;
+		reset = true;
+	}
+
+	if (!VectorCompare (to->renderColor, from->renderColor))
+	{
+		for (i = 0; i < 3; i++)
+		{
+			if (to->renderColor[i] > 1.0f || to->renderColor[i] < 0.0f)
+			{
+				to->renderColor[i] = to->renderColor[i] > 1.0f ? 1.0f : 0.0f;
+				reset = true;
+			}
+		}
+	}
+	return reset;
+}
+
 /*
 ==================
 MSG_WriteDeltaEntity
@@ -495,7 +846,20 @@ Can delta from either a baseline or a previous packet_entity
 */
 void MSG_WriteDeltaEntity (entity_state_t *from, entity_state_t *to, sizebuf_t *msg, qboolean force, qboolean newentity)
 {
-	int		bits, i;
+	MSG_WriteDeltaEntityFormat (from, to, msg, force, newentity, PROTOCOL_PACKED_ENTITIES == 1);
+}
+
+/*
+==================
+MSG_WriteDeltaEntityFormat
+
+Writes either the byte or the packed encoding, the protocol
+uses PROTOCOL_PACKED_ENTITIES, cl_netbench compares both
+==================
+*/
+void MSG_WriteDeltaEntityFormat (entity_state_t *from, entity_state_t *to, sizebuf_t *msg, qboolean force, qboolean newentity, qboolean packed)
+{
+	int		bits;
 
 	if (!to->number)
 		Com_Error (ERR_FATAL, "MSG_WriteDeltaEntity: Unset entity number");
@@ -505,25 +869,41 @@ void MSG_WriteDeltaEntity (entity_state_t *from, entity_state_t *to, sizebuf_t *
 // send an update
 	bits = 0;
 
-	if (to->number >= 256)
-		bits |= U_NUMBER_16;		// number8 is implicit otherwise
+	if (packed)
+	{	// only what survives quantization is a change
+		if (MSG_QuantizeCoord (to->origin[0]) != MSG_QuantizeCoord (from->origin[0]))
+			bits |= U_ORIGIN_X;
+		if (MSG_QuantizeCoord (to->origin[1]) != MSG_QuantizeCoord (from->origin[1]))
+			bits |= U_ORIGIN_Y;
+		if (MSG_QuantizeCoord (to->origin[2]) != MSG_QuantizeCoord (from->origin[2]))
+			bits |= U_ORIGIN_Z;
+
+		if (MSG_QuantizeAngle (to->angles[0]) != MSG_QuantizeAngle (from->angles[0]))
+			bits |= U_ANGLE_X;
+		if (MSG_QuantizeAngle (to->angles[1]) != MSG_QuantizeAngle (from->angles[1]))
+			bits |= U_ANGLE_Y;
+		if (MSG_QuantizeAngle (to->angles[2]) != MSG_QuantizeAngle (from->angles[2]))
+			bits |= U_ANGLE_Z;
+	}
+	else
+	{
+		// origin
+		if (to->origin[0] != from->origin[0])
+			bits |= U_ORIGIN_X;
+		if (to->origin[1] != from->origin[1])
+			bits |= U_ORIGIN_Y;
+		if (to->origin[2] != from->origin[2])
+			bits |= U_ORIGIN_Z;
+
+		// angles
+		if ( to->angles[0] != from->angles[0] )
+			bits |= U_ANGLE_X;
+		if ( to->angles[1] != from->angles[1] )
+			bits |= U_ANGLE_Y;
+		if ( to->angles[2] != from->angles[2] )
+			bits |= U_ANGLE_Z;
+	}
 
-	// origin
-	if (to->origin[0] != from->origin[0])
-		bits |= U_ORIGIN_X;
-	if (to->origin[1] != from->origin[1])
-		bits |= U_ORIGIN_Y;
-	if (to->origin[2] != from->origin[2])
-		bits |= U_ORIGIN_Z;
-
-	// angles
-	if ( to->angles[0] != from->angles[0] )
-		bits |= U_ANGLE_X;		
-	if ( to->angles[1] != from->angles[1] )
-		bits |= U_ANGLE_Y;
-	if ( to->angles[2] != from->angles[2] )
-		bits |= U_ANGLE_Z;
-		
 	if ( to->skinnum != from->skinnum )
 		bits |= U_SKIN_8;
 		
@@ -606,41 +986,17 @@ void MSG_WriteDeltaEntity (entity_state_t *from, entity_state_t *to, sizebuf_t *
 	if (!bits && !force)
 		return;		// nothing to send!
 
-	//----------
-
-	if (bits & 0xff000000)
-		bits |= U_MOREBITS3 | U_MOREBITS2 | U_MOREBITS1;
-	else if (bits & 0x00ff0000)
-		bits |= U_MOREBITS2 | U_MOREBITS1;
-	else if (bits & 0x0000ff00)
-		bits |= U_MOREBITS1;
+	if (MSG_ClampEntityRender (from, to))
+		Com_Printf("%s: entity %i renderScale or renderColor out of range\n", __FUNCTION__, to->number);
 
-	MSG_WriteByte (msg,	bits&255 );
+	MSG_WriteEntityBitsFormat (msg, bits, to->number, packed);
 
-	if (bits & 0xff000000)
+	if (packed)
 	{
-		MSG_WriteByte (msg,	(bits>>8)&255 );
-		MSG_WriteByte (msg,	(bits>>16)&255 );
-		MSG_WriteByte (msg,	(bits>>24)&255 );
-	}
-	else if (bits & 0x00ff0000)
-	{
-		MSG_WriteByte (msg,	(bits>>8)&255 );
-		MSG_WriteByte (msg,	(bits>>16)&255 );
-	}
-	else if (bits & 0x0000ff00)
-	{
-		MSG_WriteByte (msg,	(bits>>8)&255 );
+		MSG_WritePackedEntity (from, to, msg, bits);
+		return;
 	}
 
-	//----------
-
-	// ENT NUMBER
-	if (bits & U_NUMBER_16)
-		MSG_WriteShort (msg, to->number);
-	else
-		MSG_WriteByte (msg,	to->number);
-
 	// main model
 	if (bits & U_MODELINDEX_8)
 		MSG_WriteByte (msg,	to->modelindex);
@@ -683,27 +1039,11 @@ void MSG_WriteDeltaEntity (entity_state_t *from, entity_state_t *to, sizebuf_t *
 
 	// render scale
 	if (bits & U_RENDERSCALE)
-	{
-		if (to->renderScale > 15 || to->renderScale <= 0)
-		{
-			Com_Printf("%s: to->renderScale %f out of scale [0.0-15.0]\n", __FUNCTION__, to->renderScale);
-			to->renderScale = 1.0f;
-		}
-
 		MSG_WriteByte(msg, (int)(to->renderScale * 16));
-	}
 
 	// render color
 	if (bits & U_RENDERCOLOR)
 	{
-		for (i = 0; i < 3; i++)
-		{
-			if (to->renderColor[i] > 1.0f || to->renderColor[1] < 0.0f)
-			{
-				Com_Printf("%s: to->renderColor[%i] %f out of scale [0.0-1.0]\n", __FUNCTION__, i, to->renderColor[i]);
-				to->renderScale = 1.0f;
-			}
-		}
 		MSG_WriteByte(msg, (to->renderColor[0] * 255));
 		MSG_WriteByte(msg, (to->renderColor[1] * 255));
 		MSG_WriteByte(msg, (to->renderColor[2] * 255));
@@ -772,6 +1112,7 @@ void MSG_WriteDeltaEntity (entity_state_t *from, entity_state_t *to, sizebuf_t *
 void MSG_BeginReading (sizebuf_t *msg)
 {
 	msg->readcount = 0;
+	msg->bit = 0;
 }
 
 // returns -1 if no more characters are available
@@ -984,6 +1325,231 @@ void MSG_ReadData (sizebuf_t *msg_read, void *data, int len)
 		((byte *)data)[i] = MSG_ReadByte (msg_read);
 }
 
+/*
+==================
+MSG_ReadBits
+
+Counterpart of MSG_WriteBits, reads zeroes past the end of the message
+but still advances readcount so the caller can detect it
+==================
+*/
+int MSG_ReadBits (sizebuf_t *msg_read, int bits)
+{
+	unsigned	value;
+	int			c, get, shift;
+
+	value = 0;
+	shift = 0;
+	while (bits > 0)
+	{
+		if (!msg_read->bit)
+			msg_read->readcount++;
+
+		if (msg_read->readcount > msg_read->cursize)
+			c = 0;
+		else
+			c = msg_read->data[msg_read->readcount-1];
+
+		get = 8 - msg_read->bit;
+		if (get > bits)
+			get = bits;
+
+		value |= (unsigned)((c >> msg_read->bit) & ((1<<get)-1)) << shift;
+		shift += get;
+		bits -= get;
+		msg_read->bit = (msg_read->bit + get) & 7;
+	}
+
+	return (int)value;
+}
+
+static int MSG_ReadSignedBits (sizebuf_t *msg_read, int bits)
+{
+	int		v;
+
+	v = MSG_ReadBits (msg_read, bits);
+	if (v & (1<<(bits-1)))
+		v -= 1<<bits;
+	return v;
+}
+
+static int MSG_ReadDeltaCoord (sizebuf_t *msg_read, int from)
+{
+	switch (MSG_ReadBits (msg_read, 2))
+	{
+	case 0:
+		return from + MSG_ReadSignedBits (msg_read, 7);
+	case 1:
+		return from + MSG_ReadSignedBits (msg_read, 13);
+	case 2:
+		return from + MSG_ReadSignedBits (msg_read, 20);
+	default:
+		return MSG_ReadBits (msg_read, 32);
+	}
+}
+
+static float MSG_ReadPackedAngle (sizebuf_t *msg_read)
+{
+	int		q;
+
+	q = MSG_ReadBits (msg_read, PROTOCOL_ANGLE_BITS);
+	if (q >= ANGLE_STEPS/2)
+		q -= ANGLE_STEPS;
+	return q * (360.0f / ANGLE_STEPS);
+}
+
+/*
+==================
+MSG_ReadPackedEntityBits
+
+Reads a header written by MSG_WritePackedEntityBits,
+returns the entity number and the U_ flags
+==================
+*/
+int MSG_ReadPackedEntityBits (sizebuf_t *msg_read, unsigned *bits)
+{
+	int		i, number;
+
+	*bits = 0;
+
+	number = MSG_ReadBits (msg_read, ENTITYNUM_BITS);
+	if (!number)
+	{
+		MSG_AlignBits (msg_read);
+		return 0;
+	}
+
+	if (MSG_ReadBits (msg_read, 1))
+	{
+		*bits = U_REMOVE;
+		MSG_AlignBits (msg_read);
+		return number;
+	}
+
+	for (i = 0; i < PACKED_COMMON_FLAGS; i++)
+		if (MSG_ReadBits (msg_read, 1))
+			*bits |= packed_entity_flags[i];
+
+	if (MSG_ReadBits (msg_read, 1))
+	{
+		for (i = PACKED_COMMON_FLAGS; i < PACKED_NUM_FLAGS; i++)
+			if (MSG_ReadBits (msg_read, 1))
+				*bits |= packed_entity_flags[i];
+	}
+
+	return number;
+}
+
+/*
+==================
+MSG_ReadPackedEntity
+
+Reads the fields written by MSG_WritePackedEntity, 'to' must
+already be a copy of 'from'
+==================
+*/
+void MSG_ReadPackedEntity (sizebuf_t *msg_read, entity_state_t *from, entity_state_t *to, int bits)
+{
+	int		i, q;
+
+	if (bits & U_MODELINDEX_8)
+		to->modelindex = MSG_ReadBits (msg_read, 8);
+	if (bits & U_MODELINDEX_16)
+		to->modelindex = MSG_ReadBits (msg_read, 16);
+
+	if (bits & U_MODELINDEX2_8)
+		to->modelindex2 = MSG_ReadBits (msg_read, 8);
+	if (bits & U_MODELINDEX3_8)
+		to->modelindex3 = MSG_ReadBits (msg_read, 8);
+	if (bits & U_MODELINDEX4_8)
+		to->modelindex4 = MSG_ReadBits (msg_read, 8);
+
+	if (bits & U_FRAME_8)
+		to->frame = MSG_ReadBits (msg_read, 8);
+	if (bits & U_FRAME_16)
+		to->frame = MSG_ReadBits (msg_read, 16);
+
+	if (bits & U_SKIN_8)
+		to->skinnum = MSG_ReadBits (msg_read, 8);
+
+	if ( (bits & (U_EFFECTS_8|U_EFFECTS_16)) == (U_EFFECTS_8|U_EFFECTS_16) )
+		to->effects = MSG_ReadBits (msg_read, 32);
+	else if (bits & U_EFFECTS_8)
+		to->effects = MSG_ReadBits (msg_read, 8);
+	else if (bits & U_EFFECTS_16)
+		to->effects = MSG_ReadBits (msg_read, 16);
+
+	if ( (bits & (U_RENDERFLAGS_8|U_RENDERFLAGS_16)) == (U_RENDERFLAGS_8|U_RENDERFLAGS_16) )
+		to->renderFlags = MSG_ReadBits (msg_read, 32);
+	else if (bits & U_RENDERFLAGS_8)
+		to->renderFlags = MSG_ReadBits (msg_read, 8);
+	else if (bits & U_RENDERFLAGS_16)
+		to->renderFlags = MSG_ReadBits (msg_read, 16);
+
+	if (bits & U_RENDERSCALE)
+		to->renderScale = MSG_ReadBits (msg_read, 8) * (1.0f / 16.0f);
+
+	if (bits & U_RENDERCOLOR)
+	{
+		for (i = 0; i < 3; i++)
+			to->renderColor[i] = MSG_ReadBits (msg_read, 8) * (1.0f / 255.0f);
+	}
+
+	if (bits & U_RENDERALPHA)
+		to->renderAlpha = MSG_ReadBits (msg_read, 8) * (1.0f / 255.0f);
+
+	// current origin
+	if (bits & U_ORIGIN_X)
+		to->origin[0] = MSG_ReadDeltaCoord (msg_read, MSG_QuantizeCoord (from->origin[0])) * (1.0f / COORD_SCALE);
+	if (bits & U_ORIGIN_Y)
+		to->origin[1] = MSG_ReadDeltaCoord (msg_read, MSG_QuantizeCoord (from->origin[1])) * (1.0f / COORD_SCALE);
+	if (bits & U_ORIGIN_Z)
+		to->origin[2] = MSG_ReadDeltaCoord (msg_read, MSG_QuantizeCoord (from->origin[2])) * (1.0f / COORD_SCALE);
+
+	// current angles
+	if (bits & U_ANGLE_X)
+		to->angles[0] = MSG_ReadPackedAngle (msg_read);
+	if (bits & U_ANGLE_Y)
+		to->angles[1] = MSG_ReadPackedAngle (msg_read);
+	if (bits & U_ANGLE_Z)
+		to->angles[2] = MSG_ReadPackedAngle (msg_read);
+
+	// old origin (used for smoothing move)
+	if (bits & U_OLDORIGIN)
+	{
+		for (i = 0; i < 3; i++)
+		{
+			q = MSG_QuantizeCoord (to->origin[i]);
+			to->old_origin[i] = MSG_ReadDeltaCoord (msg_read, q) * (1.0f / COORD_SCALE);
+		}
+	}
+
+	if (bits & U_LOOPSOUND)
+	{
+#ifdef PROTOCOL_EXTENDED_ASSETS
+		to->loopingSound = MSG_ReadBits (msg_read, 16);
+#else
+		to->loopingSound = MSG_ReadBits (msg_read, 8);
+#endif
+	}
+
+	if (bits & U_EVENT)
+		to->event = MSG_ReadBits (msg_read, 8);
+	else
+		to->event = 0;
+
+	if (bits & U_PACKEDSOLID)
+	{
+#if PROTOCOL_FLOAT_COORDS == 1
+		to->solid = MSG_ReadBits (msg_read, 32);
+#else
+		to->solid = (short)MSG_ReadBits (msg_read, 16);
+#endif
+	}
+
+	MSG_AlignBits (msg_read);
+}
+
 
 //===========================================================================
 
@@ -998,6 +1564,7 @@ void SZ_Clear (sizebuf_t *buf)
 {
 	buf->cursize = 0;
 	buf->overflowed = false;
+	buf->bit = 0;
 }
 
 void *SZ_GetSpace (sizebuf_t *buf, int length)
@@ -1200,25 +1767,120 @@ void Info_Print (char *s)
 
 						ZONE MEMORY ALLOCATION
 
-just cleared malloc with counters now...
+Untagged blocks are just cleared malloc with counters. Tagged blocks come from a
+bump pointer arena per tag, Z_FreeTags rewinds the arena and keeps its chunks
+for the next round. Z_Free on a tagged block only updates the counters.
+
+Debug builds put a guard after every block, checked when it is freed and when
+its arena is rewound.
 
 ==============================================================================
 */
 
-#define	Z_MAGIC		0x1d1d
+#define	Z_MAGIC			0x1d1d
+#define	Z_ARENAMAGIC	0x1d1e
+#define	Z_FREEDMAGIC	0x1d1f		// freed arena block, catches double frees
+
+#ifdef _DEBUG
+#define	Z_GUARDS
+#define	Z_GUARD			0xdeadbeef
+#define	Z_GUARDSIZE		sizeof(int)
+#else
+#define	Z_GUARDSIZE		0
+#endif
+
+#define	Z_ALIGN			16
+#define	Z_CHUNKSIZE		0x40000		// 256k, bigger blocks get a chunk of their own
+#define	MAX_ZONE_ARENAS	32
 
 
 typedef struct zhead_s
 {
-	struct zhead_s	*prev, *next;
+	struct zhead_s	*prev, *next;	// only for untagged blocks
 	short	magic;
 	short	tag;			// for group free
-	int		size;
+	int		size;			// including header, guard and padding
+#ifdef Z_GUARDS
+	int		request;		// guard goes right after this many bytes
+#endif
 } zhead_t;
 
+typedef struct zchunk_s
+{
+	struct zchunk_s	*next;
+	int		size, used;
+} zchunk_t;
+
+typedef struct
+{
+	int			tag;
+	zchunk_t	*chunks;		// all chunks, reused in order after a rewind
+	zchunk_t	*current;
+	int			reserved;		// bytes in chunks
+	int			count, bytes;	// live blocks
+} zarena_t;
+
 zhead_t		z_chain;
 int		z_count, z_bytes;
 
+#ifdef Z_GUARDS
+static const int	z_guard = Z_GUARD;
+#endif
+
+static zarena_t	z_arenas[MAX_ZONE_ARENAS];
+static int		z_numarenas;
+
+#define	Z_CHUNKHEAD		((sizeof(zchunk_t) + Z_ALIGN - 1) & ~(Z_ALIGN - 1))
+#define	Z_CHUNKDATA(c)	((byte *)(c) + Z_CHUNKHEAD)
+
+/*
+========================
+Z_CheckGuard
+========================
+*/
+static void Z_CheckGuard (zhead_t *z, char *caller)
+{
+#ifdef Z_GUARDS
+	if (memcmp ((byte *)(z+1) + z->request, &z_guard, Z_GUARDSIZE))
+		Com_Error (ERR_FATAL, "%s: block with tag %i overrun", caller, z->tag);
+#endif
+}
+
+/*
+========================
+Z_SetGuard
+========================
+*/
+static void Z_SetGuard (zhead_t *z, int request)
+{
+#ifdef Z_GUARDS
+	z->request = request;
+	memcpy ((byte *)(z+1) + z->request, &z_guard, Z_GUARDSIZE);
+#endif
+}
+
+/*
+========================
+Z_ArenaForTag
+========================
+*/
+static zarena_t *Z_ArenaForTag (int tag, qboolean create)
+{
+	int		i;
+
+	for (i = 0; i < z_numarenas; i++)
+		if (z_arenas[i].tag == tag)
+			return &z_arenas[i];
+
+	if (!create)
+		return NULL;
+	if (z_numarenas == MAX_ZONE_ARENAS)
+		Com_Error (ERR_FATAL, "Z_TagMalloc: more than %i tags", MAX_ZONE_ARENAS);
+
+	z_arenas[z_numarenas].tag = tag;
+	return &z_arenas[z_numarenas++];
+}
+
 /*
 ========================
 Z_Free
@@ -1226,13 +1888,28 @@ Z_Free
 */
 void Z_Free (void *ptr)
 {
-	zhead_t	*z;
+	zhead_t		*z;
+	zarena_t	*arena;
 
 	z = ((zhead_t *)ptr) - 1;
 
+	if (z->magic == Z_ARENAMAGIC)
+	{
+		Z_CheckGuard (z, "Z_Free");
+		arena = Z_ArenaForTag (z->tag, false);
+		if (!arena)
+			Com_Error (ERR_FATAL, "Z_Free: block with unknown tag %i", z->tag);
+		z->magic = Z_FREEDMAGIC;
+		arena->count--;
+		arena->bytes -= z->size;
+		return;		// the memory comes back with Z_FreeTags
+	}
+
 	if (z->magic != Z_MAGIC)
 		Com_Error (ERR_FATAL, "Z_Free: bad magic");
 
+	Z_CheckGuard (z, "Z_Free");
+
 	z->prev->next = z->next;
 	z->next->prev = z->prev;
 
@@ -1249,24 +1926,107 @@ Z_Stats_f
 */
 void Z_Stats_f (void)
 {
+	zarena_t	*arena;
+	zchunk_t	*c;
+	int			i, chunks;
+
 	Com_Printf ("%i bytes in %i blocks\n", z_bytes, z_count);
+
+	for (i = 0, arena = z_arenas; i < z_numarenas; i++, arena++)
+	{
+		for (chunks = 0, c = arena->chunks; c; c = c->next)
+			chunks++;
+		Com_Printf ("tag %5i: %i bytes in %i blocks, %i bytes in %i chunks\n", arena->tag, arena->bytes, arena->count, arena->reserved, chunks);
+	}
 }
 
 /*
 ========================
 Z_FreeTags
+
+Rewinds the arena, chunks are kept for reuse
 ========================
 */
 void Z_FreeTags (int tag)
 {
-	zhead_t	*z, *next;
+	zarena_t	*arena;
+#ifdef Z_GUARDS
+	zchunk_t	*c;
+	zhead_t		*z;
+	int			ofs;
+#endif
+
+	arena = Z_ArenaForTag (tag, false);
+	if (!arena || !arena->chunks)
+		return;
 
-	for (z=z_chain.next ; z != &z_chain ; z=next)
+#ifdef Z_GUARDS
+	// walk every block, chunks past current are already rewound
+	for (c = arena->chunks; c; c = c->next)
 	{
-		next = z->next;
-		if (z->tag == tag)
-			Z_Free ((void *)(z+1));
+		for (ofs = 0; ofs < c->used; ofs += z->size)
+		{
+			z = (zhead_t *)(Z_CHUNKDATA(c) + ofs);
+			if (z->magic != Z_ARENAMAGIC && z->magic != Z_FREEDMAGIC)
+				Com_Error (ERR_FATAL, "Z_FreeTags: bad magic in tag %i", tag);
+			Z_CheckGuard (z, "Z_FreeTags");
+		}
+		if (c == arena->current)
+			break;
+	}
+#endif
+
+	arena->current = arena->chunks;
+	arena->current->used = 0;
+	arena->count = 0;
+	arena->bytes = 0;
+}
+
+/*
+========================
+Z_ArenaAlloc
+========================
+*/
+static zhead_t *Z_ArenaAlloc (zarena_t *arena, int size)
+{
+	zchunk_t	*c, *prev;
+	int			chunksize;
+
+	c = arena->current;
+	if (c && c->used + size <= c->size)
+	{
+		c->used += size;
+		return (zhead_t *)(Z_CHUNKDATA(c) + c->used - size);
+	}
+
+	// move on to the next chunk that is big enough, or add one after the current
+	prev = c;
+	for (c = c ? c->next : NULL; c; prev = c, c = c->next)
+	{
+		c->used = 0;
+		if (size <= c->size)
+			break;
+	}
+
+	if (!c)
+	{
+		chunksize = size > Z_CHUNKSIZE ? size : Z_CHUNKSIZE;
+		c = malloc (Z_CHUNKHEAD + chunksize);
+		if (!c)
+			Com_Error (ERR_FATAL, "Z_Malloc: failed on allocation of %i bytes", chunksize);
+		c->size = chunksize;
+		c->used = 0;
+		c->next = NULL;
+		if (prev)
+			prev->next = c;
+		else
+			arena->chunks = c;
+		arena->reserved += chunksize;
 	}
+
+	arena->current = c;
+	c->used = size;
+	return (zhead_t *)Z_CHUNKDATA(c);
 }
 
 /*
@@ -1276,9 +2036,28 @@ Z_TagMalloc
 */
 void *Z_TagMalloc (int size, int tag)
 {
-	zhead_t	*z;
+	zhead_t		*z;
+	zarena_t	*arena;
+	int			request;
 	
-	size = size + sizeof(zhead_t);
+	request = size;
+	size = size + sizeof(zhead_t) + Z_GUARDSIZE;
+
+	if (tag)
+	{
+		size = (size + Z_ALIGN - 1) & ~(Z_ALIGN - 1);
+		arena = Z_ArenaForTag (tag, true);
+		z = Z_ArenaAlloc (arena, size);
+		memset (z, 0, size);
+		arena->count++;
+		arena->bytes += size;
+		z->magic = Z_ARENAMAGIC;
+		z->tag = tag;
+		z->size = size;
+		Z_SetGuard (z, request);
+		return (void *)(z+1);
+	}
+
 	z = malloc(size);
 	if (!z)
 		Com_Error (ERR_FATAL, "Z_Malloc: failed on allocation of %i bytes",size);
@@ -1288,6 +2067,7 @@ void *Z_TagMalloc (int size, int tag)
 	z->magic = Z_MAGIC;
 	z->tag = tag;
 	z->size = size;
+	Z_SetGuard (z, request);
 
 	z->next = z_chain.next;
 	z->prev = &z_chain;
@@ -1508,7 +2288,7 @@ void Qcommon_Init (int argc, char **argv)
 	dedicated = Cvar_Get ("dedicated", "0", CVAR_NOSET);
 #endif
 
-	s = va("%S %S %s %s %s", PRAGMA_VERSION, PRAGMA_TIMESTAMP, CPUSTRING, __DATE__, BUILDSTRING);
+	s = va("%s %s %s %s %s", PRAGMA_VERSION, PRAGMA_TIMESTAMP, CPUSTRING, __DATE__, BUILDSTRING);
 	Cvar_Get ("version", s, CVAR_SERVERINFO|CVAR_NOSET);
 
 
@@ -1524,6 +2304,7 @@ void Qcommon_Init (int argc, char **argv)
 	Sys_Init ();
 	NET_Init ();
 	Netchan_Init ();
+	CM_Init ();
 
 	Scr_PreInitVMs();
 
@@ -1599,11 +2380,14 @@ void Qcommon_Frame (int msec)
 	{
 		extern	int c_traces, c_brush_traces;
 		extern	int	c_pointcontents;
+		extern	int	c_tracecache_hits, c_pointcache_hits;
 
-		Com_Printf ("%4i traces  %4i points\n", c_traces, c_pointcontents);
+		Com_Printf ("%4i traces  %4i points  %4i/%4i cached\n", c_traces, c_pointcontents, c_tracecache_hits, c_pointcache_hits);
 		c_traces = 0;
 		c_brush_traces = 0;
 		c_pointcontents = 0;
+		c_tracecache_hits = 0;
+		c_pointcache_hits = 0;
 	}
 
 	do
@@ -23,6 +23,10 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 cvar_t	*cvar_vars;
 
+#define	CVAR_HASH_SIZE	512
+
+static cvar_t	*cvar_hash[CVAR_HASH_SIZE];
+
 /*
 ============
 Cvar_InfoValidate
@@ -48,7 +52,7 @@ static cvar_t *Cvar_FindVar (char *var_name)
 {
 	cvar_t	*var;
 	
-	for (var=cvar_vars ; var ; var=var->next)
+	for (var=cvar_hash[Com_HashKey (var_name, CVAR_HASH_SIZE)] ; var ; var=var->hash_next)
 		if (!strcmp (var_name, var->name))
 			return var;
 
@@ -127,6 +131,7 @@ The flags will be or'ed in if the variable exists.
 cvar_t *Cvar_Get (char *var_name, char *var_value, int flags)
 {
 	cvar_t	*var;
+	unsigned int	hash;
 	
 	if (flags & (CVAR_USERINFO | CVAR_SERVERINFO))
 	{
@@ -165,6 +170,9 @@ cvar_t *Cvar_Get (char *var_name, char *var_value, int flags)
 	// link the variable in
 	var->next = cvar_vars;
 	cvar_vars = var;
+	hash = Com_HashKey (var_name, CVAR_HASH_SIZE);
+	var->hash_next = cvar_hash[hash];
+	cvar_hash[hash] = var;
 
 	var->flags = flags;
 
@@ -56,6 +56,13 @@ typedef struct pack_s
 	FILE	*handle;
 	int		numfiles;
 	packfile_t	*files;
+
+	int		hashsize;	// power of two
+	int		*hash;		// [hashsize] first file with the hash, -1 for none
+	int		*hashnext;	// [numfiles] next file with the same hash, in directory order
+
+	byte	*base;		// whole pak file mapped read only, NULL if it couldn't be mapped
+	int		length;
 } pack_t;
 
 char	fs_gamedir[MAX_OSPATH];
@@ -174,25 +181,55 @@ int	Developer_searchpath (int who)
 
 /*
 ===========
-FS_FOpenFile
+FS_FindPackFile
 
-Finds the file in the search path.
-returns filesize and an open FILE *
-Used for streaming data out of either a pak file or
-a seperate file.
+Case insensitive hashed lookup of a pak directory entry
 ===========
 */
+static packfile_t *FS_FindPackFile (pack_t *pak, char *filename)
+{
+	int		i;
+
+	for (i = pak->hash[Com_HashKey (filename, pak->hashsize)]; i != -1; i = pak->hashnext[i])
+		if (!Q_strcasecmp (pak->files[i].name, filename))
+			return &pak->files[i];
+	return NULL;
+}
+
+/*
+===========
+FS_FileView
+
+Returns the file's data inside the mapped pak, or NULL when it has to be read
+===========
+*/
+static byte *FS_FileView (pack_t *pak, packfile_t *entry)
+{
+	if (!pak->base || entry->filepos < 0 || entry->filelen < 0 || entry->filepos > pak->length - entry->filelen)
+		return NULL;
+	return pak->base + entry->filepos;
+}
+
 int file_from_pak = 0;
 #ifndef NO_ADDONS
-int FS_FOpenFile (char *filename, FILE **file)
+/*
+===========
+FS_FindFile
+
+Same as FS_FOpenFile, but files in mapped paks are not opened, *file is left NULL
+and *view points at the data instead
+===========
+*/
+static int FS_FindFile (char *filename, FILE **file, byte **view)
 {
 	searchpath_t	*search;
 	char			netpath[MAX_OSPATH];
 	pack_t			*pak;
-	int				i;
+	packfile_t		*entry;
 	filelink_t		*link;
 
 	file_from_pak = 0;
+	*view = NULL;
 
 	// check for links first
 	for (link = fs_links ; link ; link=link->next)
@@ -220,18 +257,24 @@ int FS_FOpenFile (char *filename, FILE **file)
 		{
 		// look through all the pak file elements
 			pak = search->pack;
-			for (i=0 ; i<pak->numfiles ; i++)
-				if (!Q_strcasecmp (pak->files[i].name, filename))
-				{	// found it!
-					file_from_pak = 1;
-					Com_DPrintf (DP_FS,"PackFile: %s : %s\n",pak->filename, filename);
-				// open a new file on the pakfile
-					*file = fopen (pak->filename, "rb");
-					if (!*file)
-						Com_Error (ERR_FATAL, "Couldn't reopen %s", pak->filename);	
-					fseek (*file, pak->files[i].filepos, SEEK_SET);
-					return pak->files[i].filelen;
+			entry = FS_FindPackFile (pak, filename);
+			if (entry)
+			{	// found it!
+				file_from_pak = 1;
+				Com_DPrintf (DP_FS,"PackFile: %s : %s\n",pak->filename, filename);
+				*view = FS_FileView (pak, entry);
+				if (*view)
+				{
+					*file = NULL;
+					return entry->filelen;
 				}
+			// open a new file on the pakfile
+				*file = fopen (pak->filename, "rb");
+				if (!*file)
+					Com_Error (ERR_FATAL, "Couldn't reopen %s", pak->filename);	
+				fseek (*file, entry->filepos, SEEK_SET);
+				return entry->filelen;
+			}
 		}
 		else
 		{		
@@ -256,6 +299,37 @@ int FS_FOpenFile (char *filename, FILE **file)
 	return -1;
 }
 
+/*
+===========
+FS_FOpenFile
+
+Finds the file in the search path.
+returns filesize and an open FILE *
+Used for streaming data out of either a pak file or
+a seperate file.
+===========
+*/
+int FS_FOpenFile (char *filename, FILE **file)
+{
+	searchpath_t	*search;
+	byte			*view;
+	int				len;
+
+	len = FS_FindFile (filename, file, &view);
+	if (!view)
+		return len;
+
+	// the caller wants a stream, open the pak the mapping came from
+	for (search = fs_searchpaths ; search ; search = search->next)
+		if (search->pack && search->pack->base && view >= search->pack->base && view <= search->pack->base + search->pack->length)
+			break;
+	*file = fopen (search->pack->filename, "rb");
+	if (!*file)
+		Com_Error (ERR_FATAL, "Couldn't reopen %s", search->pack->filename);	
+	fseek (*file, view - search->pack->base, SEEK_SET);
+	return len;
+}
+
 #else
 
 // this is just for demos to prevent add on hacking
@@ -265,7 +339,7 @@ int FS_FOpenFile (char *filename, FILE **file)
 	searchpath_t	*search;
 	char			netpath[MAX_OSPATH];
 	pack_t			*pak;
-	int				i;
+	packfile_t		*entry;
 
 	file_from_pak = 0;
 
@@ -293,18 +367,18 @@ int FS_FOpenFile (char *filename, FILE **file)
 	}
 
 	pak = search->pack;
-	for (i=0 ; i<pak->numfiles ; i++)
-		if (!Q_strcasecmp (pak->files[i].name, filename))
-		{	// found it!
-			file_from_pak = 1;
-			Com_DPrintf (DP_FS, "PackFile: %s : %s\n",pak->filename, filename);
-		// open a new file on the pakfile
-			*file = fopen (pak->filename, "rb");
-			if (!*file)
-				Com_Error (ERR_FATAL, "Couldn't reopen %s", pak->filename);	
-			fseek (*file, pak->files[i].filepos, SEEK_SET);
-			return pak->files[i].filelen;
-		}
+	entry = FS_FindPackFile (pak, filename);
+	if (entry)
+	{	// found it!
+		file_from_pak = 1;
+		Com_DPrintf (DP_FS, "PackFile: %s : %s\n",pak->filename, filename);
+	// open a new file on the pakfile
+		*file = fopen (pak->filename, "rb");
+		if (!*file)
+			Com_Error (ERR_FATAL, "Couldn't reopen %s", pak->filename);	
+		fseek (*file, entry->filepos, SEEK_SET);
+		return entry->filelen;
+	}
 	
 	Com_DPrintf (DP_FS, "FindFile: can't find %s\n", filename);
 	
@@ -312,6 +386,12 @@ int FS_FOpenFile (char *filename, FILE **file)
 	return -1;
 }
 
+static int FS_FindFile (char *filename, FILE **file, byte **view)
+{
+	*view = NULL;
+	return FS_FOpenFile (filename, file);
+}
+
 #endif
 
 
@@ -362,25 +442,174 @@ void FS_Read (void *buffer, int len, FILE *f)
 	}
 }
 
+/*
+=============================================================================
+
+PREFETCH
+
+Files that are about to be loaded are read ahead in parallel on the job threads.
+Files in mapped paks only get their pages touched, so the view or copy made later
+doesn't wait on the disk. Anything else is read into a buffer that FS_LoadFile then
+hands out instead of reading the file again, up to fs_prefetchmem megabytes.
+Buffers nobody asked for are released by FS_FlushPrefetch.
+
+=============================================================================
+*/
+
+#define	MAX_PREFETCH	2048
+#define	PREFETCH_HASH	1024	// power of two
+#define	PREFETCH_PAGE	4096
+
+typedef struct prefetch_s
+{
+	char		name[MAX_QPATH];
+	int			len;
+	byte		*view;		// mapped pak data to touch
+	FILE		*file;		// or file to read into data
+	byte		*data;
+	qboolean	failed;
+	struct prefetch_s	*hashnext;
+} prefetch_t;
+
+static prefetch_t	fs_prefetch[MAX_PREFETCH];
+static prefetch_t	*fs_prefetchhash[PREFETCH_HASH];
+static int			fs_numprefetch;
+static cvar_t		*fs_prefetchmem;
+
 /*
 ============
-FS_LoadFile
+FS_FindPrefetch
+============
+*/
+static prefetch_t *FS_FindPrefetch (char *path)
+{
+	prefetch_t	*p;
 
-Filename are reletive to the quake search path
-a null buffer will just return the file length without loading
+	for (p = fs_prefetchhash[Com_HashKey (path, PREFETCH_HASH)]; p; p = p->hashnext)
+		if (!Q_strcasecmp (p->name, path))
+			return p;
+	return NULL;
+}
+
+/*
+============
+FS_PrefetchJob
 ============
 */
-int FS_LoadFile (char *path, void **buffer)
+static void FS_PrefetchJob (void *data)
 {
-	FILE	*h;
-	byte	*buf;
-	int		len;
+	prefetch_t		*p = data;
+	volatile byte	touch;
+	int				i;
 
-	buf = NULL;	// quiet compiler warning
+	if (p->view)
+	{
+		for (i = 0; i < p->len; i += PREFETCH_PAGE)
+			touch = p->view[i];
+		(void)touch;
+		return;
+	}
 
-// look for it in the filesystem or pack files
-	len = FS_FOpenFile (path, &h);
-	if (!h)
+	if (fread (p->data, 1, p->len, p->file) != p->len)
+		p->failed = true;
+}
+
+/*
+============
+FS_FlushPrefetch
+
+Frees prefetched data that was never loaded
+============
+*/
+void FS_FlushPrefetch (void)
+{
+	int		i;
+
+	for (i = 0; i < fs_numprefetch; i++)
+		if (fs_prefetch[i].data)
+			Z_Free (fs_prefetch[i].data);
+
+	memset (fs_prefetchhash, 0, sizeof(fs_prefetchhash));
+	fs_numprefetch = 0;
+}
+
+/*
+============
+FS_PrefetchFiles
+
+Reads the files ahead on the job threads, missing files are skipped
+============
+*/
+void FS_PrefetchFiles (char **names, int count)
+{
+	prefetch_t	*p, *jobs[MAX_PREFETCH];
+	int			i, key, size, budget, start;
+
+	FS_FlushPrefetch ();
+
+	start = Sys_Milliseconds ();
+	size = 0;
+	budget = fs_prefetchmem ? fs_prefetchmem->value * 1024 * 1024 : 0;
+
+	for (i = 0; i < count && fs_numprefetch < MAX_PREFETCH; i++)
+	{
+		if (!names[i] || !names[i][0] || strlen (names[i]) >= MAX_QPATH || FS_FindPrefetch (names[i]))
+			continue;
+
+		p = &fs_prefetch[fs_numprefetch];
+		memset (p, 0, sizeof(*p));
+		p->len = FS_FindFile (names[i], &p->file, &p->view);
+		if (!p->file && !p->view)
+			continue;
+
+		if (!p->view)
+		{
+			if (size + p->len > budget)
+			{
+				fclose (p->file);
+				continue;
+			}
+			size += p->len;
+			p->data = Z_Malloc (p->len);
+		}
+
+		strcpy (p->name, names[i]);
+		key = Com_HashKey (p->name, PREFETCH_HASH);
+		p->hashnext = fs_prefetchhash[key];
+		fs_prefetchhash[key] = p;
+		jobs[fs_numprefetch++] = p;
+	}
+
+	Sys_RunJobs (FS_PrefetchJob, (void **)jobs, fs_numprefetch);
+
+	for (i = 0; i < fs_numprefetch; i++)
+	{
+		p = &fs_prefetch[i];
+		if (p->file)
+			fclose (p->file);
+		p->file = NULL;
+		if (p->failed)
+		{
+			Z_Free (p->data);
+			p->data = NULL;
+		}
+	}
+
+	Com_DPrintf (DP_FS, "prefetched %i files, %i kb read, %i ms\n", fs_numprefetch, size >> 10, Sys_Milliseconds () - start);
+}
+
+/*
+============
+FS_LoadFound
+
+Copies a file found by FS_FindFile to a new buffer and closes its handle
+============
+*/
+static int FS_LoadFound (FILE *h, byte *view, int len, void **buffer)
+{
+	byte	*buf;
+
+	if (!h && !view)
 	{
 		if (buffer)
 			*buffer = NULL;
@@ -389,13 +618,20 @@ int FS_LoadFile (char *path, void **buffer)
 	
 	if (!buffer)
 	{
-		fclose (h);
+		if (h)
+			fclose (h);
 		return len;
 	}
 
 	buf = Z_Malloc(len);
 	*buffer = buf;
 
+	if (view)
+	{
+		memcpy (buf, view, len);
+		return len;
+	}
+
 	FS_Read (buf, len, h);
 
 	fclose (h);
@@ -403,6 +639,66 @@ int FS_LoadFile (char *path, void **buffer)
 	return len;
 }
 
+/*
+============
+FS_LoadFile
+
+Filename are reletive to the quake search path
+a null buffer will just return the file length without loading
+============
+*/
+int FS_LoadFile (char *path, void **buffer)
+{
+	FILE	*h;
+	byte	*view;
+	int		len;
+
+// take it if it was read ahead
+	if (fs_numprefetch && buffer)
+	{
+		prefetch_t	*p = FS_FindPrefetch (path);
+
+		if (p && p->data)
+		{
+			*buffer = p->data;
+			p->data = NULL;
+			return p->len;
+		}
+	}
+
+// look for it in the filesystem or pack files
+	len = FS_FindFile (path, &h, &view);
+	return FS_LoadFound (h, view, len, buffer);
+}
+
+/*
+============
+FS_LoadFileView
+
+Same as FS_LoadFile, but files in mapped paks are returned in place without a copy.
+The data must not be modified and has to be released with FS_FreeFile before the
+game directory changes
+============
+*/
+int FS_LoadFileView (char *path, void **buffer)
+{
+	FILE	*h;
+	byte	*view;
+	int		len;
+	prefetch_t	*p;
+
+	if (fs_numprefetch && (p = FS_FindPrefetch (path)) && p->data)
+		return FS_LoadFile (path, buffer);
+
+	len = FS_FindFile (path, &h, &view);
+	if (!view)
+		return FS_LoadFound (h, NULL, len, buffer);	// loose files are read from the handle
+
+	if (buffer)
+		*buffer = view;
+	return len;
+}
+
 
 /*
 =============
@@ -411,6 +707,13 @@ FS_FreeFile
 */
 void FS_FreeFile (void *buffer)
 {
+	searchpath_t	*search;
+
+	// views into mapped paks are not allocated
+	for (search = fs_searchpaths ; search ; search = search->next)
+		if (search->pack && search->pack->base && (byte *)buffer >= search->pack->base && (byte *)buffer <= search->pack->base + search->pack->length)
+			return;
+
 	Z_Free (buffer);
 }
 
@@ -433,7 +736,6 @@ pack_t *FS_LoadPackFile (char *packfile)
 	pack_t			*pack;
 	FILE			*packhandle;
 	dpackfile_t		info[MAX_FILES_IN_PACK];
-	unsigned		checksum;
 
 	packhandle = fopen(packfile, "rb");
 	if (!packhandle)
@@ -455,11 +757,9 @@ pack_t *FS_LoadPackFile (char *packfile)
 	fseek (packhandle, header.dirofs, SEEK_SET);
 	fread (info, 1, header.dirlen, packhandle);
 
-// crc the directory to check for modifications
-	checksum = Com_BlockChecksum ((void *)info, header.dirlen);
-
 #ifdef NO_ADDONS
-	if (checksum != PAK0_CHECKSUM)
+// crc the directory to check for modifications
+	if (Com_BlockChecksum ((void *)info, header.dirlen) != PAK0_CHECKSUM)
 		return NULL;
 #endif
 // parse the directory
@@ -475,8 +775,25 @@ pack_t *FS_LoadPackFile (char *packfile)
 	pack->handle = packhandle;
 	pack->numfiles = numpackfiles;
 	pack->files = newfiles;
+
+// hash the directory, chains are built backwards so the first of duplicate names is found first
+	for (pack->hashsize = 64; pack->hashsize < numpackfiles; pack->hashsize <<= 1)
+		;
+	pack->hash = Z_Malloc (pack->hashsize * sizeof(int));
+	pack->hashnext = Z_Malloc ((numpackfiles + 1) * sizeof(int));
+	for (i=0 ; i<pack->hashsize ; i++)
+		pack->hash[i] = -1;
+	for (i=numpackfiles-1 ; i>=0 ; i--)
+	{
+		int		key = Com_HashKey (newfiles[i].name, pack->hashsize);
+
+		pack->hashnext[i] = pack->hash[key];
+		pack->hash[key] = i;
+	}
+
+	pack->base = Sys_MapFile (packfile, &pack->length);
 	
-	Com_Printf ("Added packfile %s (%i files)\n", packfile, numpackfiles);
+	Com_Printf ("Added packfile %s (%i files%s)\n", packfile, numpackfiles, pack->base ? ", mapped" : "");
 	return pack;
 }
 
@@ -575,6 +892,8 @@ void FS_SetGamedir (char *dir)
 		return;
 	}
 
+	FS_FlushPrefetch ();
+
 	//
 	// free up any current game dir info
 	//
@@ -583,6 +902,10 @@ void FS_SetGamedir (char *dir)
 		if (fs_searchpaths->pack)
 		{
 			fclose (fs_searchpaths->pack->handle);
+			if (fs_searchpaths->pack->base)
+				Sys_UnmapFile (fs_searchpaths->pack->base, fs_searchpaths->pack->length);
+			Z_Free (fs_searchpaths->pack->hash);
+			Z_Free (fs_searchpaths->pack->hashnext);
 			Z_Free (fs_searchpaths->pack->files);
 			Z_Free (fs_searchpaths->pack);
 		}
@@ -835,6 +1158,9 @@ void FS_InitFilesystem (void)
 	// allows the game to run from outside the data tree
 	//
 	fs_cddir = Cvar_Get ("cddir", "", CVAR_NOSET);
+
+	// how much of loose and unmapped files FS_PrefetchFiles may read ahead
+	fs_prefetchmem = Cvar_Get ("fs_prefetchmem", "64", CVAR_ARCHIVE);
 	if (fs_cddir->string[0])
 		FS_AddGameDirectory (va("%s/"BASEDIRNAME, fs_cddir->string) );
 
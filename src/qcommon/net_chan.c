@@ -24,12 +24,24 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 packet header
 -------------
-31	sequence
+30	sequence
+1	packet carries a fragment of the message
 1	does this message contain a reliable payload
 31	acknowledge sequence
 1	acknowledge receipt of even/odd message
 16	qport
 
+fragment header (only when the fragment bit is set)
+---------------
+15	offset of the fragment in the message
+1	more fragments follow
+
+Messages up to MAX_NETMSGLEN which don't fit in a MAX_MSGLEN packet are split
+in fragments, all sent at once with the same sequence number. The receiver
+puts them back together in order and only processes the message once the last
+one is in, losing any fragment loses the whole message just like losing a 
+packet, so the reliable part is resent the usual way.
+
 The remote connection never knows if it missed a reliable message, the
 local side detects that it has been dropped by seeing a sequence acknowledge
 higher thatn the last reliable sequence, but without the correct evon/odd
@@ -80,7 +92,11 @@ cvar_t		*net_qport;
 
 netadr_t	net_from;
 sizebuf_t	net_message;
-byte		net_message_buffer[MAX_MSGLEN];
+byte		net_message_buffer[MAX_NETMSGLEN+PACKET_HEADER];
+
+#define	FRAGMENT_BIT	(1<<30)		// in the sequence
+#define	FRAGMENT_MORE	0x8000		// in the fragment offset
+#define	FRAGMENT_SIZE	(MAX_MSGLEN - PACKET_HEADER - 2)
 
 /*
 ===============
@@ -212,10 +228,12 @@ A 0 length will still generate a packet and deal with the reliable messages.
 */
 void Netchan_Transmit (netchan_t *chan, int length, byte *data)
 {
-	sizebuf_t	send;
-	byte		send_buf[MAX_MSGLEN];
+	sizebuf_t	send, frag;
+	byte		send_buf[MAX_NETMSGLEN+PACKET_HEADER];
+	byte		frag_buf[MAX_MSGLEN];
 	qboolean	send_reliable;
 	unsigned	w1, w2;
+	int			headerlen, offset, fraglen, numfrags;
 
 // check for message overflow
 	if (chan->message.overflowed)
@@ -239,7 +257,7 @@ void Netchan_Transmit (netchan_t *chan, int length, byte *data)
 // write the packet header
 	SZ_Init (&send, send_buf, sizeof(send_buf));
 
-	w1 = ( chan->outgoing_sequence & ~(1<<31) ) | (send_reliable<<31);
+	w1 = ( chan->outgoing_sequence & ~((1<<31) | FRAGMENT_BIT) ) | (send_reliable<<31);
 	w2 = ( chan->incoming_sequence & ~(1<<31) ) | (chan->incoming_reliable_sequence<<31);
 
 	chan->outgoing_sequence++;
@@ -252,6 +270,8 @@ void Netchan_Transmit (netchan_t *chan, int length, byte *data)
 	if (chan->sock == NS_CLIENT)
 		MSG_WriteShort (&send, net_qport->value);
 
+	headerlen = send.cursize;
+
 // copy the reliable message to the packet first
 	if (send_reliable)
 	{
@@ -265,11 +285,38 @@ void Netchan_Transmit (netchan_t *chan, int length, byte *data)
 	else
 		Com_Printf ("Netchan_Transmit: dumped unreliable\n");
 
-// send the datagram
-	NET_SendPacket (chan->sock, send.cursize, send.data, chan->remote_address);
+// send the datagram, or its fragments when it doesn't fit in one
+	numfrags = 0;
+	if (send.cursize <= MAX_MSGLEN || chan->remote_address.type == NA_LOOPBACK)
+		NET_SendPacket (chan->sock, send.cursize, send.data, chan->remote_address);
+	else
+	{
+		for (offset = headerlen; offset < send.cursize; offset += fraglen, numfrags++)
+		{
+			fraglen = send.cursize - offset;
+			if (fraglen > FRAGMENT_SIZE)
+				fraglen = FRAGMENT_SIZE;
+
+			SZ_Init (&frag, frag_buf, sizeof(frag_buf));
+			MSG_WriteLong (&frag, w1 | FRAGMENT_BIT);
+			MSG_WriteLong (&frag, w2);
+			if (chan->sock == NS_CLIENT)
+				MSG_WriteShort (&frag, net_qport->value);
+			MSG_WriteShort (&frag, (offset - headerlen) | (offset + fraglen < send.cursize ? FRAGMENT_MORE : 0));
+			SZ_Write (&frag, send.data + offset, fraglen);
+
+			NET_SendPacket (chan->sock, frag.cursize, frag.data, chan->remote_address);
+		}
+	}
 
 	if (net_showpackets->value)
 	{
+		if (numfrags)
+			Com_Printf ("send %4i : seq=%i in %i fragments\n"
+				, send.cursize
+				, chan->outgoing_sequence - 1
+				, numfrags);
+
 		if (send_reliable)
 			Com_Printf ("send %4i : seq=%i reliable=%i ack=%i rack=%i\n"
 				, send.cursize
@@ -298,7 +345,8 @@ qboolean Netchan_Process (netchan_t *chan, sizebuf_t *msg)
 {
 	unsigned	sequence, sequence_ack;
 	unsigned	reliable_ack, reliable_message;
-	int			qport;
+	qboolean	fragmented;
+	int			headerlen, offset, length;
 
 // get sequence numbers		
 	MSG_BeginReading (msg);
@@ -307,12 +355,13 @@ qboolean Netchan_Process (netchan_t *chan, sizebuf_t *msg)
 
 	// read the qport if we are a server
 	if (chan->sock == NS_SERVER)
-		qport = MSG_ReadShort (msg);
+		MSG_ReadShort (msg);
 
 	reliable_message = sequence >> 31;
 	reliable_ack = sequence_ack >> 31;
+	fragmented = (sequence & FRAGMENT_BIT) != 0;
 
-	sequence &= ~(1<<31);
+	sequence &= ~((1<<31) | FRAGMENT_BIT);
 	sequence_ack &= ~(1<<31);	
 
 	if (net_showpackets->value)
@@ -345,6 +394,51 @@ qboolean Netchan_Process (netchan_t *chan, sizebuf_t *msg)
 		return false;
 	}
 
+//
+// put fragmented messages back together, nothing else is done until the last one is in
+//
+	if (fragmented)
+	{
+		headerlen = msg->readcount;
+		offset = MSG_ReadShort (msg) & 0xffff;
+		length = msg->cursize - msg->readcount;
+
+		if (chan->fragment_sequence != sequence)
+		{	// start of a new message, drops whatever was left of an older one
+			chan->fragment_sequence = sequence;
+			chan->fragment_length = 0;
+		}
+
+		if ((offset & ~FRAGMENT_MORE) != chan->fragment_length)
+		{
+			if (net_showdrop->value)
+				Com_Printf ("%s: Dropped fragment of %i at offset %i\n"
+					, NET_AdrToString (chan->remote_address)
+					, sequence
+					, offset & ~FRAGMENT_MORE);
+			return false;
+		}
+
+		if (chan->fragment_length + length > sizeof(chan->fragment_buf) || headerlen + chan->fragment_length + length > msg->maxsize)
+		{
+			Com_Printf ("%s: Oversize fragmented message %i\n", NET_AdrToString (chan->remote_address), sequence);
+			chan->fragment_length = 0;
+			return false;
+		}
+
+		memcpy (chan->fragment_buf + chan->fragment_length, msg->data + msg->readcount, length);
+		chan->fragment_length += length;
+
+		if (offset & FRAGMENT_MORE)
+			return false;
+
+		// the whole message follows the header as if it came in one packet
+		memcpy (msg->data + headerlen, chan->fragment_buf, chan->fragment_length);
+		msg->cursize = headerlen + chan->fragment_length;
+		msg->readcount = headerlen;
+		chan->fragment_length = 0;
+	}
+
 //
 // dropped packets don't keep the message from being used
 //
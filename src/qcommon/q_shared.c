@@ -1213,6 +1213,43 @@ int Q_strcasecmp (char *s1, char *s2)
 	return Q_strncasecmp (s1, s2, 99999);
 }
 
+// portable replacement for _strlwr
+char *Q_strlwr (char *s)
+{
+	char	*p;
+
+	for (p = s; *p; p++)
+	{
+		if (*p >= 'A' && *p <= 'Z')
+			*p += ('a' - 'A');
+	}
+	return s;
+}
+
+/*
+============
+Com_HashKey
+
+Returns hash of a string in range 0..hashSize-1, hashSize must be a power of two.
+Case insensitive, so it can be used with both strcmp and Q_strcasecmp lookups
+============
+*/
+unsigned int Com_HashKey (const char *string, unsigned int hashSize)
+{
+	unsigned int	hash;
+	int				c;
+
+	hash = 0;
+	while ((c = *string++) != 0)
+	{
+		if (c >= 'A' && c <= 'Z')
+			c += ('a' - 'A');
+		hash = hash * 31 + c;
+	}
+	hash ^= (hash >> 16);
+	return hash & (hashSize - 1);
+}
+
 
 
 void Com_sprintf (char *dest, int size, char *fmt, ...)
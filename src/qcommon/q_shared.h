@@ -43,6 +43,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include <stdarg.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stddef.h>
+#include <limits.h>
 #include <time.h>
 
 #define C_ONLY 1
@@ -56,6 +58,16 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 typedef unsigned char 		byte;
 typedef enum {false, true}	qboolean;
 
+#ifndef _WIN32
+// msvc provides these in stdlib.h
+#ifndef min
+#define min(a,b)	((a) < (b) ? (a) : (b))
+#endif
+#ifndef max
+#define max(a,b)	((a) > (b) ? (a) : (b))
+#endif
+#endif
+
 
 #ifndef NULL
 #define NULL ((void *)0)
@@ -262,6 +274,10 @@ void Com_PageInMemory (byte *buffer, int size);
 int Q_stricmp (char *s1, char *s2);
 int Q_strcasecmp (char *s1, char *s2);
 int Q_strncasecmp (char *s1, char *s2, int n);
+char *Q_strlwr (char *s);
+
+// case insensitive string hash for lookup tables, hashSize must be a power of two
+unsigned int Com_HashKey (const char *string, unsigned int hashSize);
 
 //=============================================
 
@@ -359,6 +375,7 @@ typedef struct cvar_s
 	qboolean	modified;	// set each time the cvar is changed
 	float		value;
 	struct cvar_s *next;
+	struct cvar_s *hash_next;
 } cvar_t;
 
 #endif		// CVAR
@@ -36,6 +36,24 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define	CPUSTRING	"x86"
 #endif
 
+#elif defined __linux__
+
+#ifndef _DEBUG
+#define BUILDSTRING "Linux RELEASE"
+#else
+#define BUILDSTRING "Linux DEBUG"
+#endif
+
+#if defined __x86_64__
+#define	CPUSTRING	"x86_64"
+#elif defined __i386__
+#define	CPUSTRING	"x86"
+#elif defined __aarch64__
+#define	CPUSTRING	"arm64"
+#else
+#define	CPUSTRING	"Unknown"
+#endif
+
 #else	// !WIN32
 
 #define BUILDSTRING "NON-WIN32"
@@ -67,6 +85,7 @@ typedef struct sizebuf_s
 	int		maxsize;
 	int		cursize;
 	int		readcount;
+	int		bit;			// bits used of the last byte written or read, 0 when byte aligned
 } sizebuf_t;
 
 void SZ_Init (sizebuf_t *buf, byte *data, int length);
@@ -136,6 +155,12 @@ void MSG_WriteAngle (sizebuf_t *sb, float f);
 void MSG_WriteAngle16 (sizebuf_t *sb, float f);
 void MSG_WriteDeltaUsercmd (sizebuf_t *sb, struct usercmd_s *from, struct usercmd_s *cmd);
 void MSG_WriteDeltaEntity (struct entity_state_s *from, struct entity_state_s *to, sizebuf_t *msg, qboolean force, qboolean newentity);
+qboolean MSG_ClampEntityRender (struct entity_state_s *from, struct entity_state_s *to);
+void MSG_WriteDeltaEntityFormat (struct entity_state_s *from, struct entity_state_s *to, sizebuf_t *msg, qboolean force, qboolean newentity, qboolean packed);
+void MSG_WriteEntityBits (sizebuf_t *msg, int bits, int number);
+void MSG_WriteEntityBitsFormat (sizebuf_t *msg, int bits, int number, qboolean packed);
+void MSG_WriteBits (sizebuf_t *sb, int value, int bits);
+void MSG_AlignBits (sizebuf_t *sb);
 void MSG_WriteDir (sizebuf_t *sb, vec3_t vector);
 
 
@@ -157,6 +182,9 @@ float	MSG_ReadAngle16 (sizebuf_t *sb);
 void	MSG_ReadDeltaUsercmd (sizebuf_t *sb, struct usercmd_s *from, struct usercmd_s *cmd);
 
 void	MSG_ReadDir (sizebuf_t *sb, vec3_t vector);
+int		MSG_ReadBits (sizebuf_t *sb, int bits);
+int		MSG_ReadPackedEntityBits (sizebuf_t *sb, unsigned *bits);
+void	MSG_ReadPackedEntity (sizebuf_t *sb, struct entity_state_s *from, struct entity_state_s *to, int bits);
 
 void	MSG_ReadData (sizebuf_t *sb, void *buffer, int size);
 
@@ -209,7 +237,7 @@ PROTOCOL
 
 // protocol.h -- communications protocols
 
-#define PROTOCOL_REVISION 1
+#define PROTOCOL_REVISION 3	// 2: fragmented netchan messages, 3: bit packed entity deltas
 #ifdef PROTOCOL_EXTENDED_ASSETS
 	#define	PROTOCOL_VERSION	('B'+'X'+PROTOCOL_REVISION)
 #else
@@ -375,6 +403,12 @@ enum clc_ops_e
 #define	U_RENDERCOLOR		(1<<30)
 
 #define	U_FREE4				(1<<31)
+
+// PROTOCOL_PACKED_ENTITIES sends the entity number in a fixed bit count
+#define	ENTITYNUM_BITS		10
+#if (1<<ENTITYNUM_BITS) < MAX_GENTITIES
+	#error "ENTITYNUM_BITS is too small for MAX_GENTITIES"
+#endif
 /*
 ==============================================================
 
@@ -569,10 +603,11 @@ NET
 
 #define	PORT_ANY	-1
 
-#define	MAX_MSGLEN		1400		// max length of a message
+#define	MAX_MSGLEN		1400		// max length of a message in a single packet
+#define	MAX_NETMSGLEN	16384		// max length of a netchan message, fragmented when over MAX_MSGLEN
 #define	PACKET_HEADER	10			// two ints and a short
 
-typedef enum {NA_LOOPBACK, NA_BROADCAST, NA_IP } netadrtype_t;
+typedef enum {NA_LOOPBACK, NA_BROADCAST, NA_IP, NA_IP6 } netadrtype_t;
 
 typedef enum {NS_CLIENT, NS_SERVER} netsrc_t;
 
@@ -580,6 +615,8 @@ typedef struct
 {
 	netadrtype_t	type;
 	byte			ip[4];
+	byte			ip6[16];
+	unsigned int	scope_id;	// NA_IP6 link local scope
 	unsigned short	port;
 } netadr_t;
 
@@ -590,6 +627,8 @@ void		NET_Config (qboolean multiplayer);
 
 qboolean	NET_GetPacket (netsrc_t sock, netadr_t *net_from, sizebuf_t *net_message);
 void		NET_SendPacket (netsrc_t sock, int length, void *data, netadr_t to);
+void		NET_BeginBatch (netsrc_t sock);	// queue NET_SendPacket datagrams ...
+void		NET_FlushBatch (netsrc_t sock);	// ... and send them all at once
 
 qboolean	NET_CompareAdr (netadr_t a, netadr_t b);
 qboolean	NET_CompareBaseAdr (netadr_t a, netadr_t b);
@@ -627,16 +666,21 @@ typedef struct
 
 // reliable staging and holding areas
 	sizebuf_t	message;		// writing buffer to send to server
-	byte		message_buf[MAX_MSGLEN-16];		// leave space for header
+	byte		message_buf[MAX_NETMSGLEN-16];	// leave space for header
 
 // message is copied to this buffer when it is first transfered
 	int			reliable_length;
-	byte		reliable_buf[MAX_MSGLEN-16];	// unacked reliable message
+	byte		reliable_buf[MAX_NETMSGLEN-16];	// unacked reliable message
+
+// message being reassembled from fragments
+	int			fragment_sequence;
+	int			fragment_length;
+	byte		fragment_buf[MAX_NETMSGLEN];
 } netchan_t;
 
 extern	netadr_t	net_from;
 extern	sizebuf_t	net_message;
-extern	byte		net_message_buffer[MAX_MSGLEN];
+extern	byte		net_message_buffer[MAX_NETMSGLEN+PACKET_HEADER];
 
 
 void Netchan_Init (void);
@@ -662,6 +706,7 @@ CMODEL
 
 #include "../qcommon/qfiles.h"
 
+void		CM_Init (void);
 cmodel_t	*CM_LoadMap (char *name, qboolean clientload, unsigned *checksum);
 cmodel_t	*CM_InlineModel (char *name);	// *1, *2, etc
 
@@ -708,6 +753,47 @@ qboolean	CM_HeadnodeVisible (int headnode, byte *visbits);
 void		CM_WritePortalState (FILE *f);
 void		CM_ReadPortalState (FILE *f);
 
+/*
+Collision context, everything a trace changes while it runs. Each thread 
+that traces owns one, the functions above use a shared default context 
+and are only safe on the main thread. A zeroed context is ready to use.
+The leaf functions (CM_PointLeafnum, CM_BoxLeafnums, CM_Leaf*) and 
+CM_HeadnodeVisible don't change any state and can be called from any thread.
+*/
+typedef struct
+{
+	int			checkcount;						// to avoid repeated testings
+	int			brushcheck[MAX_MAP_BRUSHES];	// checkcount each brush was last tested with
+	cplane_t	box_planes[12];					// set by CM_HeadnodeForBoxCtx
+
+	byte		pvsrow[MAX_MAP_LEAFS/8];
+	byte		phsrow[MAX_MAP_LEAFS/8];
+
+	// trace in progress
+	vec3_t		start, end;
+	vec3_t		mins, maxs;
+	vec3_t		extents;
+	trace_t		trace;
+	int			contents;
+	qboolean	ispoint;						// optimized case
+} cmcontext_t;
+
+int			CM_HeadnodeForBoxCtx (cmcontext_t *ctx, vec3_t mins, vec3_t maxs);
+
+int			CM_PointContentsCtx (cmcontext_t *ctx, vec3_t p, int headnode);
+int			CM_TransformedPointContentsCtx (cmcontext_t *ctx, vec3_t p, int headnode, vec3_t origin, vec3_t angles);
+
+trace_t		CM_BoxTraceCtx (cmcontext_t *ctx, vec3_t start, vec3_t end,
+						  vec3_t mins, vec3_t maxs,
+						  int headnode, int brushmask);
+trace_t		CM_TransformedBoxTraceCtx (cmcontext_t *ctx, vec3_t start, vec3_t end,
+						  vec3_t mins, vec3_t maxs,
+						  int headnode, int brushmask,
+						  vec3_t origin, vec3_t angles);
+
+byte		*CM_ClusterPVSCtx (cmcontext_t *ctx, int cluster);
+byte		*CM_ClusterPHSCtx (cmcontext_t *ctx, int cluster);
+
 /*
 ==============================================================
 
@@ -744,11 +830,20 @@ int		FS_LoadFile (char *path, void **buffer);
 // a null buffer will just return the file length without loading
 // a -1 length is not present
 
+int		FS_LoadFileView (char *path, void **buffer);
+// same as FS_LoadFile, but data from mapped pak files is returned in place,
+// it is read only and must be freed with FS_FreeFile before a gamedir change
+
 void	FS_Read (void *buffer, int len, FILE *f);
 // properly handles partial reads
 
 void	FS_FreeFile (void *buffer);
 
+void	FS_PrefetchFiles (char **names, int count);
+// reads the files ahead on the job threads, the next FS_LoadFile of each is served from memory
+void	FS_FlushPrefetch (void);
+// frees whatever was prefetched but not loaded
+
 void	FS_CreatePath (char *path);
 
 
@@ -838,6 +933,14 @@ void	Sys_Error (char *error, ...);
 void	Sys_Quit (void);
 char	*Sys_GetClipboardData( void );
 
+void	Sys_RunJobs (void (*func)(void *data), void **data, int count);
+// calls func for every element of data, spread over worker threads and the 
+// calling thread, returns once all of them are done. func must be thread safe
+
+void	*Sys_MapFile (char *path, int *length);
+void	Sys_UnmapFile (void *base, int length);
+// maps a whole file read only, returns NULL if the platform can't
+
 /*
 ==============================================================
 
@@ -856,6 +959,7 @@ void SCR_BeginLoadingPlaque (void);
 void SV_Init (void);
 void SV_Shutdown (char *finalmsg, qboolean reconnect);
 void SV_Frame (int msec);
+int SV_FrameWait (void);
 
 qboolean Com_IsServerActive();
 qboolean Con_IsClientActive();
@@ -28,7 +28,7 @@ FIXME someday
 static char* progstring()
 {
 	if (pr_temp_string_num == -1)
-		memset(&pr_temp_string, sizeof(pr_temp_string), 0);
+		memset(&pr_temp_string, 0, sizeof(pr_temp_string));
 
 	pr_temp_string_num++;
 	if (pr_temp_string_num >= MAX_PARMS)
@@ -183,7 +183,7 @@ void PF_localcmd(void)
 	char* str;
 		
 	str = Scr_GetParmString(0);
-	if (!str || str == "")
+	if (!str || !str[0])
 	{
 		Scr_RunError("localcmd(): empty string\n");
 		return;
@@ -250,7 +250,7 @@ void PF_cvar(void)
 	cvar_t* cvar;
 
 	str = Scr_GetParmString(0);
-	if (!str || str == "")
+	if (!str || !str[0])
 	{
 		Scr_RunError("cvar(): without name\n");
 		return;
@@ -284,7 +284,7 @@ void PF_cvarstring(void)
 	cvar_t* cvar;
 
 	str = Scr_GetParmString(0);
-	if (!str || str == "")
+	if (!str || !str[0])
 	{
 		Scr_RunError("cvarstring(): without name\n");
 		return;
@@ -317,7 +317,7 @@ void PF_cvarset(void)
 	char *str, *value;
 
 	str = Scr_GetParmString(0);
-	if (!str || str == "")
+	if (!str || !str[0])
 	{
 		Scr_RunError("cvarset(): without name\n");
 		return;
@@ -341,7 +341,7 @@ void PF_cvarforceset(void)
 	char* str, * value;
 
 	str = Scr_GetParmString(0);
-	if (!str || str == "")
+	if (!str || !str[0])
 	{
 		Scr_RunError("cvarforceset(): empty name\n");
 		return;
@@ -353,6 +353,115 @@ void PF_cvarforceset(void)
 }
 
 
+// ===================== cvar handles =====================
+
+// handles index this table and are never released, cvars live for the whole run
+#define MAX_CVAR_HANDLES 256
+
+static cvar_t* scr_cvarhandles[MAX_CVAR_HANDLES];
+static int scr_numcvarhandles;
+
+/*
+=================
+Scr_CvarForHandle
+=================
+*/
+static cvar_t* Scr_CvarForHandle(char* caller)
+{
+	int h = (int)Scr_GetParmFloat(0);
+
+	if (h < 1 || h > scr_numcvarhandles)
+	{
+		Scr_RunError("%s(%i): bad cvar handle\n", caller, h);
+		return NULL;
+	}
+	return scr_cvarhandles[h - 1];
+}
+
+/*
+=================
+PF_cvarhandle
+
+resolves a cvar name once, returns a handle for cvarvalue() and cvarhandlestring()
+or 0 when the cvar does not exist
+
+float cvarhandle(string cvarname)
+
+float h_gravity = cvarhandle("sv_gravity");
+=================
+*/
+void PF_cvarhandle(void)
+{
+	char* str;
+	cvar_t* cvar;
+	int i;
+
+	str = Scr_GetParmString(0);
+	if (!str || !str[0])
+	{
+		Scr_RunError("cvarhandle(): without name\n");
+		return;
+	}
+
+	cvar = Cvar_Get(str, NULL, 0);
+	if (!cvar)
+	{
+		Com_DPrintf(0, "cvarhandle(%s): not found\n", str);
+		Scr_ReturnFloat(0);
+		return;
+	}
+
+	for (i = 0; i < scr_numcvarhandles; i++)
+	{
+		if (scr_cvarhandles[i] == cvar)
+		{
+			Scr_ReturnFloat(i + 1);
+			return;
+		}
+	}
+
+	if (scr_numcvarhandles == MAX_CVAR_HANDLES)
+	{
+		Scr_RunError("cvarhandle(%s): more than %i handles\n", str, MAX_CVAR_HANDLES);
+		return;
+	}
+
+	scr_cvarhandles[scr_numcvarhandles++] = cvar;
+	Scr_ReturnFloat(scr_numcvarhandles);
+}
+
+/*
+=================
+PF_cvarvalue
+
+returns the value of a cvar by handle, no name lookup
+
+float cvarvalue(float handle)
+
+float gravity = cvarvalue(h_gravity);
+=================
+*/
+void PF_cvarvalue(void)
+{
+	cvar_t* cvar = Scr_CvarForHandle("cvarvalue");
+	Scr_ReturnFloat(cvar ? cvar->value : 0);
+}
+
+/*
+=================
+PF_cvarhandlestring
+
+returns the string of a cvar by handle, no name lookup
+
+string cvarhandlestring(float handle)
+=================
+*/
+void PF_cvarhandlestring(void)
+{
+	cvar_t* cvar = Scr_CvarForHandle("cvarhandlestring");
+	Scr_ReturnString(cvar ? cvar->string : retstr_none);
+}
+
 /*
 =================
 PF_ftos
@@ -526,3 +635,19 @@ void Scr_InitSharedBuiltins()
 	// math
 	Scr_InitMathBuiltins();
 }
+
+/*
+=================
+Scr_InitLateSharedBuiltins
+
+Shared builtins added after the client and server lists were settled,
+registered last so the numbers of existing builtins do not change
+=================
+*/
+void Scr_InitLateSharedBuiltins()
+{
+	// cvar handles
+	Scr_DefineBuiltin(PF_cvarhandle, PF_ALL, "cvarhandle", "float(string str)");
+	Scr_DefineBuiltin(PF_cvarvalue, PF_ALL, "cvarvalue", "float(float h)");
+	Scr_DefineBuiltin(PF_cvarhandlestring, PF_ALL, "cvarhandlestring", "string(float h)");
+}
@@ -14,20 +14,6 @@ See the attached GNU General Public License v2 for more details.
 #include "script_internals.h"
 
 
-static int type_size[9] = 
-{ 
-	/*vanilla QC*/
-	1,							// ev_void
-	sizeof(scr_string_t) / 4,	// ev_string
-	1,							// ev_float
-	3,							// ev_vector
-	1,							// ev_entity
-	1,							// ev_field
-	sizeof(scr_func_t) / 4,		// ev_function
-	sizeof(void*) / 4,			// ev_pointer
-	1							// FTEQC: ev_integer
-};
-
 ddef_t* ScrInternal_GlobalAtOfs(int ofs);
 ddef_t* ScrInternal_FieldAtOfs(int ofs);
 
@@ -180,7 +166,7 @@ char* Scr_GlobalString(int ofs)
 	val = (void*)&active_qcvm->globals[ofs];
 	def = ScrInternal_GlobalAtOfs(ofs);
 	if (!def)
-		sprintf(line, "%i(???)", ofs);
+		sprintf(line, "%i(?\?\?)", ofs);
 	else
 	{
 		s = Scr_ValueString(def->type, val);
@@ -204,7 +190,7 @@ char* Scr_GlobalStringNoContents(int ofs)
 
 	def = ScrInternal_GlobalAtOfs(ofs);
 	if (!def)
-		sprintf(line, "%i(???)", ofs);
+		sprintf(line, "%i(?\?\?)", ofs);
 	else
 		sprintf(line, "%i(%s)", ofs, ScrInternal_String(def->s_name));
 
@@ -27,29 +27,11 @@ Scr_GetEntityFieldValue
 */
 eval_t* Scr_GetEntityFieldValue(vm_entity_t *ent, char* field)
 {
-	ddef_t* def = NULL;
-	int				i;
-	static int		rep = 0;
+	ddef_t* def;
 
 	CheckScriptVM(__FUNCTION__);
-	for (i = 0; i < SCR_GEFV_CACHESIZE; i++)
-	{
-		if (!strcmp(field, active_qcvm->gefvCache[i].field))
-		{
-			def = active_qcvm->gefvCache[i].pcache;
-			goto Done;
-		}
-	}
 
 	def = Scr_FindEntityField(field);
-	if (strlen(field) < SCR_MAX_FIELD_LEN)
-	{
-		active_qcvm->gefvCache[rep].pcache = def;
-		strcpy(active_qcvm->gefvCache[rep].field, field);
-		rep ^= 1;
-	}
-
-Done:
 	if (!def)
 		return NULL;
 
@@ -185,52 +167,23 @@ int ScrInternal_LeaveFunction()
 
 /*
 ====================
-Scr_Execute
+ScrInternal_Interpret
 
-Execute script program
+Reference switch() interpreter, 's' is the last executed statement.
+Also used to continue execution when threaded code hands over because
+tracing was enabled
 ====================
 */
 
 extern char* qcvm_op_names[];
-void Scr_Execute(vmType_t vmtype, scr_func_t fnum, char* callFromFuncName)
+void ScrInternal_Interpret(qcvm_t* vm, dfunction_t* f, int s, int exitdepth)
 {
 	eval_t			*a, *b, *c, *ptr;
-	int				s, i, exitdepth;
+	int				i;
 	dstatement_t	*st;
-	dfunction_t		*f, *newf;
-	qcvm_t			*vm;
+	dfunction_t		*newf;
 	vm_entity_t		*ent;
 
-
-	Scr_BindVM(vmtype);
-//	CheckScriptVM(__FUNCTION__);
-
-	vm = active_qcvm;
-
-	vm->callFromFuncName = callFromFuncName;
-	if (!fnum || fnum >= vm->progs->numFunctions)
-	{
-		if (vm->progsType == VM_SVGAME)
-		{
-			sv_globalvars_t *g = vm->globals_struct;
-			if (g->self)
-				Scr_PrintEntityFields(VM_TO_ENT(g->self));
-		}
-
-		Scr_RunError("%s: incorrect function index %i in %s, from %s\n", __FUNCTION__, fnum, vmDefs[vm->progsType].filename, callFromFuncName);
-		return;
-	}
-
-	f = &vm->functions[fnum];
-
-	vm->runawayCounter = (int)vm_runaway->value;
-	vm->traceEnabled = false;
-
-	// make a stack frame
-	exitdepth = vm->stackDepth;
-
-	s = ScrInternal_EnterFunction(f);
-
 	while (1)
 	{
 		s++;	// next statement
@@ -676,6 +629,8 @@ void Scr_Execute(vmType_t vmtype, scr_func_t fnum, char* callFromFuncName)
 				Scr_RunError("worldspawn entity fields are read only\n");
 			}
 			c->_int = (byte*)(ENTVARSOFFSET(ent) + b->_int) - (byte*)vm->entities;
+			if (vm->watchedFields && (unsigned int)b->_int < (unsigned int)vm->progs->entityfields && vm->watchedFields[b->_int])
+				vm->fieldWatch(ent, b->_int);
 			break;
 
 		//load a field to a value
@@ -735,7 +690,7 @@ void Scr_Execute(vmType_t vmtype, scr_func_t fnum, char* callFromFuncName)
 				if (i >= scr_numBuiltins)
 					Scr_RunError("%s: unknown builtin function (funcnum = %i) in %s\n", __FUNCTION__, i, vmDefs[vm->progsType].filename);
 
-				if(scr_builtins[i].execon != PF_ALL && vm->progsType != scr_builtins[i].execon)
+				if(scr_builtins[i].execon != PF_ALL && (int)vm->progsType != (int)scr_builtins[i].execon)
 					Scr_RunError("%s: call to '%s' builtin in %s VM not allowed\n", __FUNCTION__, scr_builtins[i].name, vmDefs[vm->progsType].name);
 
 				scr_builtins[i].func();
@@ -786,6 +741,54 @@ void Scr_Execute(vmType_t vmtype, scr_func_t fnum, char* callFromFuncName)
 
 }
 
+/*
+====================
+Scr_Execute
+
+Execute script program
+====================
+*/
+void Scr_Execute(vmType_t vmtype, scr_func_t fnum, const char* callFromFuncName)
+{
+	int				s, exitdepth;
+	dfunction_t		*f;
+	qcvm_t			*vm;
+
+	Scr_BindVM(vmtype);
+//	CheckScriptVM(__FUNCTION__);
+
+	vm = active_qcvm;
+
+	vm->callFromFuncName = callFromFuncName;
+	if (!fnum || fnum >= vm->progs->numFunctions)
+	{
+		if (vm->progsType == VM_SVGAME)
+		{
+			sv_globalvars_t *g = vm->globals_struct;
+			if (g->self)
+				Scr_PrintEntityFields(VM_TO_ENT(g->self));
+		}
+
+		Scr_RunError("%s: incorrect function index %i in %s, from %s\n", __FUNCTION__, fnum, vmDefs[vm->progsType].filename, callFromFuncName);
+		return;
+	}
+
+	f = &vm->functions[fnum];
+
+	vm->runawayCounter = (int)vm_runaway->value;
+	vm->traceEnabled = false;
+
+	// make a stack frame
+	exitdepth = vm->stackDepth;
+
+	s = ScrInternal_EnterFunction(f);
+
+	if (vm->code && vm_threaded->value)
+		ScrInternal_ExecuteThreaded(vm, f, s, exitdepth);
+	else
+		ScrInternal_Interpret(vm, f, s, exitdepth);
+}
+
 
 /*
 =============
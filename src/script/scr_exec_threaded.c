@@ -0,0 +1,749 @@
+/*
+pragma
+Copyright (C) 2023 BraXi.
+
+Quake 2 Engine 'Id Tech 2'
+Copyright (C) 1997-2001 Id Software, Inc.
+
+See the attached GNU General Public License v2 for more details.
+*/
+
+// scr_exec_threaded.c -- threaded code execution engine
+
+/*
+Statements are decoded once at load time into qcinstr_t, with operands
+resolved to pointers into globals and (with GCC/Clang) the address of the
+opcode's handler, so executing a statement is a single indirect jump.
+
+Runaway and profile counters are updated only when control leaves a straight
+run of statements (jumps, calls and returns), the runaway limit is checked on
+backward jumps and calls. Tracing can only be toggled by builtins, so it is
+checked after builtin calls and, when enabled, the rest of the program runs
+in the reference interpreter which prints every statement.
+
+vm_threaded 0 selects the reference interpreter from scr_exec.c.
+*/
+
+#include "../qcommon/qcommon.h"
+#include "script_internals.h"
+
+#if defined(__GNUC__) || defined(__clang__)
+	#define SCR_COMPUTED_GOTO 1		// labels as values
+#else
+	#define SCR_COMPUTED_GOTO 0		// MSVC, dispatch with switch() over decoded statements
+#endif
+
+extern char* qcvm_op_names[];
+extern qcvm_t* qcvm[NUM_SCRIPT_VMS];
+extern int ScrInternal_EnterFunction(dfunction_t* f);
+extern int ScrInternal_LeaveFunction();
+
+#if SCR_COMPUTED_GOTO
+static const void* const* scr_opHandlers;	// filled by ScrInternal_ExecuteThreaded(NULL, ...)
+#endif
+
+/*
+====================
+ScrInternal_DecodeProgram
+
+Builds threaded code for all statements of loaded progs
+====================
+*/
+void ScrInternal_DecodeProgram(qcvm_t* vm)
+{
+	dstatement_t	*st;
+	qcinstr_t		*in;
+	int				i;
+
+#if SCR_COMPUTED_GOTO
+	if (!scr_opHandlers)
+		ScrInternal_ExecuteThreaded(NULL, NULL, 0, 0);
+#endif
+
+	vm->code = Z_Malloc(sizeof(qcinstr_t) * vm->progs->numStatements);
+
+	for (i = 0; i < vm->progs->numStatements; i++)
+	{
+		st = &vm->statements[i];
+		in = &vm->code[i];
+
+		in->op = st->op;
+		in->a = (eval_t*)&vm->globals[st->a];
+		in->b = (eval_t*)&vm->globals[st->b];
+		in->c = (eval_t*)&vm->globals[st->c];
+
+		switch (st->op)
+		{
+		case OP_GOTO:
+			in->jump = st->a;
+			in->a = NULL;
+			break;
+		case OP_IF:
+		case OP_IFNOT:
+			in->jump = st->b;
+			in->b = NULL;
+			break;
+		}
+
+#if SCR_COMPUTED_GOTO
+		in->handler = scr_opHandlers[st->op < NUM_QC_OPCODES ? st->op : NUM_QC_OPCODES];
+#endif
+	}
+}
+
+
+/*
+====================
+ScrInternal_ExecuteThreaded
+
+Execute threaded code, 's' is the last executed statement
+====================
+*/
+#if SCR_COMPUTED_GOTO
+	#define CASE(op)		case op: L_##op:
+	#define DISPATCH()		goto *ip->handler
+#else
+	#define CASE(op)		case op:
+	#define DISPATCH()		continue
+#endif
+
+#define NEXT()				ip++; DISPATCH()
+#define SYNC_STATEMENT()	vm->xstatement = (int)(ip - vm->code)
+
+// account statements executed since the last jump, call or return
+#define FLUSH_COUNTERS() \
+	n = (int)(ip - mark) + 1; \
+	vm->xfunction->profile += n; \
+	vm->runawayCounter -= n
+
+#define CHECK_RUNAWAY() \
+	if (vm->runawayCounter <= 0) \
+	{ \
+		SYNC_STATEMENT(); \
+		Scr_RunError("runaway loop error in function %s (%s)", ScrInternal_String(f->s_name), vmDefs[vm->progsType].filename); \
+	}
+
+#define JUMP() \
+	FLUSH_COUNTERS(); \
+	if (ip->jump <= 0) \
+	{ \
+		CHECK_RUNAWAY(); \
+	} \
+	ip += ip->jump; \
+	mark = ip; \
+	DISPATCH()
+
+#define ENTVARS(e)			((int*)(e) + vm->offsetToEntVars)
+#define ENTITY(a)			((vm_entity_t*)vm->entities + (a)->edict)
+#define POINTER(b)			((eval_t*)((byte*)vm->entities + (b)->_int))
+
+void ScrInternal_ExecuteThreaded(qcvm_t* vm, dfunction_t* f, int s, int exitdepth)
+{
+	const qcinstr_t	*ip, *mark;
+	eval_t			*ptr;
+	dfunction_t		*newf;
+	vm_entity_t		*ent;
+	int				i, n;
+
+#if SCR_COMPUTED_GOTO
+	static const void* handlers[NUM_QC_OPCODES + 1];
+
+	if (!vm)
+	{
+		// publish handler addresses for ScrInternal_DecodeProgram
+		#define LINK(op) handlers[op] = &&L_##op
+
+		for (i = 0; i <= NUM_QC_OPCODES; i++)
+			handlers[i] = &&L_unknown;
+
+		LINK(OP_DONE); LINK(OP_RETURN); LINK(OP_STATE);
+		LINK(OP_MUL_F); LINK(OP_MUL_V); LINK(OP_MUL_FV); LINK(OP_MUL_VF); LINK(OP_DIV_F);
+		LINK(OP_ADD_F); LINK(OP_ADD_V); LINK(OP_SUB_F); LINK(OP_SUB_V);
+		LINK(OP_EQ_F); LINK(OP_EQ_V); LINK(OP_EQ_S); LINK(OP_EQ_E); LINK(OP_EQ_FNC);
+		LINK(OP_NE_F); LINK(OP_NE_V); LINK(OP_NE_S); LINK(OP_NE_E); LINK(OP_NE_FNC);
+		LINK(OP_LE); LINK(OP_GE); LINK(OP_LT); LINK(OP_GT);
+		LINK(OP_LOAD_F); LINK(OP_LOAD_V); LINK(OP_LOAD_S); LINK(OP_LOAD_ENT); LINK(OP_LOAD_FLD); LINK(OP_LOAD_FNC); LINK(OP_LOAD_I);
+		LINK(OP_ADDRESS);
+		LINK(OP_STORE_F); LINK(OP_STORE_V); LINK(OP_STORE_S); LINK(OP_STORE_ENT); LINK(OP_STORE_FLD); LINK(OP_STORE_FNC);
+		LINK(OP_STORE_I); LINK(OP_STORE_IF); LINK(OP_STORE_FI);
+		LINK(OP_STOREP_F); LINK(OP_STOREP_V); LINK(OP_STOREP_S); LINK(OP_STOREP_ENT); LINK(OP_STOREP_FLD); LINK(OP_STOREP_FNC);
+		LINK(OP_STOREP_I); LINK(OP_STOREP_IF); LINK(OP_STOREP_FI);
+		LINK(OP_NOT_F); LINK(OP_NOT_V); LINK(OP_NOT_S); LINK(OP_NOT_ENT); LINK(OP_NOT_FNC); LINK(OP_NOT_I);
+		LINK(OP_IF); LINK(OP_IFNOT); LINK(OP_GOTO);
+		LINK(OP_CALL0); LINK(OP_CALL1); LINK(OP_CALL2); LINK(OP_CALL3); LINK(OP_CALL4);
+		LINK(OP_CALL5); LINK(OP_CALL6); LINK(OP_CALL7); LINK(OP_CALL8);
+		LINK(OP_AND); LINK(OP_OR); LINK(OP_BITAND); LINK(OP_BITOR);
+		LINK(OP_ADD_I); LINK(OP_ADD_FI); LINK(OP_ADD_IF); LINK(OP_SUB_I); LINK(OP_SUB_FI); LINK(OP_SUB_IF);
+		LINK(OP_CONV_ITOF); LINK(OP_CONV_FTOI);
+		LINK(OP_LOADP_ITOF); LINK(OP_LOADP_FTOI); LINK(OP_LOADA_I); LINK(OP_LOADP_I);
+		LINK(OP_BITAND_I); LINK(OP_BITOR_I); LINK(OP_MUL_I); LINK(OP_DIV_I); LINK(OP_EQ_I); LINK(OP_NE_I);
+		LINK(OP_BITXOR_I); LINK(OP_RSHIFT_I); LINK(OP_LSHIFT_I);
+		LINK(OP_LE_I); LINK(OP_GE_I); LINK(OP_LT_I); LINK(OP_GT_I);
+		LINK(OP_LE_IF); LINK(OP_GE_IF); LINK(OP_LT_IF); LINK(OP_GT_IF);
+		LINK(OP_LE_FI); LINK(OP_GE_FI); LINK(OP_LT_FI); LINK(OP_GT_FI);
+		LINK(OP_EQ_IF); LINK(OP_EQ_FI);
+		LINK(OP_MUL_IF); LINK(OP_MUL_FI); LINK(OP_MUL_VI); LINK(OP_MUL_IV); LINK(OP_DIV_IF); LINK(OP_DIV_FI);
+		LINK(OP_BITAND_IF); LINK(OP_BITOR_IF); LINK(OP_BITAND_FI); LINK(OP_BITOR_FI);
+		LINK(OP_AND_I); LINK(OP_OR_I); LINK(OP_AND_IF); LINK(OP_OR_IF); LINK(OP_AND_FI); LINK(OP_OR_FI);
+		LINK(OP_NE_IF); LINK(OP_NE_FI);
+
+		#undef LINK
+		scr_opHandlers = handlers;
+		return;
+	}
+#endif
+
+	ip = mark = &vm->code[s + 1];
+
+#if SCR_COMPUTED_GOTO
+	DISPATCH();
+#endif
+
+	for (;;)
+	{
+		switch (ip->op)
+		{
+		CASE(OP_ADD_F)
+			ip->c->_float = ip->a->_float + ip->b->_float;
+			NEXT();
+		CASE(OP_ADD_V)
+			ip->c->vector[0] = ip->a->vector[0] + ip->b->vector[0];
+			ip->c->vector[1] = ip->a->vector[1] + ip->b->vector[1];
+			ip->c->vector[2] = ip->a->vector[2] + ip->b->vector[2];
+			NEXT();
+		CASE(OP_SUB_F)
+			ip->c->_float = ip->a->_float - ip->b->_float;
+			NEXT();
+		CASE(OP_SUB_V)
+			ip->c->vector[0] = ip->a->vector[0] - ip->b->vector[0];
+			ip->c->vector[1] = ip->a->vector[1] - ip->b->vector[1];
+			ip->c->vector[2] = ip->a->vector[2] - ip->b->vector[2];
+			NEXT();
+		CASE(OP_MUL_F)
+			ip->c->_float = ip->a->_float * ip->b->_float;
+			NEXT();
+		CASE(OP_MUL_V)
+			ip->c->_float = ip->a->vector[0] * ip->b->vector[0]
+				+ ip->a->vector[1] * ip->b->vector[1]
+				+ ip->a->vector[2] * ip->b->vector[2];
+			NEXT();
+		CASE(OP_MUL_FV)
+			ip->c->vector[0] = ip->a->_float * ip->b->vector[0];
+			ip->c->vector[1] = ip->a->_float * ip->b->vector[1];
+			ip->c->vector[2] = ip->a->_float * ip->b->vector[2];
+			NEXT();
+		CASE(OP_MUL_VF)
+			ip->c->vector[0] = ip->b->_float * ip->a->vector[0];
+			ip->c->vector[1] = ip->b->_float * ip->a->vector[1];
+			ip->c->vector[2] = ip->b->_float * ip->a->vector[2];
+			NEXT();
+		CASE(OP_DIV_F)
+			ip->c->_float = ip->a->_float / ip->b->_float;
+			NEXT();
+		CASE(OP_BITAND)
+			ip->c->_float = (int)ip->a->_float & (int)ip->b->_float;
+			NEXT();
+		CASE(OP_BITOR)
+			ip->c->_float = (int)ip->a->_float | (int)ip->b->_float;
+			NEXT();
+
+		CASE(OP_GE)
+			ip->c->_float = ip->a->_float >= ip->b->_float;
+			NEXT();
+		CASE(OP_LE)
+			ip->c->_float = ip->a->_float <= ip->b->_float;
+			NEXT();
+		CASE(OP_GT)
+			ip->c->_float = ip->a->_float > ip->b->_float;
+			NEXT();
+		CASE(OP_LT)
+			ip->c->_float = ip->a->_float < ip->b->_float;
+			NEXT();
+		CASE(OP_AND)
+			ip->c->_float = ip->a->_float && ip->b->_float;
+			NEXT();
+		CASE(OP_OR)
+			ip->c->_float = ip->a->_float || ip->b->_float;
+			NEXT();
+
+		CASE(OP_NOT_F)
+			ip->c->_float = !ip->a->_float;
+			NEXT();
+		CASE(OP_NOT_V)
+			ip->c->_float = !ip->a->vector[0] && !ip->a->vector[1] && !ip->a->vector[2];
+			NEXT();
+		CASE(OP_NOT_S)
+			ip->c->_float = !ip->a->string || !vm->strings[ip->a->string];
+			NEXT();
+		CASE(OP_NOT_FNC)
+			ip->c->_float = !ip->a->function;
+			NEXT();
+		CASE(OP_NOT_ENT)
+			ip->c->_float = (ENTITY(ip->a) == vm->entities);
+			NEXT();
+
+		CASE(OP_EQ_F)
+			ip->c->_float = ip->a->_float == ip->b->_float;
+			NEXT();
+		CASE(OP_EQ_V)
+			ip->c->_float = (ip->a->vector[0] == ip->b->vector[0]) &&
+				(ip->a->vector[1] == ip->b->vector[1]) &&
+				(ip->a->vector[2] == ip->b->vector[2]);
+			NEXT();
+		CASE(OP_EQ_S)
+			ip->c->_float = !strcmp(vm->strings + ip->a->string, vm->strings + ip->b->string);
+			NEXT();
+		CASE(OP_EQ_E)
+			ip->c->_float = ip->a->_int == ip->b->_int;
+			NEXT();
+		CASE(OP_EQ_FNC)
+			ip->c->_float = ip->a->function == ip->b->function;
+			NEXT();
+
+		CASE(OP_NE_F)
+			ip->c->_float = ip->a->_float != ip->b->_float;
+			NEXT();
+		CASE(OP_NE_V)
+			ip->c->_float = (ip->a->vector[0] != ip->b->vector[0]) ||
+				(ip->a->vector[1] != ip->b->vector[1]) ||
+				(ip->a->vector[2] != ip->b->vector[2]);
+			NEXT();
+		CASE(OP_NE_S)
+			ip->c->_float = strcmp(vm->strings + ip->a->string, vm->strings + ip->b->string);
+			NEXT();
+		CASE(OP_NE_E)
+			ip->c->_float = ip->a->_int != ip->b->_int;
+			NEXT();
+		CASE(OP_NE_FNC)
+			ip->c->_float = ip->a->function != ip->b->function;
+			NEXT();
+
+/* FTEQC: begin int */
+		CASE(OP_ADD_I)
+			ip->c->_int = ip->a->_int + ip->b->_int;
+			NEXT();
+		CASE(OP_ADD_FI)
+			ip->c->_float = ip->a->_float + (float)ip->b->_int;
+			NEXT();
+		CASE(OP_ADD_IF)
+			ip->c->_float = (float)ip->a->_int + ip->b->_float;
+			NEXT();
+		CASE(OP_SUB_I)
+			ip->c->_int = ip->a->_int - ip->b->_int;
+			NEXT();
+		CASE(OP_SUB_FI)
+			ip->c->_float = ip->a->_float - (float)ip->b->_int;
+			NEXT();
+		CASE(OP_SUB_IF)
+			ip->c->_float = (float)ip->a->_int - ip->b->_float;
+			NEXT();
+		CASE(OP_CONV_ITOF)
+			ip->c->_float = (float)ip->a->_int;
+			NEXT();
+		CASE(OP_CONV_FTOI)
+			ip->c->_int = (int)ip->a->_float;
+			NEXT();
+		CASE(OP_MUL_I)
+			ip->c->_int = ip->a->_int * ip->b->_int;
+			NEXT();
+		CASE(OP_DIV_I)
+			if (ip->b->_int == 0)
+			{
+				SYNC_STATEMENT();
+				Scr_RunError("division by zero in %s", vmDefs[vm->progsType].filename);
+			}
+			ip->c->_int = ip->a->_int / ip->b->_int;
+			NEXT();
+		CASE(OP_EQ_I)
+			ip->c->_int = (ip->a->_int == ip->b->_int);
+			NEXT();
+		CASE(OP_NE_I)
+			ip->c->_int = (ip->a->_int != ip->b->_int);
+			NEXT();
+		CASE(OP_NOT_I)
+			ip->c->_int = !ip->a->_int;
+			NEXT();
+		CASE(OP_EQ_IF)
+			ip->c->_int = (float)(ip->a->_int == ip->b->_float);
+			NEXT();
+		CASE(OP_EQ_FI)
+			ip->c->_int = (float)(ip->a->_float == ip->b->_int);
+			NEXT();
+		CASE(OP_BITXOR_I)
+			ip->c->_int = ip->a->_int ^ ip->b->_int;
+			NEXT();
+		CASE(OP_RSHIFT_I)
+			ip->c->_int = ip->a->_int >> ip->b->_int;
+			NEXT();
+		CASE(OP_LSHIFT_I)
+			ip->c->_int = ip->a->_int << ip->b->_int;
+			NEXT();
+		CASE(OP_BITAND_I)
+			ip->c->_int = (ip->a->_int & ip->b->_int);
+			NEXT();
+		CASE(OP_BITOR_I)
+			ip->c->_int = (ip->a->_int | ip->b->_int);
+			NEXT();
+
+		CASE(OP_LE_I)
+			ip->c->_int = (int)(ip->a->_int <= ip->b->_int);
+			NEXT();
+		CASE(OP_LE_IF)
+			ip->c->_int = (int)(ip->a->_int <= ip->b->_float);
+			NEXT();
+		CASE(OP_LE_FI)
+			ip->c->_int = (int)(ip->a->_float <= ip->b->_int);
+			NEXT();
+		CASE(OP_GT_I)
+			ip->c->_int = (int)(ip->a->_int > ip->b->_int);
+			NEXT();
+		CASE(OP_GT_IF)
+			ip->c->_int = (int)(ip->a->_int > ip->b->_float);
+			NEXT();
+		CASE(OP_GT_FI)
+			ip->c->_int = (int)(ip->a->_float > ip->b->_int);
+			NEXT();
+		CASE(OP_LT_I)
+			ip->c->_int = (int)(ip->a->_int < ip->b->_int);
+			NEXT();
+		CASE(OP_LT_IF)
+			ip->c->_int = (int)(ip->a->_int < ip->b->_float);
+			NEXT();
+		CASE(OP_LT_FI)
+			ip->c->_int = (int)(ip->a->_float < ip->b->_int);
+			NEXT();
+		CASE(OP_GE_I)
+			ip->c->_int = (int)(ip->a->_int >= ip->b->_int);
+			NEXT();
+		CASE(OP_GE_IF)
+			ip->c->_int = (int)(ip->a->_int >= ip->b->_float);
+			NEXT();
+		CASE(OP_GE_FI)
+			ip->c->_int = (int)(ip->a->_float >= ip->b->_int);
+			NEXT();
+
+		CASE(OP_MUL_IF)
+			ip->c->_float = (ip->a->_int * ip->b->_float);
+			NEXT();
+		CASE(OP_MUL_FI)
+			ip->c->_float = (ip->a->_float * ip->b->_int);
+			NEXT();
+		CASE(OP_MUL_VI)
+			ip->c->vector[0] = ip->a->vector[0] * ip->b->_int;
+			ip->c->vector[1] = ip->a->vector[1] * ip->b->_int;
+			ip->c->vector[2] = ip->a->vector[2] * ip->b->_int;
+			NEXT();
+		CASE(OP_MUL_IV)
+			ip->c->vector[0] = ip->a->_int * ip->b->vector[0];
+			ip->c->vector[1] = ip->a->_int * ip->b->vector[1];
+			ip->c->vector[2] = ip->a->_int * ip->b->vector[2];
+			NEXT();
+		CASE(OP_DIV_IF)
+			ip->c->_float = (ip->a->_int / ip->b->_float);
+			NEXT();
+		CASE(OP_DIV_FI)
+			ip->c->_float = (ip->a->_float / ip->b->_int);
+			NEXT();
+		CASE(OP_BITAND_IF)
+			ip->c->_int = (ip->a->_int & (int)ip->b->_float);
+			NEXT();
+		CASE(OP_BITOR_IF)
+			ip->c->_int = (ip->a->_int | (int)ip->b->_float);
+			NEXT();
+		CASE(OP_BITAND_FI)
+			ip->c->_int = ((int)ip->a->_float & ip->b->_int);
+			NEXT();
+		CASE(OP_BITOR_FI)
+			ip->c->_int = ((int)ip->a->_float | ip->b->_int);
+			NEXT();
+		CASE(OP_AND_I)
+			ip->c->_int = (ip->a->_int && ip->b->_int);
+			NEXT();
+		CASE(OP_OR_I)
+			ip->c->_int = (ip->a->_int || ip->b->_int);
+			NEXT();
+		CASE(OP_AND_IF)
+			ip->c->_int = (ip->a->_int && ip->b->_float);
+			NEXT();
+		CASE(OP_OR_IF)
+			ip->c->_int = (ip->a->_int || ip->b->_float);
+			NEXT();
+		CASE(OP_AND_FI)
+			ip->c->_int = (ip->a->_float && ip->b->_int);
+			NEXT();
+		CASE(OP_OR_FI)
+			ip->c->_int = (ip->a->_float || ip->b->_int);
+			NEXT();
+		CASE(OP_NE_IF)
+			ip->c->_int = (ip->a->_int != ip->b->_float);
+			NEXT();
+		CASE(OP_NE_FI)
+			ip->c->_int = (ip->a->_float != ip->b->_int);
+			NEXT();
+
+		CASE(OP_LOADP_ITOF)
+		CASE(OP_LOADP_FTOI)
+		CASE(OP_LOADA_I)
+		CASE(OP_LOADP_I)
+			SYNC_STATEMENT();
+			Scr_RunError("Unsupported FTEQC opcode %s in %s", qcvm_op_names[ip->op], vmDefs[vm->progsType].filename);
+			NEXT();
+/* FTEQC: end int */
+
+		CASE(OP_STORE_IF)
+			ip->b->_float = (float)ip->a->_int;
+			NEXT();
+		CASE(OP_STORE_FI)
+			ip->b->_int = (int)ip->a->_float;
+			NEXT();
+		CASE(OP_STORE_F)
+		CASE(OP_STORE_ENT)
+		CASE(OP_STORE_FLD)
+		CASE(OP_STORE_S)
+		CASE(OP_STORE_I)
+		CASE(OP_STORE_FNC)
+			ip->b->_int = ip->a->_int;
+			NEXT();
+		CASE(OP_STORE_V)
+			ip->b->vector[0] = ip->a->vector[0];
+			ip->b->vector[1] = ip->a->vector[1];
+			ip->b->vector[2] = ip->a->vector[2];
+			NEXT();
+
+		CASE(OP_STOREP_IF)
+			POINTER(ip->b)->_float = (float)ip->a->_int;
+			NEXT();
+		CASE(OP_STOREP_FI)
+			POINTER(ip->b)->_int = (int)ip->a->_float;
+			NEXT();
+		CASE(OP_STOREP_I)
+		CASE(OP_STOREP_F)
+		CASE(OP_STOREP_ENT)
+		CASE(OP_STOREP_FLD)
+		CASE(OP_STOREP_S)
+		CASE(OP_STOREP_FNC)
+			POINTER(ip->b)->_int = ip->a->_int;
+			NEXT();
+		CASE(OP_STOREP_V)
+			ptr = POINTER(ip->b);
+			ptr->vector[0] = ip->a->vector[0];
+			ptr->vector[1] = ip->a->vector[1];
+			ptr->vector[2] = ip->a->vector[2];
+			NEXT();
+
+		CASE(OP_ADDRESS)
+			ent = ENTITY(ip->a);
+			if (ent == vm->entities && (vm->progsType == VM_SVGAME && Com_IsServerActive()))
+			{
+				SYNC_STATEMENT();
+				Scr_StackTrace();
+				Scr_RunError("worldspawn entity fields are read only\n");
+			}
+			ip->c->_int = (byte*)(ENTVARS(ent) + ip->b->_int) - (byte*)vm->entities;
+			if (vm->watchedFields && (unsigned int)ip->b->_int < (unsigned int)vm->progs->entityfields && vm->watchedFields[ip->b->_int])
+				vm->fieldWatch(ent, ip->b->_int);
+			NEXT();
+
+		CASE(OP_LOAD_F)
+		CASE(OP_LOAD_I)
+		CASE(OP_LOAD_FLD)
+		CASE(OP_LOAD_ENT)
+		CASE(OP_LOAD_S)
+		CASE(OP_LOAD_FNC)
+			ip->c->_int = ((eval_t*)(ENTVARS(ENTITY(ip->a)) + ip->b->_int))->_int;
+			NEXT();
+		CASE(OP_LOAD_V)
+			ptr = (eval_t*)(ENTVARS(ENTITY(ip->a)) + ip->b->_int);
+			ip->c->vector[0] = ptr->vector[0];
+			ip->c->vector[1] = ptr->vector[1];
+			ip->c->vector[2] = ptr->vector[2];
+			NEXT();
+
+		CASE(OP_IFNOT)
+			if (!ip->a->_int)
+			{
+				JUMP();
+			}
+			NEXT();
+		CASE(OP_IF)
+			if (ip->a->_int)
+			{
+				JUMP();
+			}
+			NEXT();
+		CASE(OP_GOTO)
+			JUMP();
+
+		CASE(OP_CALL0)
+		CASE(OP_CALL1)
+		CASE(OP_CALL2)
+		CASE(OP_CALL3)
+		CASE(OP_CALL4)
+		CASE(OP_CALL5)
+		CASE(OP_CALL6)
+		CASE(OP_CALL7)
+		CASE(OP_CALL8)
+			FLUSH_COUNTERS();
+			SYNC_STATEMENT();
+			CHECK_RUNAWAY();
+
+			vm->argc = ip->op - OP_CALL0;
+			if (!ip->a->function)
+				Scr_RunError("%s: NULL function in %s\n", __FUNCTION__, vmDefs[vm->progsType].filename);
+
+			newf = &vm->functions[ip->a->function];
+			if (newf->first_statement < 0)
+			{	// negative statements are built in functions
+				i = -newf->first_statement;
+				if (i >= scr_numBuiltins)
+					Scr_RunError("%s: unknown builtin function (funcnum = %i) in %s\n", __FUNCTION__, i, vmDefs[vm->progsType].filename);
+
+				if (scr_builtins[i].execon != PF_ALL && (int)vm->progsType != (int)scr_builtins[i].execon)
+					Scr_RunError("%s: call to '%s' builtin in %s VM not allowed\n", __FUNCTION__, scr_builtins[i].name, vmDefs[vm->progsType].name);
+
+				scr_builtins[i].func();
+
+				if (vm->traceEnabled)
+				{
+					// traceon() was called, finish in the interpreter so every statement is printed
+					ScrInternal_Interpret(vm, f, (int)(ip - vm->code), exitdepth);
+					return;
+				}
+
+				ip++;
+				mark = ip;
+				DISPATCH();
+			}
+
+			ip = &vm->code[ScrInternal_EnterFunction(newf) + 1];
+			mark = ip;
+			DISPATCH();
+
+		CASE(OP_DONE)
+		CASE(OP_RETURN)
+			FLUSH_COUNTERS();
+			SYNC_STATEMENT();
+
+			vm->globals[OFS_RETURN] = ip->a->_float;
+			vm->globals[OFS_RETURN + 1] = ip->a->vector[1];
+			vm->globals[OFS_RETURN + 2] = ip->a->vector[2];
+
+			s = ScrInternal_LeaveFunction();
+			if (vm->stackDepth == exitdepth)
+				return;		// all done
+
+			ip = mark = &vm->code[s + 1];
+			DISPATCH();
+
+		CASE(OP_STATE)
+			if (vm->progsType == VM_SVGAME)
+			{
+				extern void Scr_SV_OP(eval_t * a, eval_t * b, eval_t * c);
+				Scr_SV_OP(ip->a, ip->b, ip->c);
+			}
+			else
+			{
+				SYNC_STATEMENT();
+				Scr_RunError("OP_STATE not implemented for %s", vmDefs[vm->progsType].name);
+			}
+			NEXT();
+
+		default:
+#if SCR_COMPUTED_GOTO
+		L_unknown:
+#endif
+			SYNC_STATEMENT();
+			if (ip->op > 0 && ip->op < 269)
+				Scr_RunError("%s: unknown opcode %i [%s] in %s\n", __FUNCTION__, ip->op, qcvm_op_names[ip->op], vmDefs[vm->progsType].filename);
+			else
+				Scr_RunError("%s: unknown opcode %i in %s\n", __FUNCTION__, ip->op, vmDefs[vm->progsType].filename);
+			return;
+		}
+	}
+}
+
+#undef CASE
+#undef DISPATCH
+#undef NEXT
+
+
+/*
+====================
+cmd_vm_benchmark_f
+
+Runs a script function with both execution engines and reports statements/sec,
+the function should not take parameters and be safe to call repeatedly
+
+vm_benchmark <svgame|clgame> <function> [iterations]
+====================
+*/
+void cmd_vm_benchmark_f(void)
+{
+	vmType_t		type;
+	scr_func_t		func;
+	qcvm_t			*vm;
+	float			engine, oldValue;
+	int				i, j, iterations, time;
+	double			statements;
+
+	if (!developer->value)
+	{
+		Com_Printf("developer mode must be enabled for 'vm_benchmark'\n");
+		return;
+	}
+
+	if (Cmd_Argc() < 3)
+	{
+		Com_Printf("usage: vm_benchmark <svgame|clgame> <function> [iterations]\n");
+		return;
+	}
+
+	for (type = VM_SVGAME; type < NUM_SCRIPT_VMS; type++)
+	{
+		if (!Q_stricmp(Cmd_Argv(1), (char*)vmDefs[type].name))
+			break;
+	}
+
+	if (type == NUM_SCRIPT_VMS || !qcvm[type])
+	{
+		Com_Printf("script vm '%s' is not loaded\n", Cmd_Argv(1));
+		return;
+	}
+
+	Scr_BindVM(type);
+	vm = active_qcvm;
+
+	func = Scr_FindFunction(Cmd_Argv(2));
+	if (func == -1)
+	{
+		Com_Printf("function '%s' not found in %s\n", Cmd_Argv(2), vmDefs[type].filename);
+		return;
+	}
+
+	iterations = Cmd_Argc() > 3 ? atoi(Cmd_Argv(3)) : 1000;
+	if (iterations < 1)
+		iterations = 1;
+
+	oldValue = vm_threaded->value;
+	for (engine = 0; engine <= 1; engine++)
+	{
+		Cvar_SetValue("vm_threaded", engine);
+
+		// profile counters of both engines count every executed statement
+		for (j = 0; j < vm->progs->numFunctions; j++)
+			vm->functions[j].profile = 0;
+
+		time = Sys_Milliseconds();
+		for (i = 0; i < iterations; i++)
+			Scr_Execute(type, func, __FUNCTION__);
+		time = Sys_Milliseconds() - time;
+
+		statements = 0;
+		for (j = 0; j < vm->progs->numFunctions; j++)
+			statements += vm->functions[j].profile;
+
+		Com_Printf("%s: %.0f statements in %i ms, %.2f M statements/sec\n", engine ? "threaded" : "interpreter",
+			statements, time, time ? statements / (time * 1000.0) : 0.0);
+	}
+	Cvar_SetValue("vm_threaded", oldValue);
+}
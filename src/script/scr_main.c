@@ -15,6 +15,7 @@ See the attached GNU General Public License v2 for more details.
 #include "script_internals.h"
 
 cvar_t* vm_runaway;
+cvar_t* vm_threaded;
 
 qcvm_t* qcvm[NUM_SCRIPT_VMS];
 qcvm_t* active_qcvm; // qcvm currently in use
@@ -41,42 +42,98 @@ static const char* Scr_VMName(vmType_t vm)
 
 /*
 ============
-ScrInternal_GlobalAtOfs
+ScrInternal_BuildHash
+
+Builds name hash over 'count' entries, 'names' points to s_name of the first
+entry and consecutive entries are 'stride' bytes apart
 ============
 */
-ddef_t* ScrInternal_GlobalAtOfs(int ofs)
+static void ScrInternal_BuildHash(qcvm_t* vm, scrhash_t* hash, int* names, size_t stride, int count)
 {
-	ddef_t* def;
-	int			i;
+	unsigned int	key;
+	int				i;
 
-	CheckScriptVM(__FUNCTION__);
-	for (i = 0; i < active_qcvm->progs->numGlobalDefs; i++)
+	hash->size = 64;
+	while (hash->size < (unsigned int)count)
+		hash->size <<= 1;
+
+	hash->buckets = Z_Malloc(sizeof(int) * (hash->size + count));
+	hash->next = hash->buckets + hash->size;
+
+	// link backwards so chains keep progs order and the first definition wins
+	for (i = count - 1; i >= 0; i--)
 	{
-		def = &active_qcvm->globalDefs[i];
-		if (def->ofs == ofs)
-			return def;
+		key = Com_HashKey(vm->strings + *(int*)((byte*)names + i * stride), hash->size);
+		hash->next[i] = hash->buckets[key];
+		hash->buckets[key] = i + 1;
 	}
-	return NULL;
 }
 
 /*
 ============
-ED_FieldAtOfs
+ScrInternal_HashLookup
+
+Returns index of entry with given name or -1
 ============
 */
-ddef_t* ScrInternal_FieldAtOfs(int ofs)
+static int ScrInternal_HashLookup(scrhash_t* hash, int* names, size_t stride, char* name)
 {
-	ddef_t	*def;
 	int		i;
 
-	CheckScriptVM(__FUNCTION__);
-	for (i = 0; i < active_qcvm->progs->numFieldDefs; i++)
+	for (i = hash->buckets[Com_HashKey(name, hash->size)]; i; i = hash->next[i - 1])
+	{
+		if (!strcmp(active_qcvm->strings + *(int*)((byte*)names + (i - 1) * stride), name))
+			return i - 1;
+	}
+	return -1;
+}
+
+/*
+============
+ScrInternal_BuildOfsTable
+
+Maps every offset to the first def stored at it, so ScrInternal_GlobalAtOfs and
+ScrInternal_FieldAtOfs return the same def a linear search would
+============
+*/
+static ddef_t** ScrInternal_BuildOfsTable(ddef_t* defs, int numDefs, int size)
+{
+	ddef_t	**table;
+	int		i;
+
+	table = Z_Malloc(sizeof(ddef_t*) * (size + 1));
+	for (i = 0; i < numDefs; i++)
 	{
-		def = &active_qcvm->fieldDefs[i];
-		if (def->ofs == ofs)
-			return def;
+		if (defs[i].ofs < size && !table[defs[i].ofs])
+			table[defs[i].ofs] = &defs[i];
 	}
-	return NULL;
+	return table;
+}
+
+/*
+============
+ScrInternal_GlobalAtOfs
+============
+*/
+ddef_t* ScrInternal_GlobalAtOfs(int ofs)
+{
+	CheckScriptVM(__FUNCTION__);
+	if ((unsigned)ofs >= (unsigned)active_qcvm->progs->numGlobals)
+		return NULL;
+	return active_qcvm->globalAtOfs[ofs];
+}
+
+/*
+============
+ED_FieldAtOfs
+============
+*/
+ddef_t* ScrInternal_FieldAtOfs(int ofs)
+{
+	CheckScriptVM(__FUNCTION__);
+	if ((unsigned)ofs >= (unsigned)active_qcvm->progs->entityfields)
+		return NULL;
+	return active_qcvm->fieldAtOfs[ofs];
 }
 
 /*
@@ -86,19 +143,11 @@ Scr_FindEdictField
 */
 ddef_t* Scr_FindEntityField(char* name)
 {
-	ddef_t	*def;
 	int		i;
 
 	CheckScriptVM(__FUNCTION__);
-	for (i = 0; i < active_qcvm->progs->numFieldDefs; i++)
-	{
-		def = &active_qcvm->fieldDefs[i];
-		if (!strcmp(ScrInternal_String(def->s_name), name))
-		{
-			return def;
-		}
-	}
-	return NULL;
+	i = ScrInternal_HashLookup(&active_qcvm->fieldHash, &active_qcvm->fieldDefs->s_name, sizeof(ddef_t), name);
+	return (i == -1 ? NULL : &active_qcvm->fieldDefs[i]);
 }
 
 /*
@@ -215,17 +264,11 @@ Scr_FindGlobal
 */
 ddef_t* Scr_FindGlobal(char* name)
 {
-	ddef_t* def;
-	int			i;
+	int		i;
 
 	CheckScriptVM(__FUNCTION__);
-	for (i = 0; i < active_qcvm->progs->numGlobalDefs; i++)
-	{
-		def = &active_qcvm->globalDefs[i];
-		if (!strcmp(ScrInternal_String(def->s_name), name))
-			return def;
-	}
-	return NULL;
+	i = ScrInternal_HashLookup(&active_qcvm->globalHash, &active_qcvm->globalDefs->s_name, sizeof(ddef_t), name);
+	return (i == -1 ? NULL : &active_qcvm->globalDefs[i]);
 }
 
 
@@ -236,17 +279,11 @@ Scr_FindFunction
 */
 dfunction_t* ScrInternal_FindFunction(char* name)
 {
-	dfunction_t* func;
-	int				i;
+	int		i;
 
 	CheckScriptVM(__FUNCTION__);
-	for (i = 0; i < active_qcvm->progs->numFunctions; i++)
-	{
-		func = &active_qcvm->functions[i];
-		if (!strcmp(ScrInternal_String(func->s_name), name))
-			return func;
-	}
-	return NULL;
+	i = ScrInternal_HashLookup(&active_qcvm->functionHash, &active_qcvm->functions->s_name, sizeof(dfunction_t), name);
+	return (i == -1 ? NULL : &active_qcvm->functions[i]);
 }
 
 
@@ -340,7 +377,7 @@ void Scr_LoadProgs(qcvm_t *vm, char* filename)
 			Com_Error(ERR_FATAL, "%s: \"%s\" is wrong version %i (should be %i)\n", __FUNCTION__, filename, vm->progs->version, PROG_VERSION);
 	}
 
-	vm->crc = CRC_Block(vm->progs, len);
+	vm->crc = CRC_Block((byte*)vm->progs, len);
 
 #if PROGS_CHECK_CRC == 1
 	if (vm->progs->crc != vmDefs[vm->progsType].defs_crc_checksum )
@@ -401,6 +438,18 @@ void Scr_LoadProgs(qcvm_t *vm, char* filename)
 
 	for (i = 0; i < vm->progs->numGlobals; i++)
 		((int*)vm->globals)[i] = LittleLong(((int*)vm->globals)[i]);
+
+	// build threaded code
+	ScrInternal_DecodeProgram(vm);
+
+	// build name lookup tables
+	ScrInternal_BuildHash(vm, &vm->functionHash, &vm->functions->s_name, sizeof(dfunction_t), vm->progs->numFunctions);
+	ScrInternal_BuildHash(vm, &vm->globalHash, &vm->globalDefs->s_name, sizeof(ddef_t), vm->progs->numGlobalDefs);
+	ScrInternal_BuildHash(vm, &vm->fieldHash, &vm->fieldDefs->s_name, sizeof(ddef_t), vm->progs->numFieldDefs);
+
+	// build offset to def tables for debug printing
+	vm->globalAtOfs = ScrInternal_BuildOfsTable(vm->globalDefs, vm->progs->numGlobalDefs, vm->progs->numGlobals);
+	vm->fieldAtOfs = ScrInternal_BuildOfsTable(vm->fieldDefs, vm->progs->numFieldDefs, vm->progs->entityfields);
 }
 
 
@@ -421,7 +470,7 @@ void Scr_CreateScriptVM(vmType_t vmType, unsigned int numEntities, size_t entity
 //		Com_Error(ERR_FATAL, "Tried to create second instance of %s script VM\n", Scr_VMName(progsType));
 
 	qcvm[vmType] = Z_Malloc(sizeof(qcvm_t));
-	if (qcvm == NULL)
+	if (qcvm[vmType] == NULL)
 		Com_Error(ERR_FATAL, "Couldn't allocate %s script VM\n", Scr_VMName(vmType));
 
 	qcvm_t* vm = qcvm[vmType];
@@ -483,6 +532,23 @@ void Scr_FreeScriptVM(vmType_t vmtype)
 	if (vm->entities)
 		Z_Free(vm->entities);
 
+	if (vm->code)
+		Z_Free(vm->code);
+
+	if (vm->functionHash.buckets)
+		Z_Free(vm->functionHash.buckets);
+	if (vm->globalHash.buckets)
+		Z_Free(vm->globalHash.buckets);
+	if (vm->fieldHash.buckets)
+		Z_Free(vm->fieldHash.buckets);
+
+	if (vm->globalAtOfs)
+		Z_Free(vm->globalAtOfs);
+	if (vm->fieldAtOfs)
+		Z_Free(vm->fieldAtOfs);
+	if (vm->watchedFields)
+		Z_Free(vm->watchedFields);
+
 	if (vm->progs)
 		Z_Free(vm->progs);
 
@@ -559,6 +625,38 @@ int Scr_GetEntityFieldsSize()
 	return (active_qcvm->progs->entityfields * 4);
 }
 
+/*
+============
+Scr_WatchEntityField
+
+Makes the active VM call back whenever script is about to write to given entity field,
+there's one callback per VM. Vectors are watched with their components, the callback
+gets the offset that was written. Returns field offset or -1 when progs don't have such field
+============
+*/
+int Scr_WatchEntityField(char* name, scr_fieldwatch_t callback)
+{
+	ddef_t* def;
+
+	CheckScriptVM(__FUNCTION__);
+
+	def = Scr_FindEntityField(name);
+	if (!def)
+		return -1;
+
+	if (!active_qcvm->watchedFields)
+		active_qcvm->watchedFields = Z_Malloc(active_qcvm->progs->entityfields);
+
+	active_qcvm->watchedFields[def->ofs] = 1;
+	if ((def->type & ~DEF_SAVEGLOBAL) == ev_vector)
+	{	// foo_x, foo_y and foo_z can be written on their own
+		active_qcvm->watchedFields[def->ofs + 1] = 1;
+		active_qcvm->watchedFields[def->ofs + 2] = 1;
+	}
+	active_qcvm->fieldWatch = callback;
+	return def->ofs;
+}
+
 void cmd_vm_generatedefs_f(void)
 {
 	if (!developer->value)
@@ -595,11 +693,14 @@ void Scr_PreInitVMs()
 	Scr_InitSharedBuiltins();
 	CG_InitScriptBuiltins();
 	SV_InitScriptBuiltins();
+	Scr_InitLateSharedBuiltins();
 
 	vm_runaway = Cvar_Get("vm_runaway", va("%i", VM_DEFAULT_RUNAWAY), 0);
+	vm_threaded = Cvar_Get("vm_threaded", "1", 0);
 
 //	Cmd_AddCommand("vm_reload", cmd_vm_reload_f);
 	Cmd_AddCommand("vm_generatedefs", cmd_vm_generatedefs_f);
+	Cmd_AddCommand("vm_benchmark", cmd_vm_benchmark_f);
 }
 
 /*
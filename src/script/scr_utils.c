@@ -68,7 +68,7 @@ Finds function in progs and returns its number (for execution), returns -1 when
 scr_func_t Scr_FindFunction(char* funcname)
 {
 	dfunction_t* f = NULL;
-	if (funcname && funcname != "" && (f = ScrInternal_FindFunction(funcname)) != NULL)
+	if (funcname && funcname[0] && (f = ScrInternal_FindFunction(funcname)) != NULL)
 		return (scr_func_t)(f - active_qcvm->functions);
 	return -1;
 }
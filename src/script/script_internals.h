@@ -31,7 +31,6 @@ typedef enum
 etype_t;
 
 #define	SCR_MAX_FIELD_LEN		64
-#define SCR_GEFV_CACHESIZE		2
 #define	SCR_MAX_STACK_DEPTH		32
 #define	SCR_LOCALSTACK_SIZE		2048
 
@@ -54,6 +53,8 @@ etype_t;
 enum
 {
 #include "qc_opcodes.h"
+,
+NUM_QC_OPCODES
 };
 
 // =============================================================
@@ -125,11 +126,22 @@ typedef struct
 } dprograms_t;
 
 
+// pre-decoded statement for the threaded code engine (scr_exec_threaded.c)
+typedef struct qcinstr_s
+{
+	const void		*handler;		// label to jump to (computed goto only)
+	unsigned short	op;
+	short			jump;			// branch offset for OP_IF, OP_IFNOT and OP_GOTO
+	eval_t			*a, *b, *c;		// operands resolved to globals
+} qcinstr_t;
+
+// name -> index hash for functions, globalDefs and fieldDefs
 typedef struct
 {
-	ddef_t* pcache;
-	char	field[SCR_MAX_FIELD_LEN];
-} gefv_cache;
+	unsigned int	size;			// number of buckets, power of two
+	int				*buckets;		// index + 1 of first entry, 0 when empty
+	int				*next;			// index + 1 of next entry with the same hash
+} scrhash_t;
 
 typedef struct
 {
@@ -150,6 +162,7 @@ typedef struct qcvm_s
 	ddef_t			*globalDefs;
 	ddef_t			*fieldDefs;	
 	dstatement_t	*statements;
+	qcinstr_t		*code;			// threaded statements, NULL when not decoded
 
 //	sv_globalvars_t	*globals_struct;
 	unsigned int	num_entities;		// number of allocated entities
@@ -163,7 +176,14 @@ typedef struct qcvm_s
 
 	unsigned short	crc;			// crc checksum of entire progs file
 
-	gefv_cache		gefvCache[SCR_GEFV_CACHESIZE];
+	scrhash_t		functionHash;
+	scrhash_t		globalHash;
+	scrhash_t		fieldHash;
+	ddef_t			**globalAtOfs;	// [numGlobals] first globalDef at each offset
+	ddef_t			**fieldAtOfs;	// [entityfields] first fieldDef at each offset
+
+	byte			*watchedFields;	// [entityfields] fields reported to fieldWatch when addressed for writing
+	scr_fieldwatch_t fieldWatch;
 
 	qboolean		traceEnabled;
 
@@ -180,7 +200,7 @@ typedef struct qcvm_s
 	int				runawayCounter;	// runaway loop counter
 	int				pr_numparms;
 
-	char			*callFromFuncName;			// printtrace
+	const char		*callFromFuncName;			// printtrace
 }qcvm_t;
 
 typedef struct
@@ -196,6 +216,17 @@ extern int			scr_numBuiltins;
 extern qcvm_t		*active_qcvm;
 extern const qcvmdef_t vmDefs[NUM_SCRIPT_VMS];
 
+extern cvar_t* vm_threaded;
+
 extern char* ScrInternal_String(int str);
 extern void Scr_InitSharedBuiltins();
-extern void CheckScriptVM(const char* func);
\ No newline at end of file
+extern void Scr_InitLateSharedBuiltins();
+extern void CheckScriptVM(const char* func);
+
+// scr_exec.c
+extern void ScrInternal_Interpret(qcvm_t* vm, dfunction_t* f, int s, int exitdepth);
+
+// scr_exec_threaded.c
+extern void ScrInternal_DecodeProgram(qcvm_t* vm);
+extern void ScrInternal_ExecuteThreaded(qcvm_t* vm, dfunction_t* f, int s, int exitdepth);
+extern void cmd_vm_benchmark_f(void);
@@ -59,6 +59,9 @@ typedef union eval_s
 	scr_entity_t	edict;
 } eval_t;
 
+// called when script takes address of a watched entity field (just before it writes to it)
+typedef void (*scr_fieldwatch_t)(vm_entity_t* ent, int fieldofs);
+
 
 extern void Scr_CreateScriptVM(vmType_t vmType, unsigned int numEntities, size_t entitySize, size_t entvarOfs);
 extern void Scr_FreeScriptVM(vmType_t vmType);
@@ -67,6 +70,7 @@ extern int Scr_GetEntitySize();
 extern vm_entity_t* Scr_GetEntityPtr();
 extern void* Scr_GetGlobals();
 extern int Scr_GetEntityFieldsSize();
+extern int Scr_WatchEntityField(char* name, scr_fieldwatch_t callback);
 
 extern void Scr_PreInitVMs();
 extern void Scr_Shutdown();
@@ -75,7 +79,7 @@ extern void Scr_Shutdown();
 void Scr_StackTrace();
 // scr_exec.c
 extern void Scr_RunError(char* error, ...);
-extern void Scr_Execute(vmType_t vm, scr_func_t fnum, char* callFromFuncName);
+extern void Scr_Execute(vmType_t vm, scr_func_t fnum, const char* callFromFuncName);
 extern int Scr_NumArgs();
 extern eval_t* Scr_GetEntityFieldValue(vm_entity_t* ent, char* field); // FIXME 
 
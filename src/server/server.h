@@ -69,6 +69,8 @@ typedef enum
 // some qc commands are only valid before the server has finished
 // initializing (precache commands, static sounds / objects, etc)
 
+#define	ASSET_HASH_SIZE		1024	// must be a power of two
+
 typedef struct
 {
 	server_state_t		state;					// precache commands are only valid during load
@@ -90,11 +92,15 @@ typedef struct
 	int					max_edicts;				// [sv_maxentities]
 	int					entity_size;			// retrieved from progs
 	int					num_edicts;				// increases towards MAX_EDICTS
+	unsigned int		activeEdicts[(MAX_GENTITIES + 31) / 32];	// bit set for every entity that may be in use, see SV_NextActiveEntity
 
 	int					gameFrame;				// these are diferent from servers because simulation can be paused, server can't
 	float				gameTime;
 
 	char				configstrings[MAX_CONFIGSTRINGS][MAX_QPATH];
+	int					assethash[ASSET_HASH_SIZE];		// model, sound and image configstrings by name, see SV_FindOrCreateAssetIndex
+	int					assetnext[MAX_CONFIGSTRINGS];	// next configstring in the same hash chain, 0 ends it
+	int					assetfree[3];					// no empty model/sound/image slots below these
 	entity_state_t		baselines[MAX_GENTITIES];
 
 	// the multicast buffer is used to send a message to a set of clients
@@ -162,6 +168,7 @@ typedef struct client_s
 	byte			datagram_buf[MAX_MSGLEN];
 
 	client_frame_t	frames[UPDATE_BACKUP];	// updates can be delta'd from here
+	int				next_client_entity;	// next entity state to use in our slice of svs.client_entities
 
 	byte			*download;			// file being downloaded
 	int				downloadsize;		// total bytes (can't use EOF because of paks)
@@ -205,7 +212,6 @@ typedef struct
 
 	client_t	*clients;					// [maxclients->value];
 	int			num_client_entities;		// maxclients->value*UPDATE_BACKUP*MAX_PACKET_ENTITIES
-	int			next_client_entities;		// next client_entity to use
 	entity_state_t	*client_entities;		// [num_client_entities]
 
 	int			last_heartbeat;
@@ -238,8 +244,12 @@ extern  cvar_t		*sv_nolateloading;
 extern	cvar_t		*sv_cheats;
 extern	cvar_t		*sv_maxclients;
 extern	cvar_t		*sv_maxentities;
+extern	cvar_t		*sv_findindex;
 extern	cvar_t		*sv_noreload;			// don't reload level state when reentering, development tool
 extern	cvar_t		*sv_enforcetime;
+extern	cvar_t		*sv_threads;			// build client frames on worker threads
+extern	cvar_t		*sv_threads_verify;		// check threaded frames against the serial build
+extern	cvar_t		*sv_tracecache;			// per frame trace/pointcontents cache
 	
 extern	cvar_t		*sv_maxvelocity;
 extern	cvar_t		*sv_gravity;
@@ -257,6 +267,8 @@ int SV_ModelIndex(char* name);
 int SV_SoundIndex(char* name);
 int SV_ImageIndex(char* name);
 svmodel_t* SV_ModelForNum(unsigned int index);
+void SV_SetAssetConfigstring(int index, char* val);
+void SV_RebuildAssetHash(void);
 
 
 //
@@ -326,7 +338,8 @@ void SV_Status_f (void);
 //
 void SV_WriteFrameToClient (client_t *client, sizebuf_t *msg);
 void SV_RecordDemoMessage (void);
-void SV_BuildClientFrame (client_t *client);
+void SV_BuildClientFrames (client_t **clients, int numclients);
+entity_state_t *SV_ClientEntity (client_t *client, int index);
 
 //
 // sv_gentity.c
@@ -336,6 +349,11 @@ void SV_FreeEntity(gentity_t* ent);
 void SV_InitEntity(gentity_t* ent);
 void SV_RunEntity(gentity_t* ent);
 qboolean SV_RunThink(gentity_t* ent);
+void SV_SetEntityActive(gentity_t* ent, qboolean active);
+int SV_NextActiveEntity(int entnum);
+void SV_InitEntityIndexes();
+void SV_TouchEntityIndexes(gentity_t* ent);
+gentity_t* SV_FindEntity(gentity_t* from, int fieldofs, char* match);
 
 //
 // sv_devtools.c
@@ -368,6 +386,9 @@ void SV_LinkEdict (gentity_t *ent);
 // sets ent->leafnums[] for pvs determination even if the entity
 // is not solid
 
+qboolean SV_EdictLinked (gentity_t *ent);
+// true if the entity is linked into the area tree (solid or trigger)
+
 int SV_AreaEdicts (vec3_t mins, vec3_t maxs, gentity_t **list, int maxcount, int areatype);
 // fills in a table of edict pointers with edicts that have bounding boxes
 // that intersect the given area.  It is possible for a non-axial bmodel
@@ -376,6 +397,14 @@ int SV_AreaEdicts (vec3_t mins, vec3_t maxs, gentity_t **list, int maxcount, int
 // returns the number of pointers filled in
 // ??? does this always return the world?
 
+int SV_FindInBox (vec3_t mins, vec3_t maxs, gentity_t **list, int maxcount);
+// same as SV_AreaEdicts, but returns all entities in use (including triggers,
+// SOLID_NOT and never linked ones) sorted by entity number
+
+extern int sv_worldlinkcount;
+// changes every time an entity is linked or unlinked or script writes to a field
+// that collision depends on, used to invalidate cached queries
+
 //===================================================================
 
 //
@@ -397,3 +426,7 @@ trace_t SV_Trace (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, gentity_t
 
 // passedict is explicitly excluded from clipping checks (normally NULL)
 
+void SV_TraceBatch (int count, vec3_t *starts, vec3_t *ends, vec3_t mins, vec3_t maxs, gentity_t *passedict, int contentmask, trace_t *results);
+// same as SV_Trace for each start/end pair, candidate entities are gathered once
+// and the traces may be run on worker threads (sv_threads)
+
@@ -121,7 +121,7 @@ qboolean SV_MoveStep(gentity_t* actor, vec3_t move, qboolean relink)
 	int			contents;
 
 	int contentmask = MASK_MONSTERSOLID;
-	gentity_t* goal = VM_TO_ENT(actor->v.goal_entity);
+	gentity_t* goal = PROG_TO_GENT(actor->v.goal_entity);
 
 	// try the move	
 	VectorCopy(actor->v.origin, oldorg);
@@ -289,7 +289,7 @@ qboolean SV_MoveStep(gentity_t* actor, vec3_t move, qboolean relink)
 
 	if ((int)actor->v.flags & FL_PARTIALGROUND)
 	{
-		(int)actor->v.flags &= ~FL_PARTIALGROUND;
+		actor->v.flags = (int)actor->v.flags & ~FL_PARTIALGROUND;
 	}
 
 	actor->v.groundentity_num = trace.entitynum;
@@ -398,7 +398,7 @@ SV_FixCheckBottom
 */
 static void SV_FixCheckBottom(gentity_t* actor)
 {
-	(int)actor->v.flags |= FL_PARTIALGROUND;
+	actor->v.flags = (int)actor->v.flags | FL_PARTIALGROUND;
 }
 
 
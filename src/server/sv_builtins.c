@@ -136,39 +136,98 @@ void PFSV_nextent(void)
 	gentity_t* ent;
 	int entnum;
 
-	entnum = NUM_FOR_EDICT( Scr_GetParmEdict(0) ) + 1;// start from next entity
-	ent = sv.edicts; //world
+	entnum = NUM_FOR_EDICT( Scr_GetParmEdict(0) );
 
-	if (entnum >= sv.max_edicts-1)
-		goto retent;
-	
-	for(; entnum < sv.max_edicts; entnum++ )
+	for (entnum = SV_NextActiveEntity(entnum); entnum != -1; entnum = SV_NextActiveEntity(entnum))
 	{
 		ent = EDICT_NUM(entnum);
-		if(ent->inuse)
-			break;
-		
+		if (ent->inuse)
+		{
+			Scr_ReturnEntity(ent);
+			return;
+		}
 	}
-
-retent:
-	Scr_ReturnEntity(ent);
+	Scr_ReturnEntity(sv.edicts); //world
 }
 
 /*
 =================
 PFSV_find
 
+finds next entity after 'start' which string field equals 'match', returns world if there's none
 entity find(entity start, .string field, string match);
 
-not implemented, ugh I forgot
+for (e = find(world, targetname, self.target); e != world; e = find(e, targetname, self.target))
 =================
 */
 void PFSV_find(void)
 {
-	Scr_ReturnEntity(sv.edicts);
+	gentity_t	*ent;
+	int			fieldofs;
+
+	fieldofs = Scr_GetParmInt(1);
+	if (fieldofs < 0 || fieldofs >= Scr_GetEntityFieldsSize() / 4)
+	{
+		Scr_RunError("find(): bad field offset %i\n", fieldofs);
+		return;
+	}
+
+	ent = SV_FindEntity(Scr_GetParmEdict(0), fieldofs, Scr_GetParmString(2));
+	Scr_ReturnEntity(ent ? ent : sv.edicts);
 }
 
 
+/*
+=================
+SV_FindRadius
+
+Caches entities in a box around origin so consecutive findradius calls in a script 
+loop don't have to sweep all edicts, cache is dropped when anything gets (un)linked
+=================
+*/
+static struct
+{
+	vec3_t		origin;
+	float		radius;
+	int			linkcount;
+	int			count;
+	gentity_t	*list[MAX_GENTITIES];
+} sv_findradius;
+
+static void SV_FindRadius(float *org, float rad)
+{
+	vec3_t	mins, maxs;
+	int		i;
+
+	if (sv_findradius.linkcount == sv_worldlinkcount && sv_findradius.radius == rad && VectorCompare(sv_findradius.origin, org))
+		return;
+
+	for (i = 0; i < 3; i++)
+	{
+		mins[i] = org[i] - rad;
+		maxs[i] = org[i] + rad;
+	}
+
+	VectorCopy(org, sv_findradius.origin);
+	sv_findradius.radius = rad;
+	sv_findradius.linkcount = sv_worldlinkcount;
+	sv_findradius.count = SV_FindInBox(mins, maxs, sv_findradius.list, MAX_GENTITIES);
+}
+
+static qboolean SV_EntityInRadius(gentity_t* ent, float* org, float rad)
+{
+	vec3_t	eorg;
+	int		j;
+
+	if (!ent->inuse)
+		return false;
+
+	for (j = 0; j < 3; j++)
+		eorg[j] = org[j] - (ent->v.origin[j] + (ent->v.mins[j] + ent->v.maxs[j]) * 0.5);
+
+	return (VectorLength(eorg) <= rad);
+}
+
 /*
 =================
 findradius
@@ -180,38 +239,101 @@ findradius(entity from, origin, radius)
 */
 void PFSV_findradius(void)
 {
-	gentity_t* from; 
-	float *org;
-	float rad;
-
-	vec3_t	eorg;
-	int		i, j;
+	gentity_t	*from, *ent;
+	float		*org;
+	float		rad;
+	int			lo, hi, mid;
 
 	from = Scr_GetParmEdict(0);
 	org = Scr_GetParmVector(1);
 	rad = Scr_GetParmFloat(2);
 
-	for (i = NUM_FOR_EDICT(from) + 1; i < sv.max_edicts; i++)
+	SV_FindRadius(org, rad);
+
+	// the list is sorted by entity number, so continue right after 'from'
+	lo = 0;
+	hi = sv_findradius.count;
+	while (lo < hi)
 	{
-		from = EDICT_NUM(i);//NEXT_EDICT(from);
+		mid = (lo + hi) / 2;
+		if (sv_findradius.list[mid] <= from)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
 
-		if(!from->inuse)
-			continue;
+	for (; lo < sv_findradius.count; lo++)
+	{
+		ent = sv_findradius.list[lo];
+		if (SV_EntityInRadius(ent, org, rad))
+		{
+			Scr_ReturnEntity(ent);
+			return;
+		}
+	}
+	Scr_ReturnEntity(sv.edicts);
+}
 
-//		if (from->v.solid == SOLID_NOT)
-//			continue;
+/*
+=================
+findradiuschain
 
-		for(j = 0; j < 3; j++)
-			eorg[j] = org[j] - (from->v.origin[j] + (from->v.mins[j] + from->v.maxs[j]) * 0.5);
+Returns all entities within a spherical area at once, linked through .chain field
 
-		if (VectorLength(eorg) > rad)
+entity findradiuschain(vector origin, float radius)
+
+for (e = findradiuschain(org, 256); e != world; e = e.chain) ...
+=================
+*/
+void PFSV_findradiuschain(void)
+{
+	gentity_t	*chain, *ent;
+	float		*org;
+	float		rad;
+	int			i;
+
+	org = Scr_GetParmVector(0);
+	rad = Scr_GetParmFloat(1);
+
+	SV_FindRadius(org, rad);
+
+	chain = sv.edicts;
+	for (i = sv_findradius.count - 1; i >= 0; i--)
+	{
+		ent = sv_findradius.list[i];
+		if (!SV_EntityInRadius(ent, org, rad))
 			continue;
 
-		Scr_ReturnEntity(from);
-		return;
+		ent->v.chain = GENT_TO_PROG(chain);
+		chain = ent;
+	}
+	Scr_ReturnEntity(chain);
+}
+
+/*
+=================
+findboxchain
 
+Returns all entities which bounding boxes touch given area, linked through .chain field
+
+entity findboxchain(vector mins, vector maxs)
+=================
+*/
+void PFSV_findboxchain(void)
+{
+	gentity_t	*list[MAX_GENTITIES];
+	gentity_t	*chain;
+	int			i, count;
+
+	count = SV_FindInBox(Scr_GetParmVector(0), Scr_GetParmVector(1), list, MAX_GENTITIES);
+
+	chain = sv.edicts;
+	for (i = count - 1; i >= 0; i--)
+	{
+		list[i]->v.chain = GENT_TO_PROG(chain);
+		chain = list[i];
 	}
-	Scr_ReturnEntity(sv.edicts);
+	Scr_ReturnEntity(chain);
 }
 
 /*
@@ -286,7 +408,7 @@ void PFSV_setmodel(void)
 	}
 
 	name = Scr_GetParmString(1);
-	if (!name || name == "")
+	if (!name || !name[0])
 	{
 		Scr_RunError("setmodel(): empty model name for entity %i\n", NUM_FOR_EDICT(ent));
 		return;
@@ -396,6 +518,38 @@ void PFSV_contents(void)
 	Scr_ReturnFloat( SV_PointContents(point) );
 }
 
+/*
+=================
+SV_SetTraceGlobals
+=================
+*/
+static void SV_SetTraceGlobals(trace_t *trace)
+{
+	// set globals in progs
+	sv.script_globals->trace_allsolid = trace->allsolid;
+	sv.script_globals->trace_startsolid = trace->startsolid;
+	sv.script_globals->trace_fraction = trace->fraction;
+	sv.script_globals->trace_plane_dist = trace->plane.dist;
+	VectorCopy(trace->plane.normal, sv.script_globals->trace_plane_normal);
+	VectorCopy(trace->endpos, sv.script_globals->trace_endpos);
+	sv.script_globals->trace_ent = (trace->ent == NULL ? GENT_TO_PROG(sv.edicts) : GENT_TO_PROG(trace->ent));
+	sv.script_globals->trace_entnum = (trace->ent == NULL ? -1 : trace->ent->s.number);
+	sv.script_globals->trace_contents = trace->contents;
+
+	if (trace->surface)
+	{
+		sv.script_globals->trace_surface_name = Scr_SetString(trace->surface->name);
+		sv.script_globals->trace_surface_flags = trace->surface->flags;
+		sv.script_globals->trace_surface_value = trace->surface->value;
+	}
+	else
+	{
+		sv.script_globals->trace_surface_name = Scr_SetString("");
+		sv.script_globals->trace_surface_flags = 0;
+		sv.script_globals->trace_surface_value = 0;
+	}
+}
+
 /*
 =================
 PFSV_trace
@@ -425,30 +579,102 @@ void PFSV_trace(void)
 	contentmask = Scr_GetParmInt(5);
 
 	trace = SV_Trace(start, min, max, end, ignoreEnt, contentmask);
+	SV_SetTraceGlobals(&trace);
+}
 
-	// set globals in progs
-	sv.script_globals->trace_allsolid = trace.allsolid;
-	sv.script_globals->trace_startsolid = trace.startsolid;
-	sv.script_globals->trace_fraction = trace.fraction;
-	sv.script_globals->trace_plane_dist = trace.plane.dist;
-	VectorCopy(trace.plane.normal, sv.script_globals->trace_plane_normal);
-	VectorCopy(trace.endpos, sv.script_globals->trace_endpos);
-	sv.script_globals->trace_ent = (trace.ent == NULL ? GENT_TO_PROG(sv.edicts) : GENT_TO_PROG(trace.ent));
-	sv.script_globals->trace_entnum = (trace.ent == NULL ? -1 : trace.ent->s.number);
-	sv.script_globals->trace_contents = trace.contents;
-
-	if (trace.surface)
+#define	MAX_TRACEBATCH	256
+
+static struct
+{
+	vec3_t		starts[MAX_TRACEBATCH];
+	vec3_t		ends[MAX_TRACEBATCH];
+	trace_t		results[MAX_TRACEBATCH];
+	int			numqueued;
+	int			numresults;
+} sv_qctracebatch;
+
+/*
+=================
+PFSV_tracebatch_add
+
+Queues a move for tracebatch_run(), returns its index in the batch.
+
+float tracebatch_add(vector start, vector end)
+
+for (i = 0; i < 8; i++)
+	tracebatch_add(org, org + v_forward * 4096 + v_right * crandom() * 300 + v_up * crandom() * 300);
+tracebatch_run('0 0 0', '0 0 0', self, MASK_SHOT);
+for (i = 0; i < 8; i++)
+{
+	tracebatch_get(i);
+	if (trace_ent.takedamage) ...
+}
+=================
+*/
+void PFSV_tracebatch_add(void)
+{
+	int		i;
+
+	i = sv_qctracebatch.numqueued;
+	if (i == MAX_TRACEBATCH)
 	{
-		sv.script_globals->trace_surface_name = Scr_SetString(trace.surface->name);
-		sv.script_globals->trace_surface_flags = trace.surface->flags;
-		sv.script_globals->trace_surface_value = trace.surface->value;
+		Scr_RunError("tracebatch_add(): more than %i traces in a batch\n", MAX_TRACEBATCH);
+		return;
 	}
-	else
+
+	VectorCopy(Scr_GetParmVector(0), sv_qctracebatch.starts[i]);
+	VectorCopy(Scr_GetParmVector(1), sv_qctracebatch.ends[i]);
+	sv_qctracebatch.numqueued++;
+
+	Scr_ReturnFloat(i);
+}
+
+/*
+=================
+PFSV_tracebatch_run
+
+Traces all queued moves with the same size, ignored entity and mask, results 
+are kept until the next tracebatch_run(). Returns the number of traces.
+
+float tracebatch_run(vector mins, vector maxs, entity ignoreEnt, int contentmask)
+=================
+*/
+void PFSV_tracebatch_run(void)
+{
+	int		count;
+
+	count = sv_qctracebatch.numqueued;
+	SV_TraceBatch(count, sv_qctracebatch.starts, sv_qctracebatch.ends, Scr_GetParmVector(0), Scr_GetParmVector(1), 
+		Scr_GetParmEdict(2), Scr_GetParmInt(3), sv_qctracebatch.results);
+
+	sv_qctracebatch.numresults = count;
+	sv_qctracebatch.numqueued = 0;
+
+	Scr_ReturnFloat(count);
+}
+
+/*
+=================
+PFSV_tracebatch_get
+
+Sets the trace_ globals to the result of a trace from the last tracebatch_run(), returns trace_fraction
+
+float tracebatch_get(float index)
+=================
+*/
+void PFSV_tracebatch_get(void)
+{
+	int		i;
+
+	i = Scr_GetParmFloat(0);
+	if (i < 0 || i >= sv_qctracebatch.numresults)
 	{
-		sv.script_globals->trace_surface_name = Scr_SetString("");
-		sv.script_globals->trace_surface_flags = 0;
-		sv.script_globals->trace_surface_value = 0;
+		Scr_RunError("tracebatch_get(): index %i out of range [0,%i]\n", i, sv_qctracebatch.numresults - 1);
+		return;
 	}
+
+	SV_SetTraceGlobals(&sv_qctracebatch.results[i]);
+	Scr_ReturnFloat(sv_qctracebatch.results[i].fraction);
 }
 
 // =================================================================================
@@ -621,7 +847,10 @@ static void SV_Configstring(int index, char *val) //move to sv_main
 	if (!val)
 		val = "";
 
-	strcpy(sv.configstrings[index], val); // change the string in sv
+	if (index >= CS_MODELS && index < CS_LIGHTS)
+		SV_SetAssetConfigstring(index, val); // keep the asset hash in sync
+	else
+		strcpy(sv.configstrings[index], val); // change the string in sv
 
 	if (sv.state != ss_loading)
 	{
@@ -1819,6 +2048,15 @@ void SV_InitScriptBuiltins()
 	Scr_DefineBuiltin(PFSV_drawpoint, PF_SV, "drawpoint", "void(vector p, vector c, float th, float dt, float t)");
 	Scr_DefineBuiltin(PFSV_drawbox, PF_SV, "drawbox", "void(vector p, vector p1, vector p2, vector c, float th, float dt, float t)");
 
+	// spatial queries returning entities linked through .chain
+	Scr_DefineBuiltin(PFSV_findradiuschain, PF_SV, "findradiuschain", "entity(vector v, float r)");
+	Scr_DefineBuiltin(PFSV_findboxchain, PF_SV, "findboxchain", "entity(vector v1, vector v2)");
+
+	// batched traces
+	Scr_DefineBuiltin(PFSV_tracebatch_add, PF_SV, "tracebatch_add", "float(vector v1, vector v2)");
+	Scr_DefineBuiltin(PFSV_tracebatch_run, PF_SV, "tracebatch_run", "float(vector v1, vector v2, entity e, int c)");
+	Scr_DefineBuiltin(PFSV_tracebatch_get, PF_SV, "tracebatch_get", "float(float i)");
+
 	//(vector pos, vector mins, vector maxs, vector color, float thickness, float depthTest, float drawtime)
 
 }
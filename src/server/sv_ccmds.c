@@ -34,7 +34,6 @@ void SV_ModelList_f(void)
 {
 	int		i, nonbmodels = 0;
 	svmodel_t	* mod;
-	qboolean detailed = Cmd_Argc() > 1 ? true : false;
 
 	static char mtypes[5][4] = { "BAD", "BSP", "SPR", "MD3", "BXM" };
 
@@ -984,7 +983,7 @@ void SV_ServerRecord_f (void)
 	//
 	// write a single giant fake message with all the startup info
 	//
-	SZ_Init (&buf, buf_data, sizeof(buf_data));
+	SZ_Init (&buf, (byte *)buf_data, sizeof(buf_data));
 
 	//
 	// serverdata needs to go over for all types of servers
@@ -1066,7 +1065,7 @@ Let the game dll handle a command
 */
 void SV_ServerCommand_f (void)
 {
-	if (!sv.state != ss_game)
+	if (sv.state != ss_game)
 	{
 		Com_Printf ("No game loaded.\n");
 		return;
@@ -25,7 +25,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #define MAX_PERS_FIELDS		64
 
-// link_t is only used for entity area links now
+// link_t is only used for the entity grid in sv_world.c now
 typedef struct link_s
 {
 	struct link_s* prev, * next;
@@ -104,7 +104,7 @@ struct gentity_s
 
 	qboolean	inuse;
 	int			linkcount;
-	link_t		area;				// linked to a division node or leaf	
+	link_t		area;				// unused, area tree links are kept in sv_world.c
 	int			num_clusters;		// if -1, use headnode instead
 	int			clusternums[MAX_ENT_CLUSTERS];
 	int			headnode;			// unused if num_clusters != -1
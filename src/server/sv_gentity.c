@@ -25,15 +25,20 @@ Initializes newly spawned gentity
 void SV_InitEntity(gentity_t* ent)
 {
 	ent->inuse = true;
+	SV_SetEntityActive(ent, true);
 
 	//memset(&ent->s, 0, sizeof(entity_state_t));
 	memset(&ent->v, 0, Scr_GetEntityFieldsSize()); // the size is always read from progs
 
 	ent->s.number = NUM_FOR_EDICT(ent);
+	ent->s.event = 0; // SV_PrepWorldFrame only clears active entities
 	ent->v.classname = Scr_SetString("no_class");
 	ent->v.gravity = 1.0;
 
 	ent->v.groundentity_num = -1;
+
+	SV_UnlinkEdict(ent); // not linked yet, but make it visible to spatial queries
+	SV_TouchEntityIndexes(ent);
 }
 
 /*
@@ -90,7 +95,6 @@ void SV_FreeEntity(gentity_t* ent)
 		Com_DPrintf(DP_SV, "tried to free client entity\n");
 		return;
 	}
-	SV_UnlinkEdict(ent);
 
 	if (ent != sv.edicts)
 	{
@@ -110,6 +114,308 @@ void SV_FreeEntity(gentity_t* ent)
 	ent->v.classname = Scr_SetString("freed");
 	ent->freetime = sv.gameTime;
 	ent->inuse = false;
+
+	SV_SetEntityActive(ent, false);
+	SV_UnlinkEdict(ent);
+	SV_TouchEntityIndexes(ent);
+}
+
+/*
+=================
+SV_SetEntityActive
+
+Keeps track of entities in use so the frame loops can skip free slots.
+The bit may stay set for an entity that isn't in use anymore, so loops still check inuse
+=================
+*/
+void SV_SetEntityActive(gentity_t* ent, qboolean active)
+{
+	int		entnum;
+
+	entnum = NUM_FOR_EDICT(ent);
+	if (active)
+		sv.activeEdicts[entnum >> 5] |= (1u << (entnum & 31));
+	else
+		sv.activeEdicts[entnum >> 5] &= ~(1u << (entnum & 31));
+}
+
+/*
+=================
+SV_NextActiveEntity
+
+Returns the number of the next active entity after entnum or -1 when there are no more, 
+start with -1 to include the world. Entities activated during iteration are still visited 
+if their number is higher than current one, just like with a full sweep.
+
+for (e = SV_NextActiveEntity(-1); e != -1; e = SV_NextActiveEntity(e))
+=================
+*/
+int SV_NextActiveEntity(int entnum)
+{
+	unsigned int	bits;
+
+	for (entnum++; entnum < sv.max_edicts; entnum = (entnum + 32) & ~31)
+	{
+		bits = sv.activeEdicts[entnum >> 5] >> (entnum & 31);
+		if (!bits)
+			continue;
+
+		while (!(bits & 1))
+		{
+			bits >>= 1;
+			entnum++;
+		}
+		return (entnum < sv.max_edicts ? entnum : -1);
+	}
+	return -1;
+}
+
+/*
+===============================================================================
+
+ENTITY FIELD INDEXES
+
+Hot string fields (classname, targetname) are indexed by value so find() doesn't 
+have to check every entity. Chains are kept sorted by entity number, so a script loop 
+continuing from the last found entity is O(1) per call. Entities get reindexed lazily 
+on the next lookup after script (or engine) writes to any of the indexed fields.
+===============================================================================
+*/
+
+#define	FIND_HASH_SIZE	512
+
+typedef struct
+{
+	char	*name;
+	int		ofs;						// field offset, -1 when not indexed
+	int		head[FIND_HASH_SIZE];		// entity numbers, -1 terminated
+	int		tail[FIND_HASH_SIZE];
+	int		next[MAX_GENTITIES];
+	int		prev[MAX_GENTITIES];
+	int		bucket[MAX_GENTITIES];		// -1 when entity is not in index
+} sv_entindex_t;
+
+static sv_entindex_t	sv_entindexes[] = { { "classname" }, { "targetname" } };
+#define	NUM_ENTINDEXES	(sizeof(sv_entindexes) / sizeof(sv_entindexes[0]))
+
+static byte		sv_entindexdirty[MAX_GENTITIES];
+static int		sv_entindexdirtylist[MAX_GENTITIES];
+static int		sv_numentindexdirty;
+
+#define	ENT_STRING_FIELD(ent, ofs) Scr_GetString(((int*)&(ent)->v)[ofs])
+
+/*
+=================
+SV_TouchEntityIndexes
+
+Entity will be reindexed before next lookup
+=================
+*/
+void SV_TouchEntityIndexes(gentity_t* ent)
+{
+	int		entnum;
+
+	entnum = NUM_FOR_EDICT(ent);
+	if (entnum < 0 || entnum >= MAX_GENTITIES || sv_entindexdirty[entnum])
+		return;
+
+	sv_entindexdirty[entnum] = 1;
+	sv_entindexdirtylist[sv_numentindexdirty++] = entnum;
+}
+
+// fields which decide what traces and point contents hit, script may write them
+// without relinking the entity so cached queries have to be dropped then too
+static char *sv_collisionfields[] = { "origin", "angles", "mins", "maxs", "solid", "owner", "svflags" };
+#define	NUM_COLLISIONFIELDS	(sizeof(sv_collisionfields) / sizeof(sv_collisionfields[0]))
+
+/*
+=================
+SV_EntityFieldWritten
+
+Script is about to write to a watched field
+=================
+*/
+static void SV_EntityFieldWritten(vm_entity_t* ent, int fieldofs)
+{
+	int		i;
+
+	for (i = 0; i < NUM_ENTINDEXES; i++)
+	{
+		if (sv_entindexes[i].ofs == fieldofs)
+		{
+			SV_TouchEntityIndexes((gentity_t*)ent);
+			return;
+		}
+	}
+
+	// everything else that is watched is a collision field
+	sv_worldlinkcount++;
+}
+
+static void SV_RemoveFromIndex(sv_entindex_t* idx, int e)
+{
+	int		b;
+
+	b = idx->bucket[e];
+	if (b == -1)
+		return;
+
+	if (idx->prev[e] == -1)
+		idx->head[b] = idx->next[e];
+	else
+		idx->next[idx->prev[e]] = idx->next[e];
+
+	if (idx->next[e] == -1)
+		idx->tail[b] = idx->prev[e];
+	else
+		idx->prev[idx->next[e]] = idx->prev[e];
+
+	idx->bucket[e] = -1;
+}
+
+static void SV_AddToIndex(sv_entindex_t* idx, int e, int b)
+{
+	int		p;
+
+	// entities are mostly added in increasing order, so search from the tail
+	p = idx->tail[b];
+	while (p != -1 && p > e)
+		p = idx->prev[p];
+
+	idx->prev[e] = p;
+	idx->next[e] = (p == -1) ? idx->head[b] : idx->next[p];
+
+	if (idx->next[e] == -1)
+		idx->tail[b] = e;
+	else
+		idx->prev[idx->next[e]] = e;
+
+	if (p == -1)
+		idx->head[b] = e;
+	else
+		idx->next[p] = e;
+
+	idx->bucket[e] = b;
+}
+
+/*
+=================
+SV_UpdateEntityIndexes
+=================
+*/
+static void SV_UpdateEntityIndexes()
+{
+	sv_entindex_t	*idx;
+	gentity_t		*ent;
+	int				i, j, e;
+
+	for (i = 0; i < sv_numentindexdirty; i++)
+	{
+		e = sv_entindexdirtylist[i];
+		sv_entindexdirty[e] = 0;
+		ent = EDICT_NUM(e);
+
+		for (j = 0; j < NUM_ENTINDEXES; j++)
+		{
+			idx = &sv_entindexes[j];
+			if (idx->ofs == -1)
+				continue;
+
+			SV_RemoveFromIndex(idx, e);
+			if (ent->inuse && e != 0)
+				SV_AddToIndex(idx, e, Com_HashKey(ENT_STRING_FIELD(ent, idx->ofs), FIND_HASH_SIZE));
+		}
+	}
+	sv_numentindexdirty = 0;
+}
+
+/*
+=================
+SV_InitEntityIndexes
+
+Called every time progs are loaded, as the field offsets may change.
+Also watches the collision fields for the trace cache
+=================
+*/
+void SV_InitEntityIndexes()
+{
+	sv_entindex_t	*idx;
+	int				i;
+
+	memset(sv_entindexdirty, 0, sizeof(sv_entindexdirty));
+	sv_numentindexdirty = 0;
+
+	for (i = 0; i < NUM_ENTINDEXES; i++)
+	{
+		idx = &sv_entindexes[i];
+		memset(idx->head, -1, sizeof(idx->head));
+		memset(idx->tail, -1, sizeof(idx->tail));
+		memset(idx->bucket, -1, sizeof(idx->bucket));
+
+		idx->ofs = -1;
+		if (sv_findindex->value)
+			idx->ofs = Scr_WatchEntityField(idx->name, SV_EntityFieldWritten);
+	}
+
+	for (i = 0; i < NUM_COLLISIONFIELDS; i++)
+		Scr_WatchEntityField(sv_collisionfields[i], SV_EntityFieldWritten);
+}
+
+/*
+=================
+SV_FindEntity
+
+Returns first entity after 'from' which string field at 'fieldofs' matches 'match', NULL if there's none
+=================
+*/
+gentity_t* SV_FindEntity(gentity_t* from, int fieldofs, char* match)
+{
+	sv_entindex_t	*idx;
+	gentity_t		*ent;
+	int				i, e, start;
+
+	start = (from ? NUM_FOR_EDICT(from) : 0) + 1;
+
+	idx = NULL;
+	for (i = 0; i < NUM_ENTINDEXES; i++)
+	{
+		if (sv_entindexes[i].ofs != -1 && sv_entindexes[i].ofs == fieldofs)
+		{
+			idx = &sv_entindexes[i];
+			break;
+		}
+	}
+
+	if (!idx)
+	{
+		// not indexed, check all entities
+		for (e = SV_NextActiveEntity(start - 1); e != -1; e = SV_NextActiveEntity(e))
+		{
+			ent = EDICT_NUM(e);
+			if (ent->inuse && !strcmp(ENT_STRING_FIELD(ent, fieldofs), match))
+				return ent;
+		}
+		return NULL;
+	}
+
+	SV_UpdateEntityIndexes();
+
+	i = Com_HashKey(match, FIND_HASH_SIZE);
+	if (start > 1 && start - 1 < MAX_GENTITIES && idx->bucket[start - 1] == i)
+		e = idx->next[start - 1]; // continue in the chain right after 'from'
+	else
+		e = idx->head[i];
+
+	for (; e != -1; e = idx->next[e])
+	{
+		if (e < start)
+			continue;
+
+		ent = EDICT_NUM(e);
+		if (!strcmp(ENT_STRING_FIELD(ent, fieldofs), match))
+			return ent;
+	}
+	return NULL;
 }
 
 /*
@@ -213,6 +519,7 @@ void SV_CallSpawn(gentity_t* ent)
 	{
 		// worldspawn hack
 		ent->inuse = 1;
+		SV_SetEntityActive(ent, true);
 		ent->v.modelindex = 1;
 		sv.num_edicts++;
 	}
@@ -362,7 +669,6 @@ void SpawnEntities(char* mapname, char* entities, char* spawnpoint)
 	gentity_t	*ent;
 	int			inhibit, discard, total;
 	char		*com_token;
-	int			i;
 
 //	Z_FreeTags(778);
 
@@ -374,7 +680,6 @@ void SpawnEntities(char* mapname, char* entities, char* spawnpoint)
 	inhibit = discard = total = 0;
 
 	ent = NULL;
-	i = 0;
 	// parse ents
 	while (1)
 	{
@@ -392,6 +697,7 @@ void SpawnEntities(char* mapname, char* entities, char* spawnpoint)
 			// the worldspawn
 			ent = sv.edicts;
 			ent->inuse = true;
+			SV_SetEntityActive(ent, true);
 		}
 		else
 		{
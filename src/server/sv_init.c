@@ -40,7 +40,7 @@ void SV_CreateBaseline (void)
 	gentity_t			*svent;
 	int				entnum;	
 
-	for (entnum = 1; entnum < sv.max_edicts; entnum++)//sv.num_edicts
+	for (entnum = SV_NextActiveEntity(0); entnum != -1; entnum = SV_NextActiveEntity(entnum))
 	{
 		svent = EDICT_NUM(entnum);
 		if (!svent->inuse)
@@ -86,6 +86,7 @@ void SV_CheckForSavegame (void)
 
 	// get configstrings and areaportals
 	SV_ReadLevelFile ();
+	SV_RebuildAssetHash ();
 
 	if (!sv.loadgame)
 	{	// coming back to a level after being in a different
@@ -124,6 +125,8 @@ static void SV_InitGameProgs()
 	sv.edicts = ((gentity_t*)((byte*)Scr_GetEntityPtr()));
 	sv.qcvm_active = true;
 	sv.script_globals = Scr_GetGlobals();
+
+	SV_InitEntityIndexes();
 }
 
 /*
@@ -249,6 +252,8 @@ void SV_SpawnServer (char *server, char *spawnpoint, server_state_t serverstate,
 	// spawn the rest of the entities on the map
 	//	
 
+	SV_RebuildAssetHash ();
+
 	// precache and static commands can be issued during map initialization
 	sv.state = ss_loading;
 	Com_SetServerState (sv.state);
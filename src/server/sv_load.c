@@ -82,6 +82,158 @@ svmodel_t* SV_ModelForNum(unsigned int index)
 	return mod;
 }
 
+/*
+==============================================================================
+
+ASSET NAME HASH
+
+Model, sound and image configstrings hashed by name, so finding the index
+of an already precached asset doesn't compare against every configstring.
+The tables live in server_t and are rebuilt by SV_RebuildAssetHash once 
+the configstrings are filled in directly (SV_SpawnServer, savegames).
+==============================================================================
+*/
+
+/*
+================
+SV_AssetRange
+
+Returns the first configstring of the model, sound or image range index is in
+================
+*/
+static int SV_AssetRange(int index)
+{
+	if (index >= CS_IMAGES)
+		return CS_IMAGES;
+	if (index >= CS_SOUNDS)
+		return CS_SOUNDS;
+	return CS_MODELS;
+}
+
+/*
+================
+SV_AssetFreeSlot
+
+Returns the empty slot hint for the range starting at start
+================
+*/
+static int *SV_AssetFreeSlot(int start)
+{
+	if (start == CS_MODELS)
+		return &sv.assetfree[0];
+	if (start == CS_SOUNDS)
+		return &sv.assetfree[1];
+	return &sv.assetfree[2];
+}
+
+/*
+================
+SV_HashAsset
+================
+*/
+static void SV_HashAsset(int index)
+{
+	unsigned int	hash;
+
+	if (index < CS_MODELS || index >= CS_LIGHTS || !sv.configstrings[index][0])
+		return;
+
+	hash = Com_HashKey(sv.configstrings[index], ASSET_HASH_SIZE);
+	sv.assetnext[index] = sv.assethash[hash];
+	sv.assethash[hash] = index;
+}
+
+/*
+================
+SV_UnhashAsset
+================
+*/
+static void SV_UnhashAsset(int index)
+{
+	unsigned int	hash;
+	int				*link;
+
+	if (index < CS_MODELS || index >= CS_LIGHTS || !sv.configstrings[index][0])
+		return;
+
+	hash = Com_HashKey(sv.configstrings[index], ASSET_HASH_SIZE);
+	for (link = &sv.assethash[hash]; *link; link = &sv.assetnext[*link])
+	{
+		if (*link == index)
+		{
+			*link = sv.assetnext[index];
+			sv.assetnext[index] = 0;
+			return;
+		}
+	}
+}
+
+/*
+================
+SV_RebuildAssetHash
+================
+*/
+void SV_RebuildAssetHash(void)
+{
+	int		i;
+
+	memset(sv.assethash, 0, sizeof(sv.assethash));
+	memset(sv.assetnext, 0, sizeof(sv.assetnext));
+	sv.assetfree[0] = sv.assetfree[1] = sv.assetfree[2] = 1;
+
+	for (i = CS_MODELS; i < CS_LIGHTS; i++)
+		SV_HashAsset(i);
+}
+
+/*
+================
+SV_SetAssetConfigstring
+
+Changes a configstring in the model, sound or image range and keeps the hash in sync
+================
+*/
+void SV_SetAssetConfigstring(int index, char* val)
+{
+	int		start;
+	int		*freeslot;
+
+	SV_UnhashAsset(index);
+	strcpy(sv.configstrings[index], val);
+	SV_HashAsset(index);
+
+	if (!val[0])
+	{	// slot was emptied, let it be reused
+		start = SV_AssetRange(index);
+		freeslot = SV_AssetFreeSlot(start);
+		if (index - start > 0 && index - start < *freeslot)
+			*freeslot = index - start;
+	}
+}
+
+/*
+================
+SV_FindAsset
+
+Returns the lowest index in the range which holds name, 0 if not found
+================
+*/
+static int SV_FindAsset(char* name, int start, int max)
+{
+	int		cs, index;
+
+	index = 0;
+	for (cs = sv.assethash[Com_HashKey(name, ASSET_HASH_SIZE)]; cs; cs = sv.assetnext[cs])
+	{
+		if (cs <= start || cs >= start + max)
+			continue;
+		if (strcmp(sv.configstrings[cs], name))
+			continue;
+		if (!index || cs - start < index)
+			index = cs - start;
+	}
+	return index;
+}
+
 /*
 ================
 SV_FindOrCreateAssetIndex
@@ -92,6 +244,7 @@ Used to load or find server assets (currently only loads only th important MD3 i
 static int SV_FindOrCreateAssetIndex(char* name, int start, int max, const char* func)
 {
 	int		index;
+	int		*freeslot;
 
 	if (!name || !name[0])
 		return 0;
@@ -99,13 +252,19 @@ static int SV_FindOrCreateAssetIndex(char* name, int start, int max, const char*
 	//
 	//  return early if asset has been indexed
 	//
-	for (index = 1; index < max && sv.configstrings[start + index][0]; index++)
-		if (!strcmp(sv.configstrings[start + index], name))
-			return index;
+	index = SV_FindAsset(name, start, max);
+	if (index)
+		return index;
 
 	//
-	// load asset
+	// load asset into the first empty slot
 	//
+	freeslot = SV_AssetFreeSlot(start);
+	index = *freeslot > 1 ? *freeslot : 1;
+	while (index < max && sv.configstrings[start + index][0])
+		index++;
+	*freeslot = index;
+
 	if (index == max)
 		Com_Error(ERR_DROP, "%s: hit limit of %i assets", func, max);
 
@@ -123,6 +282,7 @@ static int SV_FindOrCreateAssetIndex(char* name, int start, int max, const char*
 
 	// update configstring
 	strncpy(sv.configstrings[start + index], name, sizeof(sv.configstrings[index]));
+	SV_HashAsset(start + index);
 
 	if (sv.state != ss_loading)
 	{	// send the update to everyone
@@ -140,7 +300,6 @@ static svmodel_t* SV_LoadModel(char* name, qboolean crash)
 {
 	svmodel_t* model;
 	unsigned* buf;
-	int			fileLen;
 	int			i;
 
 	if (!name[0])
@@ -184,7 +343,7 @@ static svmodel_t* SV_LoadModel(char* name, qboolean crash)
 	//
 	strcpy(model->name, name);
 	model->type = MOD_BAD;
-	fileLen = FS_LoadFile(model->name, &buf);
+	FS_LoadFileView(model->name, (void **)&buf);
 	if (!buf)
 	{
 		if (crash)
@@ -274,8 +433,8 @@ static void SV_LoadMD3(svmodel_t* out, void* buffer)
 		}
 
 		// lowercase the tag name so search compares are faster
-		_strlwr(tag->name);
 		memcpy(out->tagNames[i], tag->name, sizeof(tag->name));
+		Q_strlwr(out->tagNames[i]);
 	}
 
 	// copy tags
@@ -286,13 +445,11 @@ static void SV_LoadMD3(svmodel_t* out, void* buffer)
 	{
 		for (j = 0; j < 3; j++)
 		{
-			tag->origin[j] = LittleFloat(tag->origin[j]);
-			tag->axis[0][j] = LittleFloat(tag->axis[0][j]);
-			tag->axis[1][j] = LittleFloat(tag->axis[1][j]);
-			tag->axis[2][j] = LittleFloat(tag->axis[2][j]);
+			out->tagFrames[i].origin[j] = LittleFloat(tag->origin[j]);
+			out->tagFrames[i].axis[0][j] = LittleFloat(tag->axis[0][j]);
+			out->tagFrames[i].axis[1][j] = LittleFloat(tag->axis[1][j]);
+			out->tagFrames[i].axis[2][j] = LittleFloat(tag->axis[2][j]);
 		}
-		VectorCopy(tag->origin, out->tagFrames[i].origin);
-		memcpy(out->tagFrames[i].axis, tag->axis, sizeof(tag->axis));
 	}
 
 	out->type = MOD_MD3;
@@ -305,20 +462,20 @@ static void SV_LoadMD3(svmodel_t* out, void* buffer)
 static void SV_LoadSP2(svmodel_t* out, void* buffer)
 {
 	sp2Header_t* in;
+	int version, numframes;
 
-	in = (sp2Header_t*)buffer;
+	in = (sp2Header_t*)buffer;	// read only, see FS_LoadFileView
 
-	in->ident = LittleLong(in->ident);
-	in->version = LittleLong(in->version);
-	in->numframes = LittleLong(in->numframes);
+	version = LittleLong(in->version);
+	numframes = LittleLong(in->numframes);
 
-	if( in->version != SP2_VERSION)
-		Com_Error(ERR_DROP, "SV_LoadSP2: '%s' is wrong version %i", out->name, in->version);
+	if( version != SP2_VERSION)
+		Com_Error(ERR_DROP, "SV_LoadSP2: '%s' is wrong version %i", out->name, version);
 
-	if (in->numframes > 32)
-		Com_Error(ERR_DROP, "SV_LoadSP2: '%s' has too many frames (%i > %i)", out->name, in->numframes, 32);
+	if (numframes > 32)
+		Com_Error(ERR_DROP, "SV_LoadSP2: '%s' has too many frames (%i > %i)", out->name, numframes, 32);
 
-	out->numFrames = in->numframes;
+	out->numFrames = numframes;
 	out->numSurfaces = 1;
 	out->type = MOD_SPRITE;
 }
\ No newline at end of file
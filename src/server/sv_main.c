@@ -28,6 +28,9 @@ cvar_t	*sv_paused;
 cvar_t	*sv_timedemo;
 
 cvar_t	*sv_enforcetime;
+cvar_t	*sv_threads;
+cvar_t	*sv_threads_verify;
+cvar_t	*sv_tracecache;			// memoize traces and point contents within a frame
 
 cvar_t	*timeout;				// seconds without any message
 cvar_t	*zombietime;			// seconds to sink messages after disconnect
@@ -44,6 +47,7 @@ cvar_t	*sv_noreload;			// don't reload level state when reentering
 cvar_t	*sv_password;
 cvar_t	*sv_maxclients;	
 cvar_t	*sv_maxentities;
+cvar_t	*sv_findindex;			// index hot entity string fields for find()
 cvar_t	*sv_showclamp;
 cvar_t	*sv_cheats;
 
@@ -73,7 +77,7 @@ typedef enum
 } UI_AlignX;
 
 void UI_DrawString(int x, int y, UI_AlignX alignx, char* string);
-extern PR_Profile(int x, int y);
+extern void PR_Profile(int x, int y);
 extern int		time_before, time_between, time_after;
 void ShowServerStats(int x, int y)
 {
@@ -435,6 +439,7 @@ gotnewcl:
 
 	// parse some info from the info strings
 	strncpy (newcl->userinfo, userinfo, sizeof(newcl->userinfo)-1);
+	newcl->userinfo[sizeof(newcl->userinfo)-1] = 0;
 	SV_UserinfoChanged (newcl);
 
 	// send the connect packet to the client
@@ -732,7 +737,7 @@ void SV_PrepWorldFrame (void)
 	gentity_t	*ent;
 	int		i;
 
-	for (i=0 ; i<sv.max_edicts; i++, ent++) //sv.num_edicts
+	for (i = SV_NextActiveEntity(-1); i != -1; i = SV_NextActiveEntity(i))
 	{
 		ent = EDICT_NUM(i);
 		// events only last for a single message
@@ -778,6 +783,23 @@ void SV_RunGameFrame (void)
 
 }
 
+/*
+==================
+SV_FrameWait
+
+Milliseconds until SV_Frame has something to do, the dedicated server sleeps this long
+==================
+*/
+int SV_FrameWait (void)
+{
+	if (!svs.initialized)
+		return 100;		// only console input and packets wake us up
+
+	if (sv_timedemo->value || svs.realtime >= sv.time)
+		return 0;
+	return sv.time - svs.realtime;
+}
+
 /*
 ==================
 SV_Frame
@@ -974,6 +996,7 @@ void SV_Init (void)
 	sv_maxclients = Cvar_Get("sv_maxclients", "4", CVAR_SERVERINFO | CVAR_LATCH);
 	sv_password = Cvar_Get("sv_password", "", 0);
 	sv_maxentities = Cvar_Get("sv_maxentities", "1024", CVAR_LATCH);
+	sv_findindex = Cvar_Get("sv_findindex", "1", CVAR_LATCH);
 
 	sv_maxvelocity = Cvar_Get("sv_maxevelocity", "1500", CVAR_LATCH);
 	sv_gravity = Cvar_Get("sv_gravity", "800", CVAR_LATCH);
@@ -991,6 +1014,9 @@ void SV_Init (void)
 	sv_paused = Cvar_Get ("paused", "0", 0);
 	sv_timedemo = Cvar_Get ("timedemo", "0", 0);
 	sv_enforcetime = Cvar_Get ("sv_enforcetime", "0", 0);
+	sv_threads = Cvar_Get ("sv_threads", "1", 0);
+	sv_threads_verify = Cvar_Get ("sv_threads_verify", "0", 0);
+	sv_tracecache = Cvar_Get ("sv_tracecache", "0", 0);
 
 	allow_download = Cvar_Get ("allow_download", "0", CVAR_ARCHIVE);
 	allow_download_models = Cvar_Get ("allow_download_models", "1", CVAR_ARCHIVE);
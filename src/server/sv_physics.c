@@ -476,7 +476,7 @@ qboolean SV_Push(gentity_t* pusher, vec3_t move, vec3_t amove)
 	SV_LinkEdict(pusher);
 
 	// see if any solid entities are inside the final position
-	for (e = 1; e < sv.max_edicts; e++) //sv.num_edicts
+	for (e = SV_NextActiveEntity(0); e != -1; e = SV_NextActiveEntity(e))
 	{
 		check = EDICT_NUM(e);
 
@@ -486,7 +486,7 @@ qboolean SV_Push(gentity_t* pusher, vec3_t move, vec3_t amove)
 		if (check->v.movetype == MOVETYPE_PUSH || check->v.movetype == MOVETYPE_STOP || check->v.movetype == MOVETYPE_NONE || check->v.movetype == MOVETYPE_NOCLIP)
 			continue;
 
-		if (!check->area.prev)
+		if (!SV_EdictLinked (check))
 			continue;		// not linked in anywhere
 
 		// if the entity is standing on the pusher, it will definitely be moved
@@ -727,7 +727,7 @@ void SV_Physics_Toss(gentity_t* ent)
 	gentity_t* groundent = NULL;
 
 	if (ent->v.groundentity_num != ENTITYNUM_NULL)
-		groundent = ENT_FOR_NUM((int)ent->v.groundentity_num);
+		groundent = EDICT_NUM((int)ent->v.groundentity_num);
 
 	// check for the groundentity going away
 	if (groundent)
@@ -855,7 +855,7 @@ void SV_Physics_Step(gentity_t* ent)
 	if ((int)ent->v.groundentity_num == ENTITYNUM_NULL)
 		SV_CheckGround(ent);
 
-	groundentity = ((int)ent->v.groundentity_num == ENTITYNUM_NULL) ? NULL : ENT_FOR_NUM((int)ent->v.groundentity_num);
+	groundentity = ((int)ent->v.groundentity_num == ENTITYNUM_NULL) ? NULL : EDICT_NUM((int)ent->v.groundentity_num);
 
 	SV_CheckVelocity(ent);
 
@@ -14,7 +14,7 @@ See the attached GNU General Public License v2 for more details.
 
 void Scr_SV_OP(eval_t *a, eval_t* b, eval_t* c)
 {
-	gentity_t *ed = VM_TO_ENT(sv.script_globals->self);
+	gentity_t *ed = PROG_TO_GENT(sv.script_globals->self);
 	ed->v.nextthink = sv.script_globals->g_time + 0.1;
 	if (a->_float != ed->v.animFrame)
 	{
@@ -232,6 +232,7 @@ void Scr_ClientDisconnect(gentity_t* ent)
 //	ent->v.modelindex[0] = 0;
 //	ent->v.solid = SOLID_NOT;
 	ent->inuse = false;
+	SV_SetEntityActive(ent, false);
 	ent->v.classname = Scr_SetString("disconnected");
 	ent->client->pers.connected = false;
 }
@@ -386,6 +386,8 @@ FRAME UPDATES
 /*
 =======================
 SV_SendClientDatagram
+
+Client frame must be built with SV_BuildClientFrames first
 =======================
 */
 qboolean SV_SendClientDatagram (client_t *client)
@@ -393,8 +395,6 @@ qboolean SV_SendClientDatagram (client_t *client)
 	byte		msg_buf[MAX_MSGLEN];
 	sizebuf_t	msg;
 
-	SV_BuildClientFrame (client);
-
 	SZ_Init (&msg, msg_buf, sizeof(msg_buf));
 	msg.allowoverflow = true;
 
@@ -479,18 +479,21 @@ qboolean SV_RateDrop (client_t *c)
 
 /*
 =======================
-SV_SendClientMessages
+SV_SendClientPackets
 =======================
 */
-void SV_SendClientMessages (void)
+static void SV_SendClientPackets (void)
 {
 	int			i;
 	client_t	*c;
 	int			msglen;
-	byte		msgbuf[MAX_MSGLEN];
+	byte		msgbuf[MAX_NETMSGLEN];
 	size_t		r;
+	client_t	*framecl[MAX_CLIENTS];
+	int			numframecl;
 
 	msglen = 0;
+	numframecl = 0;
 
 	// read the next demo message if needed
 	if (sv.state == ss_demo && sv.demofile)
@@ -512,8 +515,8 @@ void SV_SendClientMessages (void)
 				SV_DemoCompleted ();
 				return;
 			}
-			if (msglen > MAX_MSGLEN)
-				Com_Error (ERR_DROP, "SV_SendClientMessages: msglen > MAX_MSGLEN");
+			if (msglen > MAX_NETMSGLEN)
+				Com_Error (ERR_DROP, "SV_SendClientMessages: msglen > MAX_NETMSGLEN");
 			r = fread (msgbuf, msglen, 1, sv.demofile);
 			if (r != 1)
 			{
@@ -549,7 +552,8 @@ void SV_SendClientMessages (void)
 			if (SV_RateDrop (c))
 				continue;
 
-			SV_SendClientDatagram (c);
+			// datagrams are sent once all the frames are built
+			framecl[numframecl++] = c;
 		}
 		else
 		{
@@ -558,5 +562,29 @@ void SV_SendClientMessages (void)
 				Netchan_Transmit (&c->netchan, 0, NULL);
 		}
 	}
+
+	if (!numframecl)
+		return;
+
+	SV_BuildClientFrames (framecl, numframecl);
+
+	for (i = 0; i < numframecl; i++)
+	{
+		if (framecl[i]->edict->client)
+			SV_SendClientDatagram (framecl[i]);
+	}
 }
 
+/*
+=======================
+SV_SendClientMessages
+
+All datagrams of the frame leave in one batch
+=======================
+*/
+void SV_SendClientMessages (void)
+{
+	NET_BeginBatch (NS_SERVER);
+	SV_SendClientPackets ();
+	NET_FlushBatch (NS_SERVER);
+}
@@ -60,7 +60,7 @@ void SV_EndWorldFrame(void)
 	}
 
 	// build entity_state_t structure for all server entities
-	for (i = 0; i < sv.max_edicts; i++)//sv.num_edicts
+	for (i = SV_NextActiveEntity(-1); i != -1; i = SV_NextActiveEntity(i))
 	{
 		ent = EDICT_NUM(i);
 		if (!ent->inuse)
@@ -157,7 +157,7 @@ void SV_RunWorldFrame(void)
 
 	SV_ScriptStartFrame();
 
-	for (i = 0; i < sv.max_edicts; i++)//sv.num_edicts
+	for (i = SV_NextActiveEntity(-1); i != -1; i = SV_NextActiveEntity(i))
 	{
 		ent = EDICT_NUM(i);
 		if (!ent->inuse)
@@ -167,7 +167,7 @@ void SV_RunWorldFrame(void)
 
 		VectorCopy(ent->v.origin, ent->v.old_origin);
 
-		gentity_t* groundentity = (ent->v.groundentity_num == ENTITYNUM_NULL) ? NULL : ENT_FOR_NUM((int)ent->v.groundentity_num);
+		gentity_t* groundentity = (ent->v.groundentity_num == ENTITYNUM_NULL) ? NULL : EDICT_NUM((int)ent->v.groundentity_num);
 //		groundentity = ent->groundentity;
 
 		// if the ground entity moved, make sure we are still on it
@@ -204,33 +204,69 @@ FIXME: this use of "area" is different from the bsp file use
 ===============================================================================
 */
 
-// (type *)STRUCT_FROM_LINK(link_t *link, type, member)
-// ent = STRUCT_FROM_LINK(link,centity_t,order)
-// FIXME: remove this mess!
-#define	STRUCT_FROM_LINK(l,t,m) ((t *)((byte *)l - (int)&(((t *)0)->m)))
+/*
+The area tree starts out deep enough for the world size, and leaves that collect
+more than AREA_SPLIT_COUNT entities are split further as entities get linked.
+Node lists are arrays of entity numbers in link order, sv_arealinks remembers
+where each entity is so it can be unlinked without touching the entity.
+*/
+#define	AREA_LEAF_SIZE		1024	// initial leaves are no larger than this, 4 levels on a 4096 unit map
+#define	AREA_START_DEPTH	8		// most levels built up front
+#define	AREA_MAX_DEPTH		10
+#define	AREA_NODES			(2 << AREA_MAX_DEPTH)
+#define	AREA_SPLIT_COUNT	32		// entities in a leaf before it gets split
 
-#define	EDICT_FROM_AREA(l) STRUCT_FROM_LINK(l,gentity_t,area)
+#define	AREALIST_SOLID		0
+#define	AREALIST_TRIGGER	1
+
+typedef struct
+{
+	int		*nums;
+	int		count, size;
+} arealist_t;
 
 typedef struct areanode_s
 {
 	int		axis;		// -1 = leaf node
 	float	dist;
 	struct areanode_s	*children[2];
-	link_t	trigger_edicts;
-	link_t	solid_edicts;
+	int		depth;
+	vec3_t	mins, maxs;
+	arealist_t	lists[2];	// AREALIST_SOLID, AREALIST_TRIGGER
 } areanode_t;
 
-#define	AREA_DEPTH	4
-#define	AREA_NODES	32
+typedef struct
+{
+	short	node;		// areanode index + 1, 0 when not linked
+	short	list;
+} arealink_t;
 
 areanode_t	sv_areanodes[AREA_NODES];
 int			sv_numareanodes;
+arealink_t	sv_arealinks[MAX_GENTITIES];	// indexed by entity number
 
 float	*area_mins, *area_maxs;
 gentity_t	**area_list;
 int		area_count, area_maxcount;
 int		area_type;
 
+/*
+Entities that are not part of the area node tree (SOLID_NOT and never linked ones)
+are kept in a uniform grid so spatial queries don't have to walk every edict.
+Entities too big for a single cell or outside of the world bounds go to the loose list.
+*/
+#define	GRID_CELLS	32	// per axis
+
+link_t	sv_gridcells[GRID_CELLS * GRID_CELLS];
+link_t	sv_gridloose;
+link_t	sv_gridlinks[MAX_GENTITIES];	// indexed by entity number
+vec3_t	sv_gridmins;
+float	sv_gridcellsize[2];
+
+#define	EDICT_FROM_GRID(l) EDICT_NUM((l) - sv_gridlinks)
+
+int		sv_worldlinkcount;	// bumped every time an entity is linked or unlinked, see SV_EntityFieldWritten
+
 int SV_HullForEntity (gentity_t *ent);
 
 
@@ -256,61 +292,295 @@ void InsertLinkBefore (link_t *l, link_t *before)
 
 /*
 ===============
-SV_CreateAreaNode
-
-Builds a uniformly subdivided tree for the given world size
+SV_NewAreaNode
 ===============
 */
-areanode_t *SV_CreateAreaNode (int depth, vec3_t mins, vec3_t maxs)
+static areanode_t *SV_NewAreaNode (int depth, vec3_t mins, vec3_t maxs)
 {
 	areanode_t	*anode;
-	vec3_t		size;
-	vec3_t		mins1, maxs1, mins2, maxs2;
 
 	anode = &sv_areanodes[sv_numareanodes];
 	sv_numareanodes++;
 
-	ClearLink (&anode->trigger_edicts);
-	ClearLink (&anode->solid_edicts);
-	
-	if (depth == AREA_DEPTH)
-	{
-		anode->axis = -1;
-		anode->children[0] = anode->children[1] = NULL;
-		return anode;
-	}
-	
-	VectorSubtract (maxs, mins, size);
+	anode->axis = -1;
+	anode->children[0] = anode->children[1] = NULL;
+	anode->depth = depth;
+	VectorCopy (mins, anode->mins);
+	VectorCopy (maxs, anode->maxs);
+	return anode;
+}
+
+/*
+===============
+SV_DivideAreaNode
+
+Turns a leaf into a node with two leaf children split across the longer horizontal side
+===============
+*/
+static void SV_DivideAreaNode (areanode_t *anode)
+{
+	vec3_t		size;
+	vec3_t		mins1, maxs1, mins2, maxs2;
+
+	VectorSubtract (anode->maxs, anode->mins, size);
 	if (size[0] > size[1])
 		anode->axis = 0;
 	else
 		anode->axis = 1;
 	
-	anode->dist = 0.5 * (maxs[anode->axis] + mins[anode->axis]);
-	VectorCopy (mins, mins1);	
-	VectorCopy (mins, mins2);	
-	VectorCopy (maxs, maxs1);	
-	VectorCopy (maxs, maxs2);	
+	anode->dist = 0.5 * (anode->maxs[anode->axis] + anode->mins[anode->axis]);
+	VectorCopy (anode->mins, mins1);	
+	VectorCopy (anode->mins, mins2);	
+	VectorCopy (anode->maxs, maxs1);	
+	VectorCopy (anode->maxs, maxs2);	
 	
 	maxs1[anode->axis] = mins2[anode->axis] = anode->dist;
 	
-	anode->children[0] = SV_CreateAreaNode (depth+1, mins2, maxs2);
-	anode->children[1] = SV_CreateAreaNode (depth+1, mins1, maxs1);
+	anode->children[0] = SV_NewAreaNode (anode->depth+1, mins2, maxs2);
+	anode->children[1] = SV_NewAreaNode (anode->depth+1, mins1, maxs1);
+}
 
-	return anode;
+/*
+===============
+SV_CreateAreaNodes
+
+Subdivides the tree uniformly until the leaves are no larger than AREA_LEAF_SIZE
+===============
+*/
+static void SV_CreateAreaNodes (areanode_t *anode)
+{
+	if (anode->depth == AREA_START_DEPTH)
+		return;
+	if (anode->maxs[0] - anode->mins[0] <= AREA_LEAF_SIZE && anode->maxs[1] - anode->mins[1] <= AREA_LEAF_SIZE)
+		return;
+
+	SV_DivideAreaNode (anode);
+	SV_CreateAreaNodes (anode->children[0]);
+	SV_CreateAreaNodes (anode->children[1]);
 }
 
 /*
 ===============
-SV_ClearWorld
+SV_AreaListAppend
+===============
+*/
+static void SV_AreaListAppend (areanode_t *node, int list, int entnum)
+{
+	arealist_t	*l;
+	int			*nums;
+
+	l = &node->lists[list];
+	if (l->count == l->size)
+	{
+		l->size = l->size ? l->size * 2 : 8;
+		nums = Z_Malloc (l->size * sizeof(int));
+		if (l->nums)
+		{
+			memcpy (nums, l->nums, l->count * sizeof(int));
+			Z_Free (l->nums);
+		}
+		l->nums = nums;
+	}
+	l->nums[l->count++] = entnum;
+
+	sv_arealinks[entnum].node = node - sv_areanodes + 1;
+	sv_arealinks[entnum].list = list;
+}
+
+/*
+===============
+SV_AreaListRemove
 
+Keeps the link order, the lists are short enough for the move to not matter
 ===============
 */
-void SV_ClearWorld (void)
+static void SV_AreaListRemove (int entnum)
+{
+	arealist_t	*l;
+	int			i;
+
+	l = &sv_areanodes[sv_arealinks[entnum].node - 1].lists[sv_arealinks[entnum].list];
+	for (i = 0; i < l->count; i++)
+	{
+		if (l->nums[i] == entnum)
+		{
+			memmove (l->nums + i, l->nums + i + 1, (l->count - i - 1) * sizeof(int));
+			l->count--;
+			break;
+		}
+	}
+	sv_arealinks[entnum].node = 0;
+}
+
+/*
+===============
+SV_AreaNodeForBox
+
+Finds the first node that the box crosses, starting at node
+===============
+*/
+static areanode_t *SV_AreaNodeForBox (areanode_t *node, vec3_t absmin, vec3_t absmax)
 {
+	while (1)
+	{
+		if (node->axis == -1)
+			break;
+		if (absmin[node->axis] > node->dist)
+			node = node->children[0];
+		else if (absmax[node->axis] < node->dist)
+			node = node->children[1];
+		else
+			break;		// crosses the node
+	}
+	return node;
+}
+
+/*
+===============
+SV_SplitAreaNode
+
+Divides a crowded leaf and moves the entities that fit into the new children
+===============
+*/
+static void SV_SplitAreaNode (areanode_t *node)
+{
+	arealist_t	old;
+	areanode_t	*dest;
+	gentity_t	*ent;
+	int			i, list;
+
+	if (node->depth == AREA_MAX_DEPTH || sv_numareanodes + 2 > AREA_NODES)
+		return;
+
+	SV_DivideAreaNode (node);
+
+	for (list = 0; list < 2; list++)
+	{
+		old = node->lists[list];
+		node->lists[list].count = 0;
+		for (i = 0; i < old.count; i++)
+		{
+			ent = EDICT_NUM(old.nums[i]);
+			dest = SV_AreaNodeForBox (node, ent->v.absmin, ent->v.absmax);
+			if (dest == node)
+				node->lists[list].nums[node->lists[list].count++] = old.nums[i];	// never grows past old
+			else
+				SV_AreaListAppend (dest, list, old.nums[i]);
+		}
+	}
+}
+
+/*
+===============
+SV_ClearAreaNodes
+===============
+*/
+static void SV_ClearAreaNodes (void)
+{
+	int		i, j;
+
+	for (i = 0; i < sv_numareanodes; i++)
+		for (j = 0; j < 2; j++)
+			if (sv_areanodes[i].lists[j].nums)
+				Z_Free (sv_areanodes[i].lists[j].nums);
+
 	memset (sv_areanodes, 0, sizeof(sv_areanodes));
+	memset (sv_arealinks, 0, sizeof(sv_arealinks));
 	sv_numareanodes = 0;
-	SV_CreateAreaNode (0, sv.models[1].bmodel->mins, sv.models[1].bmodel->maxs);
+}
+
+/*
+===============
+SV_EdictLinked
+
+True if the entity is in the area tree
+===============
+*/
+qboolean SV_EdictLinked (gentity_t *ent)
+{
+	return sv_arealinks[NUM_FOR_EDICT(ent)].node != 0;
+}
+
+/*
+===============
+SV_GridLinkEdict
+
+Moves entity to the given grid list, or takes it out of the grid when list is NULL
+===============
+*/
+static void SV_GridLinkEdict (gentity_t *ent, link_t *list)
+{
+	link_t	*l;
+
+	l = &sv_gridlinks[NUM_FOR_EDICT(ent)];
+	if (l->prev)
+	{
+		RemoveLink (l);
+		l->prev = l->next = NULL;
+	}
+
+	if (list)
+		InsertLinkBefore (l, list);
+}
+
+/*
+===============
+SV_GridCellForEdict
+===============
+*/
+static link_t *SV_GridCellForEdict (gentity_t *ent)
+{
+	int		i, cell[2];
+	float	center;
+
+	for (i = 0; i < 2; i++)
+	{
+		if (ent->v.absmax[i] - ent->v.absmin[i] > sv_gridcellsize[i])
+			return &sv_gridloose; // spans multiple cells
+
+		center = 0.5f * (ent->v.absmin[i] + ent->v.absmax[i]);
+		cell[i] = (int)floor((center - sv_gridmins[i]) / sv_gridcellsize[i]);
+		if (cell[i] < 0 || cell[i] >= GRID_CELLS)
+			return &sv_gridloose; // outside of the world
+	}
+	return &sv_gridcells[cell[1] * GRID_CELLS + cell[0]];
+}
+
+/*
+===============
+SV_ClearGrid
+===============
+*/
+static void SV_ClearGrid (vec3_t mins, vec3_t maxs)
+{
+	int		i;
+
+	memset (sv_gridlinks, 0, sizeof(sv_gridlinks));
+	for (i = 0; i < GRID_CELLS * GRID_CELLS; i++)
+		ClearLink (&sv_gridcells[i]);
+	ClearLink (&sv_gridloose);
+
+	for (i = 0; i < 2; i++)
+	{
+		sv_gridmins[i] = mins[i];
+		sv_gridcellsize[i] = (maxs[i] - mins[i]) / GRID_CELLS;
+		if (sv_gridcellsize[i] < 1.0f)
+			sv_gridcellsize[i] = 1.0f;
+	}
+	sv_worldlinkcount++;
+}
+
+/*
+===============
+SV_ClearWorld
+
+===============
+*/
+void SV_ClearWorld (void)
+{
+	SV_ClearAreaNodes ();
+	SV_CreateAreaNodes (SV_NewAreaNode (0, sv.models[1].bmodel->mins, sv.models[1].bmodel->maxs));
+	SV_ClearGrid (sv.models[1].bmodel->mins, sv.models[1].bmodel->maxs);
 }
 
 
@@ -322,10 +592,14 @@ SV_UnlinkEdict
 */
 void SV_UnlinkEdict (gentity_t *ent)
 {
-	if (!ent->area.prev)
+	// entities in use stay visible to spatial queries through the loose list
+	if (ent != sv.edicts)
+		SV_GridLinkEdict (ent, ent->inuse ? &sv_gridloose : NULL);
+	sv_worldlinkcount++;
+
+	if (!sv_arealinks[NUM_FOR_EDICT(ent)].node)
 		return;		// not linked in anywhere
-	RemoveLink (&ent->area);
-	ent->area.prev = ent->area.next = NULL;
+	SV_AreaListRemove (NUM_FOR_EDICT(ent));
 }
 
 #if PROTOCOL_FLOAT_COORDS == 1
@@ -412,7 +686,7 @@ void SV_LinkEdict (gentity_t *ent)
 	int			area;
 	int			topnode;
 
-	if (ent->area.prev)
+	if (sv_arealinks[NUM_FOR_EDICT(ent)].node)
 		SV_UnlinkEdict (ent);	// unlink from old position
 		
 	if (ent == sv.edicts)
@@ -421,6 +695,8 @@ void SV_LinkEdict (gentity_t *ent)
 	if (!ent->inuse)
 		return;
 
+	sv_worldlinkcount++;
+
 	// set the size
 	VectorSubtract (ent->v.maxs, ent->v.mins, ent->v.size);
 
@@ -550,28 +826,20 @@ void SV_LinkEdict (gentity_t *ent)
 	ent->linkcount++;
 
 	if (ent->v.solid == SOLID_NOT)
+	{
+		SV_GridLinkEdict (ent, SV_GridCellForEdict(ent));
 		return;
+	}
+	SV_GridLinkEdict (ent, NULL);
 
 // find the first node that the ent's box crosses
-	node = sv_areanodes;
-	while (1)
-	{
-		if (node->axis == -1)
-			break;
-		if (ent->v.absmin[node->axis] > node->dist)
-			node = node->children[0];
-		else if (ent->v.absmax[node->axis] < node->dist)
-			node = node->children[1];
-		else
-			break;		// crosses the node
-	}
+	node = SV_AreaNodeForBox (sv_areanodes, ent->v.absmin, ent->v.absmax);
 	
 	// link it in	
-	if (ent->v.solid == SOLID_TRIGGER)
-		InsertLinkBefore (&ent->area, &node->trigger_edicts);
-	else
-		InsertLinkBefore (&ent->area, &node->solid_edicts);
+	SV_AreaListAppend (node, ent->v.solid == SOLID_TRIGGER ? AREALIST_TRIGGER : AREALIST_SOLID, NUM_FOR_EDICT(ent));
 
+	if (node->axis == -1 && node->lists[AREALIST_SOLID].count + node->lists[AREALIST_TRIGGER].count > AREA_SPLIT_COUNT)
+		SV_SplitAreaNode (node);
 }
 
 
@@ -581,24 +849,21 @@ SV_AreaEdicts_r
 
 ====================
 */
-void SV_AreaEdicts_r (areanode_t *node)
+static void SV_AreaEdicts_r (areanode_t *node)
 {
-	link_t		*l, *next, *start;
+	arealist_t	*list;
 	gentity_t		*check;
-	int			count;
-
-	count = 0;
+	int			i;
 
 	// touch linked edicts
 	if (area_type == AREA_SOLID)
-		start = &node->solid_edicts;
+		list = &node->lists[AREALIST_SOLID];
 	else
-		start = &node->trigger_edicts;
+		list = &node->lists[AREALIST_TRIGGER];
 
-	for (l=start->next  ; l != start ; l = next)
+	for (i = 0; i < list->count; i++)
 	{
-		next = l->next;
-		check = EDICT_FROM_AREA(l);
+		check = EDICT_NUM(list->nums[i]);
 
 		if (check->v.solid == SOLID_NOT)
 			continue;		// deactivated
@@ -649,8 +914,218 @@ int SV_AreaEdicts (vec3_t mins, vec3_t maxs, gentity_t **list, int maxcount, int
 	return area_count;
 }
 
+/*
+====================
+SV_FindInBox_r
 
-//===========================================================================
+Same as SV_AreaEdicts_r but collects both solid and trigger lists including deactivated entities
+====================
+*/
+static void SV_FindInBox_r (areanode_t *node)
+{
+	arealist_t	*list;
+	gentity_t	*check;
+	int			i, j;
+
+	for (i = 0; i < 2; i++)
+	{
+		list = &node->lists[i];
+		for (j = 0; j < list->count; j++)
+		{
+			check = EDICT_NUM(list->nums[j]);
+
+			if (check->v.absmin[0] > area_maxs[0]
+			|| check->v.absmin[1] > area_maxs[1]
+			|| check->v.absmin[2] > area_maxs[2]
+			|| check->v.absmax[0] < area_mins[0]
+			|| check->v.absmax[1] < area_mins[1]
+			|| check->v.absmax[2] < area_mins[2])
+				continue;		// not touching
+
+			if (area_count == area_maxcount)
+				return;
+
+			area_list[area_count++] = check;
+		}
+	}
+
+	if (node->axis == -1)
+		return;		// terminal node
+
+	// recurse down both sides
+	if (area_maxs[node->axis] > node->dist)
+		SV_FindInBox_r (node->children[0]);
+	if (area_mins[node->axis] < node->dist)
+		SV_FindInBox_r (node->children[1]);
+}
+
+/*
+====================
+SV_FindInGridList
+====================
+*/
+static void SV_FindInGridList (link_t *start, qboolean loose)
+{
+	link_t		*l;
+	gentity_t	*check;
+	vec3_t		mins, maxs;
+	float		*absmin, *absmax;
+
+	for (l = start->next; l != start; l = l->next)
+	{
+		check = EDICT_FROM_GRID(l);
+		if (!check->inuse)
+			continue;
+
+		if (loose)
+		{
+			// never linked entities have no valid absmin/absmax
+			VectorAdd (check->v.origin, check->v.mins, mins);
+			VectorAdd (check->v.origin, check->v.maxs, maxs);
+			absmin = mins;
+			absmax = maxs;
+		}
+		else
+		{
+			absmin = check->v.absmin;
+			absmax = check->v.absmax;
+		}
+
+		if (absmin[0] > area_maxs[0]
+		|| absmin[1] > area_maxs[1]
+		|| absmin[2] > area_maxs[2]
+		|| absmax[0] < area_mins[0]
+		|| absmax[1] < area_mins[1]
+		|| absmax[2] < area_mins[2])
+			continue;		// not touching
+
+		if (area_count == area_maxcount)
+			return;
+
+		area_list[area_count++] = check;
+	}
+}
+
+static int SV_CompareEdicts (const void *a, const void *b)
+{
+	const gentity_t *e1 = *(const gentity_t **)a;
+	const gentity_t *e2 = *(const gentity_t **)b;
+
+	if (e1 < e2)
+		return -1;
+	return (e1 > e2);
+}
+
+/*
+================
+SV_FindInBox
+
+Fills in a table of edict pointers with all entities whose bounding boxes touch the given area,
+sorted by entity number. Unlike SV_AreaEdicts this also returns triggers, SOLID_NOT and never 
+linked entities, so it can replace a full sweep over all edicts in scripts.
+Entities are found at the position they were last linked at.
+================
+*/
+int SV_FindInBox (vec3_t mins, vec3_t maxs, gentity_t **list, int maxcount)
+{
+	int		x, y, lo[2], hi[2];
+
+	area_mins = mins;
+	area_maxs = maxs;
+	area_list = list;
+	area_count = 0;
+	area_maxcount = maxcount;
+
+	SV_FindInBox_r (sv_areanodes);
+
+	// grid entities may stick out of their cell up to half of the cell size
+	for (x = 0; x < 2; x++)
+	{
+		lo[x] = (int)floor((mins[x] - sv_gridmins[x]) / sv_gridcellsize[x] - 1.5f);
+		hi[x] = (int)floor((maxs[x] - sv_gridmins[x]) / sv_gridcellsize[x] + 0.5f);
+		if (lo[x] < 0)
+			lo[x] = 0;
+		if (hi[x] > GRID_CELLS - 1)
+			hi[x] = GRID_CELLS - 1;
+	}
+
+	for (y = lo[1]; y <= hi[1]; y++)
+		for (x = lo[0]; x <= hi[0]; x++)
+			SV_FindInGridList (&sv_gridcells[y * GRID_CELLS + x], false);
+	SV_FindInGridList (&sv_gridloose, true);
+
+	if (area_count == area_maxcount)
+		Com_Printf ("SV_FindInBox: MAXCOUNT\n");
+
+	qsort (list, area_count, sizeof(list[0]), SV_CompareEdicts);
+	return area_count;
+}
+
+
+/*
+===============================================================================
+
+RESULT CACHE
+
+Opt-in (sv_tracecache) memoization of SV_Trace and SV_PointContents, AI code
+asks the same ground and line of sight questions many times in a frame.
+Entries are good for the frame and world link count they were made in, so any
+SV_LinkEdict/SV_UnlinkEdict drops them all, as does script writing to origin,
+angles, bounds, solid, owner or svflags of an entity without relinking it. Slots are picked by a hash of the
+inputs snapped to 1/8 unit but a hit needs the exact same inputs.
+
+Only used from the main thread, SV_TraceBatch jobs don't come through here.
+
+===============================================================================
+*/
+
+#define	TRACECACHE_SIZE		1024	// power of two
+#define	POINTCACHE_SIZE		256
+
+typedef struct
+{
+	vec3_t		start, end, mins, maxs;
+	int			passent, passowner;	// the owner decides what passent skips
+	int			contentmask;
+} tracekey_t;
+
+typedef struct
+{
+	tracekey_t	key;
+	int			linkcount, framenum;
+	qboolean	valid;
+	trace_t		trace;
+} tracecache_t;
+
+typedef struct
+{
+	vec3_t		point;
+	int			linkcount, framenum;
+	qboolean	valid;
+	int			contents;
+} pointcache_t;
+
+static tracecache_t	sv_tracecache_slots[TRACECACHE_SIZE];
+static pointcache_t	sv_pointcache_slots[POINTCACHE_SIZE];
+
+int		c_tracecache_hits, c_pointcache_hits;	// shown with c_traces by showtrace
+
+/*
+=============
+SV_CacheHash
+=============
+*/
+static unsigned int SV_CacheHash (float *v, int count, unsigned int hash)
+{
+	int		i;
+
+	for (i = 0; i < count; i++)
+		hash = (hash ^ (unsigned int)(int)floor (v[i] * 8.0f)) * 16777619u;
+	return hash;
+}
+
+static trace_t SV_TraceUncached (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, gentity_t *passedict, int contentmask);
+static int SV_PointContentsUncached (vec3_t p);
 
 /*
 =============
@@ -658,6 +1133,85 @@ SV_PointContents
 =============
 */
 int SV_PointContents (vec3_t p)
+{
+	pointcache_t	*pc;
+
+	if (!sv_tracecache->value)
+		return SV_PointContentsUncached (p);
+
+	pc = &sv_pointcache_slots[SV_CacheHash (p, 3, 2166136261u) & (POINTCACHE_SIZE - 1)];
+	if (pc->valid && pc->linkcount == sv_worldlinkcount && pc->framenum == sv.framenum && VectorCompare (pc->point, p))
+	{
+		c_pointcache_hits++;
+		return pc->contents;
+	}
+
+	pc->contents = SV_PointContentsUncached (p);
+	VectorCopy (p, pc->point);
+	pc->linkcount = sv_worldlinkcount;
+	pc->framenum = sv.framenum;
+	pc->valid = true;
+	return pc->contents;
+}
+
+/*
+==================
+SV_Trace
+
+Moves the given mins/maxs volume through the world from start to end.
+
+Passedict and edicts owned by passedict are explicitly not checked.
+
+==================
+*/
+trace_t SV_Trace (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, gentity_t *passedict, int contentmask)
+{
+	tracekey_t		key;
+	tracecache_t	*tc;
+	unsigned int	hash;
+
+	if (!mins)
+		mins = vec3_origin;
+	if (!maxs)
+		maxs = vec3_origin;
+
+	if (!sv_tracecache->value)
+		return SV_TraceUncached (start, mins, maxs, end, passedict, contentmask);
+
+	VectorCopy (start, key.start);
+	VectorCopy (end, key.end);
+	VectorCopy (mins, key.mins);
+	VectorCopy (maxs, key.maxs);
+	key.passent = passedict ? NUM_FOR_EDICT(passedict) : -1;
+	key.passowner = passedict ? passedict->v.owner : 0;
+	key.contentmask = contentmask;
+
+	hash = SV_CacheHash (key.start, 12, 2166136261u);
+	hash = (hash ^ key.passent ^ (key.contentmask << 10)) * 16777619u;
+
+	tc = &sv_tracecache_slots[(hash ^ (hash >> 16)) & (TRACECACHE_SIZE - 1)];
+	if (tc->valid && tc->linkcount == sv_worldlinkcount && tc->framenum == sv.framenum && !memcmp (&tc->key, &key, sizeof(key)))
+	{
+		c_tracecache_hits++;
+		return tc->trace;
+	}
+
+	tc->trace = SV_TraceUncached (start, mins, maxs, end, passedict, contentmask);
+	tc->key = key;
+	tc->linkcount = sv_worldlinkcount;
+	tc->framenum = sv.framenum;
+	tc->valid = true;
+	return tc->trace;
+}
+
+//===========================================================================
+
+/*
+=============
+SV_PointContentsUncached
+=============
+*/
+static int SV_PointContentsUncached (vec3_t p)
 {
 	gentity_t		*touch[MAX_GENTITIES], *hit;
 	int			i, num;
@@ -681,7 +1235,7 @@ int SV_PointContents (vec3_t p)
 		if (hit->v.solid != SOLID_BSP)
 			angles = vec3_origin;	// boxes don't rotate
 
-		c2 = CM_TransformedPointContents (p, headnode, hit->v.origin, hit->v.angles);
+		c2 = CM_TransformedPointContents (p, headnode, hit->v.origin, angles);
 
 		contents |= c2;
 	}
@@ -847,23 +1401,13 @@ boxmaxs[0] = boxmaxs[1] = boxmaxs[2] = 9999;
 
 /*
 ==================
-SV_Trace
-
-Moves the given mins/maxs volume through the world from start to end.
-
-Passedict and edicts owned by passedict are explicitly not checked.
-
+SV_TraceUncached
 ==================
 */
-trace_t SV_Trace (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, gentity_t *passedict, int contentmask)
+static trace_t SV_TraceUncached (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, gentity_t *passedict, int contentmask)
 {
 	moveclip_t	clip;
 
-	if (!mins)
-		mins = vec3_origin;
-	if (!maxs)
-		maxs = vec3_origin;
-
 	memset ( &clip, 0, sizeof ( moveclip_t ) );
 
 	// clip to world
@@ -896,3 +1440,243 @@ trace_t SV_Trace (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, gentity_t
 	return clip.trace;
 }
 
+
+/*
+===============================================================================
+
+BATCHED TRACES
+
+Many traces with the same size, mask and passedict. Entities that may be hit
+are gathered once for the bounds of all moves, the traces themselves are 
+spread over worker threads when sv_threads is set. Nothing is changed while
+the jobs run, so every job only needs its own collision context.
+
+===============================================================================
+*/
+
+#define	TRACEBATCH_CHUNK	16		// traces per job
+#define	TRACEBATCH_JOBS		16
+
+typedef struct
+{
+	gentity_t	*ent;
+	vec3_t		absmin, absmax;
+	int			headnode;		// -1 for boxes, made in the job's context
+	float		*angles;
+} tracecand_t;
+
+typedef struct
+{
+	cmcontext_t	*ctx;
+	int			first, count;
+} tracejob_t;
+
+static struct
+{
+	vec3_t		*starts, *ends;
+	float		*mins, *maxs;
+	gentity_t	*passedict;
+	int			contentmask;
+	trace_t		*results;
+
+	tracecand_t	cands[MAX_GENTITIES];
+	int			numcands;
+} sv_tracebatch;
+
+static cmcontext_t	*sv_tracectx;		// [TRACEBATCH_JOBS]
+
+/*
+==================
+SV_GatherTraceCandidates
+
+Everything SV_ClipMoveToEntities would skip regardless of the move is left out
+==================
+*/
+static void SV_GatherTraceCandidates (vec3_t boxmins, vec3_t boxmaxs)
+{
+	gentity_t	*touchlist[MAX_GENTITIES], *touch;
+	gentity_t	*passedict = sv_tracebatch.passedict;
+	tracecand_t	*cand;
+	int			i, num;
+
+	sv_tracebatch.numcands = 0;
+
+	num = SV_AreaEdicts (boxmins, boxmaxs, touchlist, MAX_GENTITIES, AREA_SOLID);
+	for (i = 0; i < num; i++)
+	{
+		touch = touchlist[i];
+		if (touch->v.solid == SOLID_NOT)
+			continue;
+
+		if (touch == passedict)
+			continue;
+
+		if (passedict)
+		{
+		 	if (PROG_TO_GENT(touch->v.owner) == passedict)
+				continue;	// don't clip against own missiles
+			if (PROG_TO_GENT(passedict->v.owner) == touch)
+				continue;	// don't clip against owner
+		}
+
+		if ( !(sv_tracebatch.contentmask & CONTENTS_DEADMONSTER)
+		&& ((int)touch->v.svflags & SVF_DEADMONSTER) )
+				continue;
+
+		cand = &sv_tracebatch.cands[sv_tracebatch.numcands++];
+		cand->ent = touch;
+		VectorCopy (touch->v.absmin, cand->absmin);
+		VectorCopy (touch->v.absmax, cand->absmax);
+		if (touch->v.solid == SOLID_BSP)
+		{
+			cand->headnode = SV_HullForEntity (touch);
+			cand->angles = touch->v.angles;
+		}
+		else
+		{	// boxes don't rotate
+			cand->headnode = -1;
+			cand->angles = vec3_origin;
+		}
+	}
+}
+
+/*
+==================
+SV_TraceBatchJob
+
+Same as SV_Trace against the gathered candidates, may run on a worker thread
+==================
+*/
+static void SV_TraceBatchJob (void *data)
+{
+	tracejob_t	*job = data;
+	cmcontext_t	*ctx = job->ctx;
+	tracecand_t	*cand;
+	trace_t		*tr, trace;
+	vec3_t		boxmins, boxmaxs;
+	float		*start, *end;
+	int			i, j, headnode;
+
+	for (i = job->first; i < job->first + job->count; i++)
+	{
+		start = sv_tracebatch.starts[i];
+		end = sv_tracebatch.ends[i];
+		tr = &sv_tracebatch.results[i];
+
+		// clip to world
+		*tr = CM_BoxTraceCtx (ctx, start, end, sv_tracebatch.mins, sv_tracebatch.maxs, 0, sv_tracebatch.contentmask);
+		tr->ent = sv.edicts;
+
+		if (tr->fraction != 0)
+		{	// clip to other solid entities
+			SV_TraceBounds (start, sv_tracebatch.mins, sv_tracebatch.maxs, end, boxmins, boxmaxs);
+
+			for (j = 0, cand = sv_tracebatch.cands; j < sv_tracebatch.numcands; j++, cand++)
+			{
+				if (cand->absmin[0] > boxmaxs[0] || cand->absmin[1] > boxmaxs[1] || cand->absmin[2] > boxmaxs[2]
+					|| cand->absmax[0] < boxmins[0] || cand->absmax[1] < boxmins[1] || cand->absmax[2] < boxmins[2])
+					continue;
+
+				if (tr->allsolid)
+					break;
+
+				headnode = cand->headnode;
+				if (headnode == -1)
+					headnode = CM_HeadnodeForBoxCtx (ctx, cand->ent->v.mins, cand->ent->v.maxs);
+
+				trace = CM_TransformedBoxTraceCtx (ctx, start, end, sv_tracebatch.mins, sv_tracebatch.maxs, 
+					headnode, sv_tracebatch.contentmask, cand->ent->v.origin, cand->angles);
+
+				if (trace.allsolid || trace.startsolid || trace.fraction < tr->fraction)
+				{
+					trace.ent = cand->ent;
+					if (tr->startsolid)
+					{
+						*tr = trace;
+						tr->startsolid = true;
+					}
+					else
+						*tr = trace;
+				}
+				else if (trace.startsolid)
+					tr->startsolid = true;
+			}
+		}
+
+		tr->entitynum = tr->ent ? NUM_FOR_EDICT(tr->ent) : ENTITYNUM_NULL;
+	}
+}
+
+/*
+==================
+SV_TraceBatch
+
+Runs SV_Trace for count start/end pairs which share mins, maxs, passedict
+and contentmask, filling in results[count].
+==================
+*/
+void SV_TraceBatch (int count, vec3_t *starts, vec3_t *ends, vec3_t mins, vec3_t maxs, gentity_t *passedict, int contentmask, trace_t *results)
+{
+	tracejob_t	jobs[TRACEBATCH_JOBS];
+	void		*jobptrs[TRACEBATCH_JOBS];
+	vec3_t		boxmins, boxmaxs, mins1, maxs1;
+	int			i, j, numjobs, chunk;
+
+	if (count <= 0)
+		return;
+
+	if (!mins)
+		mins = vec3_origin;
+	if (!maxs)
+		maxs = vec3_origin;
+
+	if (!sv_tracectx)
+		sv_tracectx = Z_Malloc (sizeof(cmcontext_t) * TRACEBATCH_JOBS);
+
+	sv_tracebatch.starts = starts;
+	sv_tracebatch.ends = ends;
+	sv_tracebatch.mins = mins;
+	sv_tracebatch.maxs = maxs;
+	sv_tracebatch.passedict = passedict;
+	sv_tracebatch.contentmask = contentmask;
+	sv_tracebatch.results = results;
+
+	// one entity query for the bounds of all moves
+	SV_TraceBounds (starts[0], mins, maxs, ends[0], boxmins, boxmaxs);
+	for (i = 1; i < count; i++)
+	{
+		SV_TraceBounds (starts[i], mins, maxs, ends[i], mins1, maxs1);
+		for (j = 0; j < 3; j++)
+		{
+			if (mins1[j] < boxmins[j])
+				boxmins[j] = mins1[j];
+			if (maxs1[j] > boxmaxs[j])
+				boxmaxs[j] = maxs1[j];
+		}
+	}
+	SV_GatherTraceCandidates (boxmins, boxmaxs);
+
+	// split in jobs
+	if (sv_threads->value && count > TRACEBATCH_CHUNK)
+	{
+		numjobs = (count + TRACEBATCH_CHUNK - 1) / TRACEBATCH_CHUNK;
+		if (numjobs > TRACEBATCH_JOBS)
+			numjobs = TRACEBATCH_JOBS;
+	}
+	else
+		numjobs = 1;
+
+	chunk = (count + numjobs - 1) / numjobs;
+	for (i = 0; i < numjobs; i++)
+	{
+		jobs[i].ctx = &sv_tracectx[i];
+		jobs[i].first = i * chunk;
+		jobs[i].count = (i == numjobs - 1) ? count - i * chunk : chunk;
+		jobptrs[i] = &jobs[i];
+	}
+
+	if (numjobs > 1)
+		Sys_RunJobs (SV_TraceBatchJob, jobptrs, numjobs);
+	else
+		SV_TraceBatchJob (&jobs[0]);
+}
@@ -20,6 +20,127 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 // sv_write.c (was sv_ents.c)
 #include "server.h"
 
+/*
+Client frames are built in two steps, everything that touches collision model 
+state (which isn't thread safe) or may raise an error is done by SV_SetupClientFrame
+on the main thread, the entity culling and delta encoding is done by SV_ClientFrameJob
+and may run on worker threads. Each job only writes to its own client and its own slice 
+of svs.client_entities, all the other data is read only at that point. Jobs can't
+Com_Error or Com_Printf, problems are kept in the job and reported afterwards.
+The new frame is built in the job and only stored in the slice once it is encoded,
+so it can't overwrite the frame it is delta'd from.
+*/
+#define	HEADNODE_CACHE	64
+
+#define	SOUND_FULLVOLUME	80		// these match the client's mixer
+#define	SOUND_LOOPATTENUATE	0.003
+#define	EFFECT_CULL_DIST	400		// modelless entities with only effects
+
+#define	FRAME_HEADER_SIZE	11		// svc_frame, frame numbers, suppress count and areabytes
+#define	MIN_ENTITY_BUDGET	128
+#define	PRIORITY_NONPLAYER	65536.0f	// players always go before everything else
+
+// an entity change when the frame doesn't fit in the packet
+typedef struct
+{
+	int				number;
+	int				size;			// bytes the change takes
+	float			priority;		// lower goes first
+	qboolean		required;		// removals, events and the client's own entity
+	qboolean		deferred;
+} sv_packent_t;
+
+typedef struct
+{
+	client_t		*client;
+	client_frame_t	*oldframe;				// what we are delta'ing from, NULL for full update
+	int				lastframe;
+
+	vec3_t			org;
+	int				clientarea;
+	byte			fatpvs[65536/8];		// 32767 is MAX_MAP_LEAFS
+	byte			phs[65536/8];
+
+	qboolean		visvalid;				// fatpvs and phs below belong to this map
+	int				visspawncount;
+	int				fatclusters[64];		// clusters around the view that fatpvs was built from
+	int				numfatclusters;
+	int				phscluster;
+
+	unsigned int	visible[MAX_GENTITIES / 32];	// potentially visible entities
+	unsigned int	audible[MAX_GENTITIES / 32];	// looping sounds in the phs
+
+	int				hncache_node[HEADNODE_CACHE];	// CM_HeadnodeVisible results
+	byte			hncache_visible[HEADNODE_CACHE];
+	byte			hncache_valid[HEADNODE_CACHE];
+
+	sizebuf_t		playerstate;			// delta encoded player_state_t
+	byte			playerstate_buf[MAX_MSGLEN];
+
+	sizebuf_t		entities;				// delta encoded SVC_PACKET_ENTITIES
+	byte			entities_buf[MAX_MSGLEN];
+	int				badrender;				// entity with out of range render values, 0 for none
+
+	entity_state_t	frameents[MAX_GENTITIES];	// entities of the new frame until SV_StoreFrameEntities
+	int				synced[MAX_GENTITIES];		// last frame the client got the current state of each entity
+	sv_packent_t	packents[MAX_GENTITIES+1];	// changes in entity number order, ends with number -1
+	sv_packent_t	*packorder[MAX_GENTITIES];	// same, sorted by priority
+} sv_framejob_t;
+
+static sv_framejob_t	*sv_framejobs;		// [sv_maxclients]
+static int				sv_numframejobs;
+
+// what a frame job produced, sv_threads_verify compares the serial and threaded build
+typedef struct
+{
+	int				synced[MAX_GENTITIES];		// job state before the frame was built
+	byte			playerstate[MAX_MSGLEN];
+	int				playerstatesize;
+	byte			entities[MAX_MSGLEN];
+	int				entitiessize;
+	qboolean		overflowed;
+	int				num_entities;
+	unsigned		stateschecksum;				// entity states of the new frame
+	unsigned		syncedchecksum;				// job state after the frame was built
+} sv_frameoutput_t;
+
+/*
+Index from PVS cluster to entities touching it, rebuilt once per frame, so clients
+only look at entities in the clusters they can see instead of checking them all.
+Beams (PHS checked) and entities linked by headnode are kept in a separate list,
+entities with looping sounds are also listed so they can be checked against the PHS.
+*/
+typedef struct
+{
+	int		numclusters;
+	int		*first;									// [numclusters + 1] start of each cluster in ents
+	int		ents[MAX_GENTITIES * MAX_ENT_CLUSTERS];	// entity numbers grouped by cluster
+	int		clustered[MAX_GENTITIES];				// entities which go to the cluster lists
+	int		numclustered;
+	int		special[MAX_GENTITIES];
+	int		numspecial;
+	int		sounds[MAX_GENTITIES];
+	int		numsounds;
+} sv_clusterindex_t;
+
+static sv_clusterindex_t	sv_clusterindex;
+
+/*
+=============
+SV_ClientEntity
+
+Every client owns UPDATE_BACKUP*64 entity states in the svs.client_entities ring,
+so frames of different clients can be built at the same time
+=============
+*/
+entity_state_t *SV_ClientEntity (client_t *client, int index)
+{
+	int		slice;
+
+	slice = svs.num_client_entities / sv_maxclients->value;
+	return &svs.client_entities[(client - svs.clients) * slice + ((unsigned int)index % slice)];
+}
+
 /*
 =============================================================================
 
@@ -28,28 +149,120 @@ Encode a client frame onto the network channel
 =============================================================================
 */
 
+typedef enum
+{
+	PACK_ALL,			// write every change
+	PACK_MEASURE,		// only fill in job->packents
+	PACK_SELECTED		// write what wasn't deferred, fix up the frame for the rest
+} packmode_t;
+
 /*
 =============
-SV_EmitPacketEntities
+SV_MarkSynced
+=============
+*/
+static void SV_MarkSynced (sv_framejob_t *job, int num)
+{
+	job->synced[num] = sv.framenum;
+}
 
-Writes a delta update of an entity_state_t list to the message.
+/*
+=============
+SV_SyncAge
+
+Frames since the client last got the current state of an entity
+=============
+*/
+static int SV_SyncAge (sv_framejob_t *job, int num)
+{
+	int		age;
+
+	age = sv.framenum - job->synced[num];
+	return age > 1 ? age : 1;
+}
+
+/*
+=============
+SV_WritePacketEntity
+
+Writes one entity change, oldent is NULL for new entities and newent for removed ones
 =============
 */
-void SV_EmitPacketEntities (client_frame_t *from, client_frame_t *to, sizebuf_t *msg)
+static void SV_WritePacketEntity (sv_framejob_t *job, entity_state_t *oldent, entity_state_t *newent, int oldnum, sizebuf_t *msg)
+{
+	if (newent && MSG_ClampEntityRender (oldent ? oldent : &sv.baselines[newent->number], newent))
+		job->badrender = newent->number;	// so MSG_WriteDeltaEntity won't print
+
+	if (oldent && newent)
+	{	// delta update from old position
+		// because the force parm is false, this will not result
+		// in any bytes being emited if the entity has not changed at all
+		// note that players are always 'newentities', this updates their oldorigin always
+		// and prevents warping
+		MSG_WriteDeltaEntity (oldent, newent, msg, false, newent->number <= sv_maxclients->value);
+		return;
+	}
+
+	if (newent)
+	{	// this is a new entity, send it from the baseline
+		MSG_WriteDeltaEntity (&sv.baselines[newent->number], newent, msg, true, true);
+		return;
+	}
+
+	// the old entity isn't present in the new message
+	MSG_WriteEntityBits (msg, U_REMOVE, oldnum);
+}
+
+/*
+=============
+SV_PacketEntityPriority
+=============
+*/
+static float SV_PacketEntityPriority (sv_framejob_t *job, entity_state_t *state)
+{
+	vec3_t	delta;
+	float	priority;
+
+	VectorSubtract (state->origin, job->org, delta);
+	priority = VectorLength (delta) / SV_SyncAge (job, state->number);
+
+	if (state->number > sv_maxclients->value)
+		priority += PRIORITY_NONPLAYER;
+	return priority;
+}
+
+/*
+=============
+SV_PacketEntitiesPass
+
+Walks both frames in entity number order. Every change is written to a small
+buffer first, PACK_ALL gives up with -1 as soon as a change doesn't fit in msg.
+PACK_MEASURE returns the number of changes in job->packents.
+=============
+*/
+static int SV_PacketEntitiesPass (sv_framejob_t *job, client_frame_t *from, client_frame_t *to, sizebuf_t *msg, packmode_t mode)
 {
 	entity_state_t	*oldent = NULL, *newent = NULL;
+	entity_state_t	*writeold, *writenew;
 	int		oldindex, newindex;
 	int		oldnum, newnum;
 	int		from_num_entities;
-	int		bits;
-
-	MSG_WriteByte (msg, SVC_PACKET_ENTITIES);
+	int		clentnum;
+	int		numpackents, outindex;
+	sv_packent_t	*pe;
+	sizebuf_t	change;
+	byte		change_buf[MAX_MSGLEN];
 
 	if (!from)
 		from_num_entities = 0;
 	else
 		from_num_entities = from->num_entities;
 
+	clentnum = NUM_FOR_EDICT(job->client->edict);
+	numpackents = 0;
+	outindex = 0;
+	pe = job->packents;
+
 	newindex = 0;
 	oldindex = 0;
 	while (newindex < to->num_entities || oldindex < from_num_entities)
@@ -58,7 +271,7 @@ void SV_EmitPacketEntities (client_frame_t *from, client_frame_t *to, sizebuf_t
 			newnum = 9999;
 		else
 		{
-			newent = &svs.client_entities[(to->first_entity+newindex)%svs.num_client_entities];
+			newent = &job->frameents[newindex];
 			newnum = newent->number;
 		}
 
@@ -66,50 +279,153 @@ void SV_EmitPacketEntities (client_frame_t *from, client_frame_t *to, sizebuf_t
 			oldnum = 9999;
 		else
 		{
-			oldent = &svs.client_entities[(from->first_entity+oldindex)%svs.num_client_entities];
+			oldent = SV_ClientEntity (job->client, from->first_entity+oldindex);
 			oldnum = oldent->number;
 		}
 
-		if (newnum == oldnum)
-		{	// delta update from old position
-			// because the force parm is false, this will not result
-			// in any bytes being emited if the entity has not changed at all
-			// note that players are always 'newentities', this updates their oldorigin always
-			// and prevents warping
-			MSG_WriteDeltaEntity (oldent, newent, msg, false, newent->number <= sv_maxclients->value);
-			oldindex++;
-			newindex++;
+		writeold = newnum == oldnum ? oldent : NULL;	// NULL for new entities
+		writenew = newnum <= oldnum ? newent : NULL;	// NULL for removals
+
+		if (mode == PACK_SELECTED && writenew && pe->number == newnum && pe++->deferred)
+		{
+			if (writeold)
+			{	// the client keeps the old state
+				job->frameents[outindex] = *oldent;
+				outindex++;
+				oldindex++;
+			}
+			newindex++;		// new entities just don't show up until there's room
 			continue;
 		}
 
-		if (newnum < oldnum)
-		{	// this is a new entity, send it from the baseline
-			MSG_WriteDeltaEntity (&sv.baselines[newnum], newent, msg, true, true);
+		SZ_Init (&change, change_buf, sizeof(change_buf));
+		SV_WritePacketEntity (job, writeold, writenew, oldnum, &change);
+
+		if (mode == PACK_MEASURE)
+		{
+			if (change.cursize)
+			{	// unchanged entities cost nothing and are left out
+				pe = &job->packents[numpackents++];
+				pe->number = writenew ? newnum : oldnum;
+				pe->size = change.cursize;
+				pe->required = !writenew || newnum == clentnum || newent->event != 0;	// events are cleared every frame
+				pe->priority = writenew ? SV_PacketEntityPriority (job, newent) : 0;
+				pe->deferred = false;
+			}
+		}
+		else
+		{
+			if (msg->cursize + change.cursize + 2 > msg->maxsize)
+			{	// leave room for the terminator
+				if (mode == PACK_ALL)
+					return -1;
+				msg->overflowed = true;		// not with SZ_GetSpace, it prints
+			}
+			if (!msg->overflowed)
+				SZ_Write (msg, change.data, change.cursize);
+
+			if (mode == PACK_SELECTED)
+			{
+				if (writenew)
+				{
+					job->frameents[outindex] = *newent;
+					SV_MarkSynced (job, newnum);
+				}
+				else if (pe->number == oldnum)
+					pe++;
+			}
+		}
+
+		if (writenew)
+		{
+			outindex++;
 			newindex++;
-			continue;
 		}
+		if (writeold || !writenew)
+			oldindex++;
+	}
 
-		if (newnum > oldnum)
-		{	// the old entity isn't present in the new message
-			bits = U_REMOVE;
-			if (oldnum >= 256)
-				bits |= U_NUMBER_16 | U_MOREBITS1;
+	if (mode == PACK_SELECTED)
+		to->num_entities = outindex;
+	return numpackents;
+}
 
-			MSG_WriteByte (msg,	bits&255 );
-			if (bits & 0x0000ff00)
-				MSG_WriteByte (msg,	(bits>>8)&255 );
+/*
+=============
+SV_ComparePackEnts
+=============
+*/
+static int SV_ComparePackEnts (const void *a, const void *b)
+{
+	const sv_packent_t	*pa = *(const sv_packent_t **)a;
+	const sv_packent_t	*pb = *(const sv_packent_t **)b;
+
+	if (pa->priority < pb->priority)
+		return -1;
+	if (pa->priority > pb->priority)
+		return 1;
+	return pa->number - pb->number;
+}
 
-			if (bits & U_NUMBER_16)
-				MSG_WriteShort (msg, oldnum);
-			else
-				MSG_WriteByte (msg, oldnum);
+/*
+=============
+SV_EmitPacketEntities
 
-			oldindex++;
+Writes a delta update of an entity_state_t list to the message.
+
+When the changes don't fit in msg->maxsize they are taken by priority, the client's
+own entity, removals and entities with an event always, then players and then
+everything else by distance, favoring entities that were held back for a few
+frames. Whatever doesn't fit is left out of the frame as the client still has it,
+so it gets delta'd again from there next frame.
+=============
+*/
+void SV_EmitPacketEntities (sv_framejob_t *job, client_frame_t *from, client_frame_t *to, sizebuf_t *msg)
+{
+	int		i, count, budget;
+	sv_packent_t	*pe;
+
+	MSG_WriteByte (msg, SVC_PACKET_ENTITIES);
+	if (SV_PacketEntitiesPass (job, from, to, msg, PACK_ALL) != -1)
+	{
+		MSG_WriteEntityBits (msg, 0, 0);	// end of packetentities
+		for (i = 0; i < to->num_entities; i++)
+			SV_MarkSynced (job, job->frameents[i].number);
+		return;
+	}
+
+	// start over and pick what fits
+	SZ_Clear (msg);
+
+	count = SV_PacketEntitiesPass (job, from, to, msg, PACK_MEASURE);
+	job->packents[count].number = -1;
+
+	budget = msg->maxsize - 3;	// svc byte and terminator
+	for (i = 0; i < count; i++)
+	{
+		pe = &job->packents[i];
+		if (pe->required)
+			budget -= pe->size;
+		job->packorder[i] = pe;
+	}
+
+	qsort (job->packorder, count, sizeof(job->packorder[0]), SV_ComparePackEnts);
+
+	for (i = 0; i < count; i++)
+	{
+		pe = job->packorder[i];
+		if (pe->required)
 			continue;
-		}
+		if (pe->size <= budget)
+			budget -= pe->size;
+		else
+			pe->deferred = true;
 	}
 
-	MSG_WriteShort (msg, 0);	// end of packetentities
+	MSG_WriteByte (msg, SVC_PACKET_ENTITIES);
+	SV_PacketEntitiesPass (job, from, to, msg, PACK_SELECTED);
+	if (!msg->overflowed)
+		MSG_WriteEntityBits (msg, 0, 0);	// end of packetentities
 }
 
 
@@ -360,37 +676,21 @@ void SV_WritePlayerstateToClient (client_frame_t *from, client_frame_t *to, size
 /*
 ==================
 SV_WriteFrameToClient
+
+Frame must be built with SV_BuildClientFrames first
 ==================
 */
 void SV_WriteFrameToClient (client_t *client, sizebuf_t *msg)
 {
-	client_frame_t		*frame, *oldframe;
-	int					lastframe;
+	sv_framejob_t		*job;
+	client_frame_t		*frame;
 
-//Com_Printf ("%i -> %i\n", client->lastframe, sv.framenum);
-	// this is the frame we are creating
+	job = &sv_framejobs[client - svs.clients];
 	frame = &client->frames[sv.framenum & UPDATE_MASK];
 
-	if (client->lastframe <= 0)
-	{	// client is asking for a retransmit
-		oldframe = NULL;
-		lastframe = -1;
-	}
-	else if (sv.framenum - client->lastframe >= (UPDATE_BACKUP - 3) )
-	{	// client hasn't gotten a good message through in a long time
-//		Com_Printf ("%s: Delta request from out-of-date packet.\n", client->name);
-		oldframe = NULL;
-		lastframe = -1;
-	}
-	else
-	{	// we have a valid message to delta from
-		oldframe = &client->frames[client->lastframe & UPDATE_MASK];
-		lastframe = client->lastframe;
-	}
-
 	MSG_WriteByte (msg, SVC_FRAME);
 	MSG_WriteLong (msg, sv.framenum);
-	MSG_WriteLong (msg, lastframe);	// what we are delta'ing from
+	MSG_WriteLong (msg, job->lastframe);	// what we are delta'ing from
 	MSG_WriteByte (msg, client->surpressCount);	// rate dropped packets
 	client->surpressCount = 0;
 
@@ -398,11 +698,15 @@ void SV_WriteFrameToClient (client_t *client, sizebuf_t *msg)
 	MSG_WriteByte (msg, frame->areabytes);
 	SZ_Write (msg, frame->areabits, frame->areabytes);
 
-	// delta encode the playerstate
-	SV_WritePlayerstateToClient (oldframe, frame, msg);
+	// playerstate and entities were delta encoded by the frame job
+	SZ_Write (msg, job->playerstate.data, job->playerstate.cursize);
 
-	// delta encode the entities
-	SV_EmitPacketEntities (oldframe, frame, msg);
+	if (job->entities.overflowed)
+	{	// even the removals didn't fit
+		msg->overflowed = true;
+		return;
+	}
+	SZ_Write (msg, job->entities.data, job->entities.cursize);
 }
 
 
@@ -414,80 +718,84 @@ Build a client frame structure
 =============================================================================
 */
 
-byte		fatpvs[65536/8];	// 32767 is MAX_MAP_LEAFS
-
 /*
 ============
 SV_FatPVS
 
-The client will interpolate the view position, so we can't use a single PVS point
+The client will interpolate the view position, so we can't use a single PVS point.
+The row is kept in the job and only rebuilt when the clusters around the view change.
 ===========
 */
-void SV_FatPVS (vec3_t org)
+static void SV_FatPVS (sv_framejob_t *job)
 {
-	int		leafs[64];
-	int		i, j, count;
-	int		longs;
-	byte	*src;
+	int		leafs[64], clusters[64];
+	int		i, j, count, numclusters;
+	int		ints;
+	int		*src, *dst;
 	vec3_t	mins, maxs;
 
 	for (i=0 ; i<3 ; i++)
 	{
-		mins[i] = org[i] - 8;
-		maxs[i] = org[i] + 8;
+		mins[i] = job->org[i] - 8;
+		maxs[i] = job->org[i] + 8;
 	}
 
 	count = CM_BoxLeafnums (mins, maxs, leafs, 64, NULL);
 	if (count < 1)
+	{
 		Com_Error (ERR_FATAL, "SV_FatPVS: count < 1");
-	longs = (CM_NumClusters()+31)>>5;
+		return;
+	}
 
-	// convert leafs to clusters
+	// convert leafs to clusters, skipping the ones we already have
+	numclusters = 0;
 	for (i=0 ; i<count ; i++)
+	{
 		leafs[i] = CM_LeafCluster(leafs[i]);
+		for (j=0 ; j<numclusters ; j++)
+			if (clusters[j] == leafs[i])
+				break;
+		if (j == numclusters)
+			clusters[numclusters++] = leafs[i];
+	}
+
+	if (numclusters == job->numfatclusters && !memcmp (clusters, job->fatclusters, numclusters * sizeof(int)))
+		return;		// same view clusters as last frame
 
-	memcpy (fatpvs, CM_ClusterPVS(leafs[0]), longs<<2);
+	job->numfatclusters = numclusters;
+	memcpy (job->fatclusters, clusters, numclusters * sizeof(int));
+
+	ints = (CM_NumClusters()+31)>>5;
+	dst = (int *)job->fatpvs;
+	memcpy (dst, CM_ClusterPVS(clusters[0]), ints<<2);
 	// or in all the other leaf bits
-	for (i=1 ; i<count ; i++)
+	for (i=1 ; i<numclusters ; i++)
 	{
-		for (j=0 ; j<i ; j++)
-			if (leafs[i] == leafs[j])
-				break;
-		if (j != i)
-			continue;		// already have the cluster we want
-		src = CM_ClusterPVS(leafs[i]);
-		for (j=0 ; j<longs ; j++)
-			((long *)fatpvs)[j] |= ((long *)src)[j];
+		src = (int *)CM_ClusterPVS(clusters[i]);
+		for (j=0 ; j<ints ; j++)
+			dst[j] |= src[j];
 	}
 }
 
 
 /*
 =============
-SV_BuildClientFrame
+SV_SetupClientFrame
 
-Decides which entities are going to be visible to the client, and
-copies off the playerstat and areabits.
+Copies off the playerstate and areabits, finds what the client can see and 
+what to delta from, encodes the playerstate. Must be called on the main thread.
 =============
 */
-void SV_BuildClientFrame (client_t *client)
+static void SV_SetupClientFrame (sv_framejob_t *job)
 {
-	int		e, i;
-	vec3_t	org;
-	gentity_t	*ent;
-	gentity_t	*clent;
+	client_t		*client;
+	gentity_t		*clent;
 	client_frame_t	*frame;
-	entity_state_t	*state;
-	int		l;
-	int		clientarea, clientcluster;
-	int		leafnum;
-	int		c_fullsend;
-	byte	*clientphs;
-	byte	*bitvector;
+	int				i, leafnum, clientcluster;
+	int				slice;
 
+	client = job->client;
 	clent = client->edict;
-	if (!clent->client)
-		return;		// not in game yet
 
 	// this is the frame we are creating
 	frame = &client->frames[sv.framenum & UPDATE_MASK];
@@ -497,122 +805,628 @@ void SV_BuildClientFrame (client_t *client)
 	// find the client's PVS
 #if PROTOCOL_FLOAT_COORDS == 1
 	for (i = 0; i < 3; i++)
-		org[i] = clent->client->ps.pmove.origin[i] + clent->client->ps.viewoffset[i];
+		job->org[i] = clent->client->ps.pmove.origin[i] + clent->client->ps.viewoffset[i];
 #else
 	for (i = 0; i < 3; i++)
-		org[i] = clent->client->ps.pmove.origin[i] * 0.125 + clent->client->ps.viewoffset[i];
+		job->org[i] = clent->client->ps.pmove.origin[i] * 0.125 + clent->client->ps.viewoffset[i];
 #endif
 
-	leafnum = CM_PointLeafnum (org);
-	clientarea = CM_LeafArea (leafnum);
+	leafnum = CM_PointLeafnum (job->org);
+	job->clientarea = CM_LeafArea (leafnum);
 	clientcluster = CM_LeafCluster (leafnum);
 
 	// calculate the visible areas
-	frame->areabytes = CM_WriteAreaBits (frame->areabits, clientarea);
+	frame->areabytes = CM_WriteAreaBits (frame->areabits, job->clientarea);
 
 	// grab the current player_state_t
 	frame->ps = clent->client->ps;
 
+	// fatpvs and phs are kept from the last frame while the view clusters stay the same
+	if (!job->visvalid || job->visspawncount != svs.spawncount)
+	{
+		job->visvalid = true;
+		job->visspawncount = svs.spawncount;
+		job->numfatclusters = 0;
+		job->phscluster = -2;
+		memset (job->synced, 0, sizeof(job->synced));
+	}
 
-	SV_FatPVS (org);
-	clientphs = CM_ClusterPHS (clientcluster);
+	SV_FatPVS (job);
+	if (clientcluster != job->phscluster)
+	{
+		memcpy (job->phs, CM_ClusterPHS (clientcluster), (CM_NumClusters() + 7) >> 3);
+		job->phscluster = clientcluster;
+	}
 
-	// build up the list of visible entities
 	frame->num_entities = 0;
-	frame->first_entity = svs.next_client_entities;
+	frame->first_entity = client->next_client_entity;
+
+	// find what to delta from
+	slice = svs.num_client_entities / sv_maxclients->value;
+	if (client->lastframe <= 0)
+	{	// client is asking for a retransmit
+		job->oldframe = NULL;
+		job->lastframe = -1;
+	}
+	else if (sv.framenum - client->lastframe >= (UPDATE_BACKUP - 3) )
+	{	// client hasn't gotten a good message through in a long time
+//		Com_Printf ("%s: Delta request from out-of-date packet.\n", client->name);
+		job->oldframe = NULL;
+		job->lastframe = -1;
+	}
+	else if (client->next_client_entity - client->frames[client->lastframe & UPDATE_MASK].first_entity > slice)
+	{	// entities of the old frame were already overwritten by newer frames
+		job->oldframe = NULL;
+		job->lastframe = -1;
+	}
+	else
+	{	// we have a valid message to delta from
+		job->oldframe = &client->frames[client->lastframe & UPDATE_MASK];
+		job->lastframe = client->lastframe;
+	}
+
+	// may drop the server on bad values, so it isn't done by the job
+	SZ_Init (&job->playerstate, job->playerstate_buf, sizeof(job->playerstate_buf));
+	SV_WritePlayerstateToClient (job->oldframe, frame, &job->playerstate);
+}
 
-	c_fullsend = 0;
+/*
+=============
+SV_EntityIsSendable
+
+Checks that don't depend on the client
+=============
+*/
+static qboolean SV_EntityIsSendable (gentity_t *ent)
+{
+	// ignore free entities
+	if (!ent->inuse)
+		return false;
+
+	// ignore ents without visible models
+	if (((int)ent->v.svflags & SVF_NOCLIENT))
+		return false;
+
+	// ignore ents without visible models unless they have an effect
+	if (!ent->s.modelindex && !ent->s.effects && !ent->s.loopingSound && !ent->s.event)
+		return false;
+
+	return true;
+}
 
-	for (e = 1; e < sv.max_edicts; e++) //sv.num_edicts
+/*
+=============
+SV_BuildClusterIndex
+=============
+*/
+static void SV_BuildClusterIndex (void)
+{
+	sv_clusterindex_t	*idx = &sv_clusterindex;
+	gentity_t			*ent;
+	int					e, i, k;
+
+	if (idx->numclusters != CM_NumClusters() || !idx->first)
+	{
+		if (idx->first)
+			Z_Free (idx->first);
+		idx->numclusters = CM_NumClusters();
+		idx->first = Z_Malloc ((idx->numclusters + 1) * sizeof(int));
+	}
+
+	memset (idx->first, 0, (idx->numclusters + 1) * sizeof(int));
+	idx->numclustered = 0;
+	idx->numspecial = 0;
+	idx->numsounds = 0;
+
+	// count entities in each cluster
+	for (e = SV_NextActiveEntity(0); e != -1; e = SV_NextActiveEntity(e))
 	{
 		ent = EDICT_NUM(e);
+		if (!SV_EntityIsSendable (ent))
+			continue;
+
+		if (ent->s.loopingSound)
+			idx->sounds[idx->numsounds++] = e;
 
-		// ignore free entities
-		if (!ent->inuse)
+		if ((ent->s.renderFlags & RF_BEAM) || ent->num_clusters == -1)
+		{
+			idx->special[idx->numspecial++] = e;
 			continue;
+		}
+
+		for (i = 0; i < ent->num_clusters; i++)
+			idx->first[ent->clusternums[i]]++;
+		idx->clustered[idx->numclustered++] = e;
+	}
+
+	// turn counts into end offsets
+	for (i = 1; i <= idx->numclusters; i++)
+		idx->first[i] += idx->first[i - 1];
+
+	// fill backwards so entities stay sorted within the clusters, 
+	// this leaves first[] pointing at the start of each cluster
+	for (k = idx->numclustered - 1; k >= 0; k--)
+	{
+		e = idx->clustered[k];
+		ent = EDICT_NUM(e);
+
+		for (i = 0; i < ent->num_clusters; i++)
+			idx->ents[--idx->first[ent->clusternums[i]]] = e;
+	}
+}
+
+/*
+=============
+SV_HeadnodeVisible
+
+CM_HeadnodeVisible cached for the client's fat pvs
+=============
+*/
+static qboolean SV_HeadnodeVisible (sv_framejob_t *job, int headnode)
+{
+	int		i;
+
+	i = headnode & (HEADNODE_CACHE - 1);
+	if (!job->hncache_valid[i] || job->hncache_node[i] != headnode)
+	{
+		job->hncache_node[i] = headnode;
+		job->hncache_visible[i] = CM_HeadnodeVisible (headnode, job->fatpvs);
+		job->hncache_valid[i] = true;
+	}
+	return job->hncache_visible[i];
+}
+
+/*
+=============
+SV_AttenuationDistance
+
+Distance at which the client's mixer fades a sound out completely,
+0 if the sound is heard on the entire level
+=============
+*/
+static float SV_AttenuationDistance (float attenuation)
+{
+	if (attenuation <= ATTN_NONE)
+		return 0;
+
+	if (attenuation == ATTN_STATIC)
+		return SOUND_FULLVOLUME + 1.0f / (attenuation * 0.001f);
+	return SOUND_FULLVOLUME + 1.0f / (attenuation * 0.0005f);
+}
+
+/*
+=============
+SV_LoopSoundDistance
+=============
+*/
+static float SV_LoopSoundDistance (gentity_t *ent)
+{
+	float	dist, d;
+
+	// the client mixes all looping sounds with the same attenuation, 
+	// loopsound_att can only make them reach further than that
+	dist = SOUND_FULLVOLUME + 1.0f / SOUND_LOOPATTENUATE;
+	if (ent->v.loopsound_att > ATTN_NONE)
+	{
+		d = SV_AttenuationDistance (ent->v.loopsound_att);
+		if (d > dist)
+			dist = d;
+	}
+	return dist;
+}
+
+/*
+=============
+SV_EntityAudibleDistance
+
+How far away a modelless entity is still worth sending
+=============
+*/
+static float SV_EntityAudibleDistance (gentity_t *ent)
+{
+	float	dist, d;
+
+	dist = 0;
+	if (ent->s.loopingSound)
+		dist = SV_LoopSoundDistance (ent);
+
+	if (ent->s.event)
+	{	// entity events are played with ATTN_NORM at most
+		d = SV_AttenuationDistance (ATTN_NORM);
+		if (d > dist)
+			dist = d;
+	}
+
+	if (ent->s.effects && dist < EFFECT_CULL_DIST)
+		dist = EFFECT_CULL_DIST;
+
+	return dist;
+}
+
+/*
+=============
+SV_EntityInPHS
+=============
+*/
+static qboolean SV_EntityInPHS (sv_framejob_t *job, gentity_t *ent)
+{
+	int		i, l;
+
+	if (ent->num_clusters == -1)
+		return CM_HeadnodeVisible (ent->headnode, job->phs);
+
+	for (i = 0; i < ent->num_clusters; i++)
+	{
+		l = ent->clusternums[i];
+		if (job->phs[l >> 3] & (1 << (l & 7)))
+			return true;
+	}
+	return false;
+}
 
-		// ignore ents without visible models
-		if (((int)ent->v.svflags & SVF_NOCLIENT))
+/*
+=============
+SV_InRange
+=============
+*/
+static qboolean SV_InRange (sv_framejob_t *job, gentity_t *ent, float dist)
+{
+	vec3_t	delta;
+
+	VectorSubtract (job->org, ent->v.origin, delta);
+	return DotProduct (delta, delta) <= dist * dist;
+}
+
+/*
+=============
+SV_AddClientFrameEntities
+
+Decides which entities are going to be visible to the client
+=============
+*/
+static void SV_AddClientFrameEntities (sv_framejob_t *job)
+{
+	sv_clusterindex_t	*idx = &sv_clusterindex;
+	int		e, i, c, k;
+	int		clentnum;
+	gentity_t	*ent;
+	gentity_t	*clent;
+	client_frame_t	*frame;
+	entity_state_t	*state;
+	int		l;
+	unsigned int	bits;
+	qboolean	hearonly;
+
+	clent = job->client->edict;
+	clentnum = NUM_FOR_EDICT(clent);
+	frame = &job->client->frames[sv.framenum & UPDATE_MASK];
+
+	memset (job->visible, 0, sizeof(job->visible));
+	memset (job->audible, 0, sizeof(job->audible));
+	memset (job->hncache_valid, 0, sizeof(job->hncache_valid));
+
+	// gather entities from all clusters in the fat pvs
+	for (c = 0; c < idx->numclusters; c += 8)
+	{
+		bits = job->fatpvs[c >> 3];
+		for (i = c; bits; i++, bits >>= 1)
+		{
+			if (!(bits & 1) || i >= idx->numclusters)
+				continue;
+			for (k = idx->first[i]; k < idx->first[i + 1]; k++)
+				job->visible[idx->ents[k] >> 5] |= (1u << (idx->ents[k] & 31));
+		}
+	}
+
+	for (k = 0; k < idx->numspecial; k++)
+	{
+		e = idx->special[k];
+		ent = EDICT_NUM(e);
+
+		if (ent->s.renderFlags & RF_BEAM)
+		{	// beams just check one point for PHS
+			l = ent->clusternums[0];
+			if ( !(job->phs[l >> 3] & (1 << (l&7) )) )
+				continue;
+		}
+		else
+		{	// too many leafs for individual check, go by headnode
+			if (!SV_HeadnodeVisible (job, ent->headnode))
+				continue;
+		}
+		job->visible[e >> 5] |= (1u << (e & 31));
+	}
+
+	// client always sees itself
+	if (SV_EntityIsSendable (clent))
+		job->visible[clentnum >> 5] |= (1u << (clentnum & 31));
+
+	// looping sounds which can't be seen but may be heard
+	for (k = 0; k < idx->numsounds; k++)
+	{
+		e = idx->sounds[k];
+		if (job->visible[e >> 5] & (1u << (e & 31)))
 			continue;
+		if (SV_EntityInPHS (job, EDICT_NUM(e)))
+			job->audible[e >> 5] |= (1u << (e & 31));
+	}
 
-		// ignore ents without visible models unless they have an effect
-		if (!ent->s.modelindex && !ent->s.effects && !ent->s.loopingSound && !ent->s.event)
+	// build up the list of visible entities
+	frame->num_entities = 0;
+
+	for (c = 0; c < MAX_GENTITIES / 32; c++)
+	{
+		if (!(job->visible[c] | job->audible[c]))
 			continue;
 
-		// ignore if not touching a PV leaf
-		if (ent != clent)
+		for (e = c << 5, bits = job->visible[c] | job->audible[c]; bits; e++, bits >>= 1)
 		{
-			// check area
-			if (!CM_AreasConnected (clientarea, ent->areanum))
-			{	// doors can legally straddle two areas, so we may need to check another one
-				if (!ent->areanum2 || !CM_AreasConnected (clientarea, ent->areanum2))
-					continue;		// blocked by a door
-			}
+			if (!(bits & 1))
+				continue;
 
-			// beams just check one point for PHS
-			if (ent->s.renderFlags & RF_BEAM)
-			{
-				l = ent->clusternums[0];
-				if ( !(clientphs[l >> 3] & (1 << (l&7) )) )
-					continue;
-			}
-			else
+			ent = EDICT_NUM(e);
+			hearonly = (job->audible[c] & (1u << (e & 31))) != 0;
+
+			if (ent != clent)
 			{
-				// FIXME: if an ent has a model and a sound, but isn't
-				// in the PVS, only the PHS, clear the model
-				if (ent->s.loopingSound)
-				{
-					bitvector = fatpvs;	//clientphs;
+				// check area
+				if (!CM_AreasConnected (job->clientarea, ent->areanum))
+				{	// doors can legally straddle two areas, so we may need to check another one
+					if (!ent->areanum2 || !CM_AreasConnected (job->clientarea, ent->areanum2))
+						continue;		// blocked by a door
 				}
-				else
-					bitvector = fatpvs;
 
-				if (ent->num_clusters == -1)
-				{	// too many leafs for individual check, go by headnode
-					if (!CM_HeadnodeVisible (ent->headnode, bitvector))
+				// don't send sounds if they will be attenuated away
+				if (hearonly)
+				{	// only the looping sound is of interest
+					if (!SV_InRange (job, ent, SV_LoopSoundDistance (ent)))
 						continue;
-					c_fullsend++;
 				}
-				else
-				{	// check individual leafs
-					for (i=0 ; i < ent->num_clusters ; i++)
-					{
-						l = ent->clusternums[i];
-						if (bitvector[l >> 3] & (1 << (l&7) ))
-							break;
-					}
-					if (i == ent->num_clusters)
-						continue;		// not visible
-				}
-
-				if (!ent->s.modelindex)
-				{	// don't send sounds if they will be attenuated away
-					vec3_t	delta;
-					float	len;
-
-					VectorSubtract (org, ent->v.origin, delta);
-					len = VectorLength (delta);
-					if (len > 400)
+				else if (!(ent->s.renderFlags & RF_BEAM) && !ent->s.modelindex)
+				{
+					if (!SV_InRange (job, ent, SV_EntityAudibleDistance (ent)))
 						continue;
 				}
 			}
+
+			// add it to the new frame
+			state = &job->frameents[frame->num_entities];
+			if (hearonly)
+			{	// in the PHS but not in the PVS, so send just what's needed for the sound
+				memset (state, 0, sizeof(*state));
+				VectorCopy (ent->s.origin, state->origin);
+				VectorCopy (ent->s.old_origin, state->old_origin);
+				state->loopingSound = ent->s.loopingSound;
+				state->renderScale = ent->s.renderScale;	// zero would be out of range
+				VectorCopy (ent->s.renderColor, state->renderColor);
+				state->number = e;
+				frame->num_entities++;
+				continue;
+			}
+
+			*state = ent->s; //BRAXI FIXME
+			state->number = e;
+
+			// don't mark players missiles as solid
+			if (PROG_TO_GENT(ent->v.owner) == clent)
+				state->solid = 0;
+
+			frame->num_entities++;
 		}
+	}
+}
+
+/*
+=============
+SV_EntityBudget
+
+What is left of the packet for the entities once everything else is in
+=============
+*/
+static int SV_EntityBudget (sv_framejob_t *job, client_frame_t *frame)
+{
+	client_t	*client = job->client;
+	int			budget, reliable;
+
+	budget = MAX_MSGLEN - PACKET_HEADER - FRAME_HEADER_SIZE - frame->areabytes - job->playerstate.cursize;
+
+	if (!client->datagram.overflowed)
+		budget -= client->datagram.cursize;
+
+	// the reliable message goes in the same packet when it is (re)sent, unless
+	// it is so big that the netchan has to fragment it anyway
+	reliable = client->netchan.reliable_length ? client->netchan.reliable_length : client->netchan.message.cursize;
+	if (budget - reliable >= MIN_ENTITY_BUDGET)
+		budget -= reliable;
+
+	if (budget < MIN_ENTITY_BUDGET)
+		budget = MIN_ENTITY_BUDGET;
+	return budget;
+}
+
+/*
+=============
+SV_StoreFrameEntities
+
+Copies the encoded frame to the client's slice of client_entities array
+=============
+*/
+static void SV_StoreFrameEntities (sv_framejob_t *job, client_frame_t *frame)
+{
+	int		i;
+
+	for (i = 0; i < frame->num_entities; i++)
+		*SV_ClientEntity (job->client, frame->first_entity + i) = job->frameents[i];
+}
+
+/*
+=============
+SV_BuildFrameEntities
+
+Builds the entity list and delta encodes it, leaves client_entities alone
+=============
+*/
+static void SV_BuildFrameEntities (sv_framejob_t *job, client_frame_t *frame)
+{
+	SV_AddClientFrameEntities (job);
+
+	job->badrender = 0;
+	SZ_Init (&job->entities, job->entities_buf, SV_EntityBudget (job, frame));
+	job->entities.allowoverflow = true;
+	SV_EmitPacketEntities (job, job->oldframe, frame, &job->entities);
+}
+
+/*
+=============
+SV_ClientFrameJob
+
+May run on a worker thread
+=============
+*/
+static void SV_ClientFrameJob (void *data)
+{
+	sv_framejob_t	*job = data;
+	client_frame_t	*frame;
 
-		// add it to the circular client_entities array
-		state = &svs.client_entities[svs.next_client_entities%svs.num_client_entities];
-		if (ent->s.number != e)
+	frame = &job->client->frames[sv.framenum & UPDATE_MASK];
+
+	SV_BuildFrameEntities (job, frame);
+	SV_StoreFrameEntities (job, frame);
+}
+
+/*
+=============
+SV_GetFrameOutput
+=============
+*/
+static void SV_GetFrameOutput (sv_framejob_t *job, sv_frameoutput_t *out)
+{
+	client_frame_t	*frame;
+
+	frame = &job->client->frames[sv.framenum & UPDATE_MASK];
+
+	out->playerstatesize = job->playerstate.cursize;
+	memcpy (out->playerstate, job->playerstate.data, job->playerstate.cursize);
+	out->entitiessize = job->entities.cursize;
+	memcpy (out->entities, job->entities.data, job->entities.cursize);
+	out->overflowed = job->entities.overflowed;
+	out->num_entities = frame->num_entities;
+	out->stateschecksum = Com_BlockChecksum (job->frameents, frame->num_entities * sizeof(entity_state_t));
+	out->syncedchecksum = Com_BlockChecksum (job->synced, sizeof(job->synced));
+}
+
+/*
+=============
+SV_VerifyClientFrames
+
+Builds every frame on the main thread first, then again on the worker threads
+from the same job state and checks that they came out the same. The serial
+build doesn't store its frame, so both read the same client_entities.
+=============
+*/
+static void SV_VerifyClientFrames (sv_framejob_t **jobs, void **jobdata, int count)
+{
+	sv_frameoutput_t	*serial, threaded;
+	client_frame_t		*frame;
+	int					i;
+
+	serial = Z_Malloc (sizeof(sv_frameoutput_t) * count);
+
+	for (i = 0; i < count; i++)
+	{
+		memcpy (serial[i].synced, jobs[i]->synced, sizeof(jobs[i]->synced));
+		frame = &jobs[i]->client->frames[sv.framenum & UPDATE_MASK];
+		SV_BuildFrameEntities (jobs[i], frame);
+		SV_GetFrameOutput (jobs[i], &serial[i]);
+
+		// start the threaded build from the same state
+		memcpy (jobs[i]->synced, serial[i].synced, sizeof(jobs[i]->synced));
+	}
+
+	Sys_RunJobs (SV_ClientFrameJob, jobdata, count);
+
+	for (i = 0; i < count; i++)
+	{
+		SV_GetFrameOutput (jobs[i], &threaded);
+
+		if (threaded.playerstatesize != serial[i].playerstatesize
+			|| memcmp (threaded.playerstate, serial[i].playerstate, threaded.playerstatesize)
+			|| threaded.entitiessize != serial[i].entitiessize
+			|| memcmp (threaded.entities, serial[i].entities, threaded.entitiessize)
+			|| threaded.overflowed != serial[i].overflowed
+			|| threaded.num_entities != serial[i].num_entities
+			|| threaded.stateschecksum != serial[i].stateschecksum
+			|| threaded.syncedchecksum != serial[i].syncedchecksum)
 		{
-			Com_DPrintf (DP_SV, "FIXING ENT->S.NUMBER!!!\n");
-			ent->s.number = e;
+			Com_Printf ("WARNING: frame %i for %s differs when built on worker threads (%i/%i bytes, %i entities vs %i/%i bytes, %i entities)\n", 
+				sv.framenum, jobs[i]->client->name, 
+				serial[i].playerstatesize, serial[i].entitiessize, serial[i].num_entities, 
+				threaded.playerstatesize, threaded.entitiessize, threaded.num_entities);
 		}
-		*state = ent->s; //BRAXI FIXME
+	}
+
+	Z_Free (serial);
+}
 
-		// don't mark players missiles as solid
-		if (PROG_TO_GENT(ent->v.owner) == client->edict)
-			state->solid = 0;
+/*
+=============
+SV_BuildClientFrames
 
-		svs.next_client_entities++;
-		frame->num_entities++;
+Builds frames for all given clients, entity culling and delta encoding
+is spread over worker threads when sv_threads is enabled
+=============
+*/
+void SV_BuildClientFrames (client_t **clients, int numclients)
+{
+	sv_framejob_t	*jobs[MAX_CLIENTS];
+	void			*jobdata[MAX_CLIENTS];
+	client_frame_t	*frame;
+	int				i, count;
+
+	if (sv_numframejobs != sv_maxclients->value)
+	{
+		if (sv_framejobs)
+			Z_Free (sv_framejobs);
+		sv_numframejobs = sv_maxclients->value;
+		sv_framejobs = Z_Malloc (sizeof(sv_framejob_t) * sv_numframejobs);
+	}
+
+	count = 0;
+	for (i = 0; i < numclients; i++)
+	{
+		if (!clients[i]->edict->client)
+			continue;		// not in game yet
+
+		jobs[count] = &sv_framejobs[clients[i] - svs.clients];
+		jobs[count]->client = clients[i];
+		jobdata[count] = jobs[count];
+		SV_SetupClientFrame (jobs[count]);
+		count++;
+	}
+
+	if (count)
+		SV_BuildClusterIndex ();
+
+	if (sv_threads->value && count > 1)
+	{
+		if (sv_threads_verify->value)
+			SV_VerifyClientFrames (jobs, jobdata, count);
+		else
+			Sys_RunJobs (SV_ClientFrameJob, jobdata, count);
+	}
+	else
+	{
+		for (i = 0; i < count; i++)
+			SV_ClientFrameJob (jobs[i]);
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		frame = &jobs[i]->client->frames[sv.framenum & UPDATE_MASK];
+		jobs[i]->client->next_client_entity = frame->first_entity + frame->num_entities;
+
+		if (jobs[i]->badrender)
+			Com_Printf ("%s: entity %i renderScale or renderColor out of range\n", __FUNCTION__, jobs[i]->badrender);
 	}
 }
 
@@ -646,22 +1460,19 @@ void SV_RecordDemoMessage (void)
 
 	MSG_WriteByte (&buf, SVC_PACKET_ENTITIES);
 
-	e = 1;
-	ent = EDICT_NUM(e);
-	while (e < sv.max_edicts) //sv.num_edicts
+	for (e = SV_NextActiveEntity(0); e != -1; e = SV_NextActiveEntity(e))
 	{
+		ent = EDICT_NUM(e);
+
 		// ignore ents without visible models unless they have an effect
 		if (ent->inuse &&
 			ent->s.number && 
 			(ent->s.modelindex || ent->s.effects || ent->s.loopingSound || ent->s.event) && 
 			!((int)ent->v.svflags & SVF_NOCLIENT))
 			MSG_WriteDeltaEntity (&nostate, &ent->s, &buf, false, true);
-
-		e++;
-		ent = EDICT_NUM(e);
 	}
 
-	MSG_WriteShort (&buf, 0);		// end of packetentities
+	MSG_WriteEntityBits (&buf, 0, 0);	// end of packetentities
 
 	// now add the accumulated multicast information
 	SZ_Write (&buf, svs.demo_multicast.data, svs.demo_multicast.cursize);